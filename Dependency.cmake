@@ -23,6 +23,12 @@ set(DEP_LIST ${DEP_LIST} dep_glfw)
 set(DEP_LIBS ${DEP_LIBS} glfw3)
 
 # glad
+# the c-debug generator calls a callback around every GL call, GL_CALL_STATS counts them there
+if (GL_CALL_STATS)
+    set(GLAD_GENERATOR c-debug)
+else()
+    set(GLAD_GENERATOR c)
+endif()
 ExternalProject_Add(
     dep_glad
     GIT_REPOSITORY "https://github.com/Dav1dde/glad"
@@ -33,13 +39,14 @@ ExternalProject_Add(
     CMAKE_ARGS
         -DCMAKE_INSTALL_PREFIX=${DEP_INSTALL_DIR}
         -DGLAD_INSTALL=ON
+        -DGLAD_GENERATOR=${GLAD_GENERATOR}
     TEST_COMMAND ""
     )
 set(DEP_LIST ${DEP_LIST} dep_glad)
 set(DEP_LIBS ${DEP_LIBS} glad)
 
 # header-only
-# stb_image
+# stb_image, stb_image_write
 ExternalProject_Add(
     dep_stb
     GIT_REPOSITORY "https://github.com/nothings/stb"
@@ -53,6 +60,9 @@ ExternalProject_Add(
     INSTALL_COMMAND ${CMAKE_COMMAND} -E copy
         ${PROJECT_BINARY_DIR}/dep_stb-prefix/src/dep_stb/stb_image.h
         ${DEP_INSTALL_DIR}/include/stb/stb_image.h
+    COMMAND ${CMAKE_COMMAND} -E copy
+        ${PROJECT_BINARY_DIR}/dep_stb-prefix/src/dep_stb/stb_image_write.h
+        ${DEP_INSTALL_DIR}/include/stb/stb_image_write.h
     )
 set(DEP_LIST ${DEP_LIST} dep_stb)
 
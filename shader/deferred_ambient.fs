@@ -0,0 +1,18 @@
+#version 330 core
+out vec4 FragColor;
+
+uniform sampler2D gAlbedo;
+uniform sampler2D gDepth;
+uniform vec3 ambientColor;
+uniform vec3 background;
+
+void main()
+{
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    // nothing was drawn where the depth is still cleared
+    if (texelFetch(gDepth, pixel, 0).r == 0.0) {
+        FragColor = vec4(background, 1.0);
+        return;
+    }
+    FragColor = vec4(0.1 * ambientColor * texelFetch(gAlbedo, pixel, 0).rgb, 1.0);
+}
@@ -0,0 +1,29 @@
+#version 330 core
+out vec4 FragColor;
+
+uniform sampler2D gNormal;
+uniform sampler2D gAlbedo;
+uniform sampler2D gDepth;
+uniform mat4 invView;
+uniform vec2 tanHalfFov;
+// xyz position, w radius
+uniform vec4 lightPositionRadius;
+uniform vec3 lightColor;
+
+void main()
+{
+    // world position from the linear depth and the pixel's view ray
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    float depth = texelFetch(gDepth, pixel, 0).r;
+    vec2 ndc = gl_FragCoord.xy / vec2(textureSize(gDepth, 0)) * 2.0 - 1.0;
+    vec3 viewPos = vec3(ndc * tanHalfFov * depth, -depth);
+    vec3 fragPos = vec3(invView * vec4(viewPos, 1.0));
+
+    vec3 norm = texelFetch(gNormal, pixel, 0).xyz;
+    vec3 toLight = lightPositionRadius.xyz - fragPos;
+    float distance = length(toLight);
+    // same falloff as the clustered path
+    float falloff = clamp(1.0 - distance / lightPositionRadius.w, 0.0, 1.0);
+    float diff = max(dot(norm, toLight / max(distance, 1e-4)), 0.0);
+    FragColor = vec4(diff * falloff * falloff * lightColor * texelFetch(gAlbedo, pixel, 0).rgb, 1.0);
+}
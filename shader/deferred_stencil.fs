@@ -0,0 +1,6 @@
+#version 330 core
+
+// only the stencil is written
+void main()
+{
+}
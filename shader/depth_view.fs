@@ -0,0 +1,16 @@
+#version 330 core
+out vec4 FragColor;
+
+uniform sampler2D depth;
+// planes of the camera projection
+uniform float zNear = 0.1;
+uniform float zFar = 100.0;
+
+void main()
+{
+    float d = texelFetch(depth, ivec2(gl_FragCoord.xy), 0).r;
+    // back to view space distance, white is far
+    float z = d * 2.0 - 1.0;
+    float linear = 2.0 * zNear * zFar / (zFar + zNear - z * (zFar - zNear));
+    FragColor = vec4(vec3(linear / zFar), 1.0);
+}
@@ -0,0 +1,17 @@
+#version 330 core
+layout (location = 0) out vec4 gNormal;
+layout (location = 1) out vec4 gAlbedo;
+layout (location = 2) out float gDepth;
+
+in vec3 FragPos;
+in vec3 Normal;
+
+uniform vec3 objectColor;
+uniform mat4 view;
+
+void main()
+{
+    gNormal = vec4(normalize(Normal), 0.0);
+    gAlbedo = vec4(objectColor, 1.0);
+    gDepth = -(view * vec4(FragPos, 1.0)).z;
+}
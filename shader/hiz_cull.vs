@@ -0,0 +1,48 @@
+#version 330 core
+layout (location = 0) in vec3 aMin;
+layout (location = 1) in vec3 aMax;
+layout (location = 2) in uint aId;
+
+uniform mat4 viewProjection;
+uniform sampler2D hiz;
+uniform vec2 hizSize;
+uniform int hizLevels;
+
+// object id in the low bits, visible flag in the top bit; captured with transform feedback
+flat out uint Visibility;
+
+void main()
+{
+    vec3 ndcMin = vec3(1.0);
+    vec3 ndcMax = vec3(-1.0);
+    bool crossesNear = false;
+    for (int i = 0; i < 8; i++) {
+        vec3 corner = vec3((i & 1) != 0 ? aMax.x : aMin.x,
+                           (i & 2) != 0 ? aMax.y : aMin.y,
+                           (i & 4) != 0 ? aMax.z : aMin.z);
+        vec4 clip = viewProjection * vec4(corner, 1.0);
+        if (clip.w <= 0.0) {
+            crossesNear = true;
+            break;
+        }
+        vec3 ndc = clip.xyz / clip.w;
+        ndcMin = i == 0 ? ndc : min(ndcMin, ndc);
+        ndcMax = i == 0 ? ndc : max(ndcMax, ndc);
+    }
+
+    bool visible = true;
+    // boxes crossing the near plane are always visible
+    if (!crossesNear) {
+        vec2 uvMin = clamp(ndcMin.xy * 0.5 + 0.5, 0.0, 1.0);
+        vec2 uvMax = clamp(ndcMax.xy * 0.5 + 0.5, 0.0, 1.0);
+        vec2 extent = (uvMax - uvMin) * hizSize;
+        // pick the level where the rectangle covers at most 2x2 texels
+        float level = clamp(ceil(log2(max(max(extent.x, extent.y), 1.0))), 0.0, float(hizLevels - 1));
+        float farthest = max(max(textureLod(hiz, uvMin, level).r, textureLod(hiz, vec2(uvMax.x, uvMin.y), level).r),
+                             max(textureLod(hiz, vec2(uvMin.x, uvMax.y), level).r, textureLod(hiz, uvMax, level).r));
+        float nearest = ndcMin.z * 0.5 + 0.5;
+        visible = nearest <= farthest;
+    }
+    Visibility = aId | (visible ? 0x80000000u : 0u);
+    gl_Position = vec4(0.0);
+}
@@ -0,0 +1,40 @@
+#version 330 core
+out float Depth;
+
+// level 0 of source is the previous pyramid level (or the depth buffer copy)
+uniform sampler2D source;
+uniform bool copyLevel;
+
+float fetchDepth(ivec2 coord, ivec2 size)
+{
+    return texelFetch(source, min(coord, size - 1), 0).r;
+}
+
+void main()
+{
+    ivec2 coord = ivec2(gl_FragCoord.xy);
+    ivec2 size = textureSize(source, 0);
+    if (copyLevel) {
+        Depth = fetchDepth(coord, size);
+        return;
+    }
+
+    // keep the farthest depth of the 2x2 footprint so the pyramid stays conservative
+    ivec2 src = coord * 2;
+    float d = max(max(fetchDepth(src, size), fetchDepth(src + ivec2(1, 0), size)),
+                  max(fetchDepth(src + ivec2(0, 1), size), fetchDepth(src + ivec2(1, 1), size)));
+    // odd sized levels: the last column/row also has to cover the texel left over by the integer division
+    ivec2 dstSize = max(size / 2, ivec2(1));
+    bool extraX = (size.x & 1) != 0 && coord.x == dstSize.x - 1;
+    bool extraY = (size.y & 1) != 0 && coord.y == dstSize.y - 1;
+    if (extraX) {
+        d = max(d, max(fetchDepth(src + ivec2(2, 0), size), fetchDepth(src + ivec2(2, 1), size)));
+    }
+    if (extraY) {
+        d = max(d, max(fetchDepth(src + ivec2(0, 2), size), fetchDepth(src + ivec2(1, 2), size)));
+    }
+    if (extraX && extraY) {
+        d = max(d, fetchDepth(src + ivec2(2, 2), size));
+    }
+    Depth = d;
+}
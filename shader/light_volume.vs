@@ -0,0 +1,12 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+
+uniform mat4 view;
+uniform mat4 projection;
+// xyz position, w radius already scaled to enclose the sphere
+uniform vec4 lightVolume;
+
+void main()
+{
+    gl_Position = projection * view * vec4(lightVolume.xyz + aPos * lightVolume.w, 1.0);
+}
@@ -3,11 +3,40 @@ out vec4 FragColor;
 
 in vec3 FragPos;
 in vec3 Normal;
-  
+
 uniform vec3 objectColor;
 uniform vec3 lightColor;
 uniform vec3 lightPos;
 
+// directional light with cascaded shadows, see shadow_map.h
+uniform vec3 sunDirection;
+uniform vec3 sunColor;
+uniform bool shadowsEnabled;
+uniform mat4 view;
+uniform sampler2DArrayShadow shadowMap;
+uniform mat4 lightSpace[4];
+uniform vec4 cascadeSplits;
+uniform vec4 cascadeNormalOffset;
+
+float sunShadow(vec3 norm)
+{
+    float depth = -(view * vec4(FragPos, 1.0)).z;
+    if (!shadowsEnabled || depth >= cascadeSplits.w)
+        return 1.0;
+    int cascade = int(dot(vec4(greaterThanEqual(vec4(depth), cascadeSplits)), vec4(1.0)));
+    // pushed along the normal by a cascade texel or so against acne
+    vec4 p = lightSpace[cascade] * vec4(FragPos + norm * cascadeNormalOffset[cascade], 1.0);
+    p.xyz = p.xyz * 0.5 + 0.5;
+    // 3x3 taps of the hardware 2x2 pcf
+    vec2 texel = 1.0 / vec2(textureSize(shadowMap, 0).xy);
+    float lit = 0.0;
+    for (int y = -1; y <= 1; y++) {
+        for (int x = -1; x <= 1; x++)
+            lit += texture(shadowMap, vec4(p.xy + vec2(x, y) * texel, float(cascade), p.z));
+    }
+    return lit / 9.0;
+}
+
 void main()
 {
     float ambientStrength = 0.1;
@@ -18,6 +47,9 @@ void main()
     float diff = max(dot(norm, lightDir), 0.0);
     vec3 diffuse = diff * lightColor;
 
-    vec3 result = (ambient + diffuse) * objectColor;
+    float sunDiff = max(dot(norm, -sunDirection), 0.0);
+    vec3 sun = sunDiff > 0.0 ? sunDiff * sunShadow(norm) * sunColor : vec3(0.0);
+
+    vec3 result = (ambient + diffuse + sun) * objectColor;
     FragColor = vec4(result, 1.0);
-}
\ No newline at end of file
+}
@@ -14,5 +14,6 @@ void main()
     gl_Position = projection * view * model * vec4(aPos, 1.0);
 
     FragPos = vec3(model * vec4(aPos, 1.0));
-    Normal = aNormal;
-}
\ No newline at end of file
+    // the cubes are rotated now, so normals have to follow the model matrix
+    Normal = mat3(transpose(inverse(model))) * aNormal;
+}
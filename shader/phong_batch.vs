@@ -0,0 +1,24 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+// per instance, picks the model matrix of the draw
+layout (location = 2) in uint aDrawId;
+
+// four texels per model matrix, one per column
+uniform samplerBuffer transforms;
+uniform mat4 view;
+uniform mat4 projection;
+
+out vec3 FragPos;
+out vec3 Normal;
+
+void main()
+{
+    int base = int(aDrawId) * 4;
+    mat4 model = mat4(texelFetch(transforms, base), texelFetch(transforms, base + 1),
+                      texelFetch(transforms, base + 2), texelFetch(transforms, base + 3));
+    gl_Position = projection * view * model * vec4(aPos, 1.0);
+
+    FragPos = vec3(model * vec4(aPos, 1.0));
+    Normal = mat3(transpose(inverse(model))) * aNormal;
+}
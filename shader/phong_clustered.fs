@@ -0,0 +1,45 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec3 FragPos;
+in vec3 Normal;
+
+uniform vec3 objectColor;
+uniform vec3 ambientColor;
+// shared with the vertex shader, gives the view depth of the fragment
+uniform mat4 view;
+
+// filled by LightClusterer, see light_cluster.h for the layout
+uniform samplerBuffer lightData;
+uniform usamplerBuffer clusterGrid;
+uniform usamplerBuffer lightIndices;
+uniform ivec3 clusterCounts;
+uniform vec2 screenSize;
+uniform float zNear;
+uniform float zFar;
+
+void main()
+{
+    float depth = -(view * vec4(FragPos, 1.0)).z;
+    ivec3 cluster;
+    cluster.xy = ivec2(gl_FragCoord.xy / screenSize * vec2(clusterCounts.xy));
+    cluster.z = int(log(depth / zNear) / log(zFar / zNear) * float(clusterCounts.z));
+    cluster = clamp(cluster, ivec3(0), clusterCounts - 1);
+    uvec2 range = texelFetch(clusterGrid, (cluster.z * clusterCounts.y + cluster.y) * clusterCounts.x + cluster.x).xy;
+
+    vec3 norm = normalize(Normal);
+    vec3 result = 0.1 * ambientColor;
+    for (uint i = 0u; i < range.y; i++) {
+        int light = int(texelFetch(lightIndices, int(range.x + i)).r);
+        vec4 positionRadius = texelFetch(lightData, light * 2);
+        vec3 color = texelFetch(lightData, light * 2 + 1).rgb;
+
+        vec3 toLight = positionRadius.xyz - FragPos;
+        float distance = length(toLight);
+        // smooth falloff that reaches zero at the radius
+        float falloff = clamp(1.0 - distance / positionRadius.w, 0.0, 1.0);
+        float diff = max(dot(norm, toLight / max(distance, 1e-4)), 0.0);
+        result += diff * falloff * falloff * color;
+    }
+    FragColor = vec4(result * objectColor, 1.0);
+}
@@ -0,0 +1,25 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 1) in vec3 aNormal;
+
+// filled per draw by the recorded commands
+layout (std140) uniform ObjectBlock
+{
+    mat4 model;
+    mat4 normalMatrix;
+};
+
+uniform mat4 view;
+uniform mat4 projection;
+
+out vec3 FragPos;
+out vec3 Normal;
+
+void main()
+{
+    gl_Position = projection * view * model * vec4(aPos, 1.0);
+
+    FragPos = vec3(model * vec4(aPos, 1.0));
+    // inverse transpose of the model matrix, computed while recording
+    Normal = mat3(normalMatrix) * aNormal;
+}
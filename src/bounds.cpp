@@ -0,0 +1,88 @@
+#include "bounds.h"
+
+#include <algorithm>
+
+void AABB::Grow(const glm::vec3& p)
+{
+    min = glm::min(min, p);
+    max = glm::max(max, p);
+}
+
+void AABB::Grow(const AABB& b)
+{
+    min = glm::min(min, b.min);
+    max = glm::max(max, b.max);
+}
+
+float AABB::HalfArea() const
+{
+    glm::vec3 e = max - min;
+    return e.x * e.y + e.y * e.z + e.z * e.x;
+}
+
+Ray::Ray(const glm::vec3& o, const glm::vec3& d) : origin(o), direction(d)
+{
+    // division by zero gives +-inf which the slab test handles correctly
+    invDirection = glm::vec3(1.0f / d.x, 1.0f / d.y, 1.0f / d.z);
+}
+
+Frustum::Frustum(const glm::mat4& m)
+{
+    // glm is column major, m[col][row]
+    for (int i = 0; i < 3; i++) {
+        planes[i * 2 + 0] = glm::vec4(m[0][3] + m[0][i], m[1][3] + m[1][i], m[2][3] + m[2][i], m[3][3] + m[3][i]);
+        planes[i * 2 + 1] = glm::vec4(m[0][3] - m[0][i], m[1][3] - m[1][i], m[2][3] - m[2][i], m[3][3] - m[3][i]);
+    }
+    for (auto& p : planes) {
+        float len = glm::length(glm::vec3(p));
+        p /= len;
+    }
+}
+
+CullResult Frustum::TestAABB(const AABB& box) const
+{
+    uint32_t mask = 0x3f;
+    return TestAABB(box, mask);
+}
+
+CullResult Frustum::TestAABB(const AABB& box, uint32_t& mask) const
+{
+    glm::vec3 center = box.Center();
+    glm::vec3 extent = box.Extent() * 0.5f;
+    for (int i = 0; i < 6; i++) {
+        if ((mask & (1u << i)) == 0)
+            continue;
+        const glm::vec4& p = planes[i];
+        float d = p.x * center.x + p.y * center.y + p.z * center.z + p.w;
+        float r = extent.x * std::abs(p.x) + extent.y * std::abs(p.y) + extent.z * std::abs(p.z);
+        if (d + r < 0.0f)
+            return CullResult::OUTSIDE;
+        if (d - r >= 0.0f)
+            mask &= ~(1u << i);
+    }
+    return mask == 0 ? CullResult::INSIDE : CullResult::INTERSECT;
+}
+
+AABB TransformAABB(const AABB& box, const glm::mat4& m)
+{
+    glm::vec3 center = glm::vec3(m * glm::vec4(box.Center(), 1.0f));
+    glm::vec3 extent = box.Extent() * 0.5f;
+    glm::vec3 e;
+    for (int i = 0; i < 3; i++)
+        e[i] = std::abs(m[0][i]) * extent.x + std::abs(m[1][i]) * extent.y + std::abs(m[2][i]) * extent.z;
+    return AABB(center - e, center + e);
+}
+
+bool IntersectRayAABB(const Ray& ray, const AABB& box, float tMax, float& t)
+{
+    glm::vec3 t0 = (box.min - ray.origin) * ray.invDirection;
+    glm::vec3 t1 = (box.max - ray.origin) * ray.invDirection;
+    glm::vec3 tNear = glm::min(t0, t1);
+    glm::vec3 tFar = glm::max(t0, t1);
+    float enter = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+    float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, tMax));
+    if (enter > exit)
+        return false;
+    t = enter;
+    return true;
+}
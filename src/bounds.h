@@ -0,0 +1,65 @@
+#ifndef _BOUNDS_H_
+#define _BOUNDS_H_
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <cfloat>
+#include <cstdint>
+
+// axis aligned bounding box
+struct AABB
+{
+    glm::vec3 min = glm::vec3(FLT_MAX);
+    glm::vec3 max = glm::vec3(-FLT_MAX);
+
+    AABB() = default;
+    AABB(const glm::vec3& mn, const glm::vec3& mx) : min(mn), max(mx) {}
+
+    void Grow(const glm::vec3& p);
+    void Grow(const AABB& b);
+    bool IsValid() const { return min.x <= max.x && min.y <= max.y && min.z <= max.z; }
+    glm::vec3 Center() const { return (min + max) * 0.5f; }
+    glm::vec3 Extent() const { return max - min; }
+    // half of the surface area, which is all the SAH needs
+    float HalfArea() const;
+};
+
+// a ray with a precomputed reciprocal direction for slab tests
+struct Ray
+{
+    glm::vec3 origin;
+    glm::vec3 direction;
+    glm::vec3 invDirection;
+
+    Ray() = default;
+    Ray(const glm::vec3& o, const glm::vec3& d);
+};
+
+enum class CullResult {
+    OUTSIDE,
+    INTERSECT,
+    INSIDE
+};
+
+// six planes (left, right, bottom, top, near, far) pointing inwards, ax + by + cz + d >= 0 is inside
+struct Frustum
+{
+    glm::vec4 planes[6];
+
+    Frustum() = default;
+    // extracts the planes from a projection * view matrix (Gribb/Hartmann)
+    explicit Frustum(const glm::mat4& viewProjection);
+
+    CullResult TestAABB(const AABB& box) const;
+    // same as TestAABB but skips the planes whose bit is cleared in mask, and clears the bits of planes the box is
+    // fully inside of so children don't test them again
+    CullResult TestAABB(const AABB& box, uint32_t& mask) const;
+};
+
+// returns the bounds of box after transforming it with m (Arvo's method)
+AABB TransformAABB(const AABB& box, const glm::mat4& m);
+// slab test, returns true and the entry distance in t when the ray hits box before tMax
+bool IntersectRayAABB(const Ray& ray, const AABB& box, float tMax, float& t);
+
+#endif//_BOUNDS_H_
@@ -0,0 +1,354 @@
+#include "bvh.h"
+#include "cpu_profiler.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace {
+
+const int BVH_BINS = 16;
+const uint32_t BVH_MAX_LEAF_SIZE = 4;
+// relative cost of a node traversal step against a primitive test
+const float BVH_TRAVERSAL_COST = 1.0f;
+
+float ElapsedMs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+struct Bin
+{
+    AABB bounds;
+    uint32_t count = 0;
+};
+
+} // namespace
+
+void Bvh::Build(const std::vector<AABB>& bounds)
+{
+    PROFILE_SCOPE("bvh build");
+    auto start = std::chrono::steady_clock::now();
+
+    primBounds = bounds;
+    uint32_t n = (uint32_t)bounds.size();
+    primIndices.resize(n);
+    std::vector<glm::vec3> centroids(n);
+    for (uint32_t i = 0; i < n; i++) {
+        primIndices[i] = i;
+        centroids[i] = bounds[i].Center();
+    }
+
+    nodes.clear();
+    // a binary tree with leaves of at least one primitive never has more than 2n - 1 nodes
+    nodes.reserve(n > 0 ? 2 * n - 1 : 1);
+    parents.assign(1, UINT32_MAX);
+    BvhNode root;
+    root.leftFirst = 0;
+    root.count = n;
+    nodes.push_back(root);
+    if (n > 0) {
+        updateNodeBounds(0);
+        subdivide(0, centroids);
+    }
+
+    primLeaf.resize(n);
+    for (uint32_t i = 0; i < (uint32_t)nodes.size(); i++) {
+        const BvhNode& node = nodes[i];
+        for (uint32_t j = 0; j < node.count; j++)
+            primLeaf[primIndices[node.leftFirst + j]] = i;
+    }
+
+    stats.buildCost = computeCost();
+    stats.refitCost = stats.buildCost;
+    stats.nodeCount = (uint32_t)nodes.size();
+    stats.buildMs = ElapsedMs(start);
+}
+
+void Bvh::Refit(const std::vector<AABB>& bounds)
+{
+    PROFILE_SCOPE("bvh refit");
+    auto start = std::chrono::steady_clock::now();
+
+    primBounds = bounds;
+    // children are always stored after their parent, so a reverse sweep is a bottom-up traversal
+    for (int32_t i = (int32_t)nodes.size() - 1; i >= 0; i--) {
+        BvhNode& node = nodes[i];
+        if (node.IsLeaf()) {
+            updateNodeBounds(i);
+        } else {
+            node.bounds = nodes[node.leftFirst].bounds;
+            node.bounds.Grow(nodes[node.leftFirst + 1].bounds);
+        }
+    }
+
+    stats.refitCost = computeCost();
+    stats.refitMs = ElapsedMs(start);
+}
+
+void Bvh::Refit(uint32_t primitive, const AABB& bounds)
+{
+    primBounds[primitive] = bounds;
+    uint32_t nodeIndex = primLeaf[primitive];
+    updateNodeBounds(nodeIndex);
+    nodeIndex = parents[nodeIndex];
+    while (nodeIndex != UINT32_MAX) {
+        BvhNode& node = nodes[nodeIndex];
+        AABB b = nodes[node.leftFirst].bounds;
+        b.Grow(nodes[node.leftFirst + 1].bounds);
+        if (b.min == node.bounds.min && b.max == node.bounds.max)
+            break;
+        node.bounds = b;
+        nodeIndex = parents[nodeIndex];
+    }
+}
+
+bool Bvh::NeedsRebuild(float maxCostRatio) const
+{
+    return stats.buildCost > 0.0f && stats.refitCost > stats.buildCost * maxCostRatio;
+}
+
+void Bvh::CullFrustum(const Frustum& frustum, std::vector<uint32_t>& visible)
+{
+    PROFILE_SCOPE("bvh cull");
+    auto start = std::chrono::steady_clock::now();
+    stats.nodesVisited = 0;
+    if (primBounds.empty()) {
+        stats.cullMs = ElapsedMs(start);
+        return;
+    }
+
+    // node index in the low bits, the planes still to be tested in the high ones
+    stack.clear();
+    stack.push_back(0x3fu << 26);
+    while (!stack.empty()) {
+        uint32_t entry = stack.back();
+        stack.pop_back();
+        uint32_t nodeIndex = entry & 0x3ffffff;
+        uint32_t mask = entry >> 26;
+        const BvhNode& node = nodes[nodeIndex];
+        stats.nodesVisited++;
+
+        CullResult result = frustum.TestAABB(node.bounds, mask);
+        if (result == CullResult::OUTSIDE)
+            continue;
+        if (result == CullResult::INSIDE) {
+            appendSubtree(nodeIndex, visible);
+            continue;
+        }
+        if (node.IsLeaf()) {
+            for (uint32_t i = 0; i < node.count; i++) {
+                uint32_t prim = primIndices[node.leftFirst + i];
+                if (frustum.TestAABB(primBounds[prim]) != CullResult::OUTSIDE)
+                    visible.push_back(prim);
+            }
+        } else {
+            stack.push_back((mask << 26) | node.leftFirst);
+            stack.push_back((mask << 26) | (node.leftFirst + 1));
+        }
+    }
+    stats.cullMs = ElapsedMs(start);
+}
+
+bool Bvh::Raycast(const Ray& ray, RayHit& hit, const RayPrimitiveTest& test)
+{
+    auto start = std::chrono::steady_clock::now();
+    stats.nodesVisited = 0;
+    float t;
+    if (primBounds.empty() || !IntersectRayAABB(ray, nodes[0].bounds, hit.t, t)) {
+        stats.rayMs = ElapsedMs(start);
+        return false;
+    }
+
+    stack.clear();
+    stack.push_back(0);
+    while (!stack.empty()) {
+        const BvhNode& node = nodes[stack.back()];
+        stack.pop_back();
+        stats.nodesVisited++;
+        // the entry distance may have been beaten since this node was pushed
+        if (!IntersectRayAABB(ray, node.bounds, hit.t, t))
+            continue;
+
+        if (node.IsLeaf()) {
+            for (uint32_t i = 0; i < node.count; i++) {
+                uint32_t prim = primIndices[node.leftFirst + i];
+                float primT = hit.t;
+                bool hitPrim = test ? test(prim, ray, primT) : IntersectRayAABB(ray, primBounds[prim], hit.t, primT);
+                if (hitPrim && primT < hit.t) {
+                    hit.t = primT;
+                    hit.primitive = prim;
+                }
+            }
+            continue;
+        }
+
+        // push the far child first so the near one is visited first and shrinks hit.t early
+        uint32_t near = node.leftFirst;
+        uint32_t far = node.leftFirst + 1;
+        float tNear = FLT_MAX, tFar = FLT_MAX;
+        bool hitNear = IntersectRayAABB(ray, nodes[near].bounds, hit.t, tNear);
+        bool hitFar = IntersectRayAABB(ray, nodes[far].bounds, hit.t, tFar);
+        if (hitNear && hitFar && tFar < tNear) {
+            std::swap(near, far);
+            std::swap(hitNear, hitFar);
+        }
+        if (hitFar)
+            stack.push_back(far);
+        if (hitNear)
+            stack.push_back(near);
+    }
+
+    stats.rayMs = ElapsedMs(start);
+    return hit.primitive != UINT32_MAX;
+}
+
+void Bvh::updateNodeBounds(uint32_t nodeIndex)
+{
+    BvhNode& node = nodes[nodeIndex];
+    node.bounds = AABB();
+    for (uint32_t i = 0; i < node.count; i++)
+        node.bounds.Grow(primBounds[primIndices[node.leftFirst + i]]);
+}
+
+void Bvh::subdivide(uint32_t rootIndex, std::vector<glm::vec3>& centroids)
+{
+    std::vector<uint32_t> work;
+    work.push_back(rootIndex);
+    while (!work.empty()) {
+        uint32_t nodeIndex = work.back();
+        work.pop_back();
+        BvhNode& node = nodes[nodeIndex];
+        if (node.count <= 1)
+            continue;
+
+        int axis;
+        float split;
+        float splitCost = findBestSplit(node, centroids, axis, split);
+        float leafCost = node.bounds.HalfArea() * node.count;
+        if (splitCost >= leafCost && node.count <= BVH_MAX_LEAF_SIZE)
+            continue;
+
+        // partition the primitive indices around the split plane
+        uint32_t first = node.leftFirst;
+        uint32_t i = first;
+        uint32_t j = first + node.count - 1;
+        while (i <= j && j != UINT32_MAX) {
+            if (centroids[primIndices[i]][axis] < split)
+                i++;
+            else
+                std::swap(primIndices[i], primIndices[j--]);
+        }
+        uint32_t leftCount = i - first;
+        // all centroids on one side, e.g. many objects at the same place: fall back to a median split
+        if (leftCount == 0 || leftCount == node.count) {
+            if (node.count <= BVH_MAX_LEAF_SIZE)
+                continue;
+            leftCount = node.count / 2;
+        }
+
+        uint32_t leftIndex = (uint32_t)nodes.size();
+        BvhNode left, right;
+        left.leftFirst = first;
+        left.count = leftCount;
+        right.leftFirst = first + leftCount;
+        right.count = node.count - leftCount;
+        // push_back may reallocate, node is not valid past this point
+        node.leftFirst = leftIndex;
+        node.count = 0;
+        nodes.push_back(left);
+        nodes.push_back(right);
+        parents.push_back(nodeIndex);
+        parents.push_back(nodeIndex);
+        updateNodeBounds(leftIndex);
+        updateNodeBounds(leftIndex + 1);
+        work.push_back(leftIndex);
+        work.push_back(leftIndex + 1);
+    }
+}
+
+float Bvh::findBestSplit(const BvhNode& node, const std::vector<glm::vec3>& centroids, int& bestAxis,
+                         float& bestSplit) const
+{
+    float bestCost = FLT_MAX;
+    bestAxis = 0;
+    bestSplit = 0.0f;
+
+    AABB centroidBounds;
+    for (uint32_t i = 0; i < node.count; i++)
+        centroidBounds.Grow(centroids[primIndices[node.leftFirst + i]]);
+
+    for (int axis = 0; axis < 3; axis++) {
+        float lo = centroidBounds.min[axis];
+        float hi = centroidBounds.max[axis];
+        if (lo == hi)
+            continue;
+
+        Bin bins[BVH_BINS];
+        float scale = BVH_BINS / (hi - lo);
+        for (uint32_t i = 0; i < node.count; i++) {
+            uint32_t prim = primIndices[node.leftFirst + i];
+            int b = std::min(BVH_BINS - 1, (int)((centroids[prim][axis] - lo) * scale));
+            bins[b].count++;
+            bins[b].bounds.Grow(primBounds[prim]);
+        }
+
+        // sweep from both sides to get the area and count left and right of each bin boundary
+        float leftArea[BVH_BINS - 1], rightArea[BVH_BINS - 1];
+        uint32_t leftCount[BVH_BINS - 1], rightCount[BVH_BINS - 1];
+        AABB leftBox, rightBox;
+        uint32_t leftSum = 0, rightSum = 0;
+        for (int i = 0; i < BVH_BINS - 1; i++) {
+            leftSum += bins[i].count;
+            leftCount[i] = leftSum;
+            leftBox.Grow(bins[i].bounds);
+            leftArea[i] = leftSum > 0 ? leftBox.HalfArea() : 0.0f;
+            rightSum += bins[BVH_BINS - 1 - i].count;
+            rightCount[BVH_BINS - 2 - i] = rightSum;
+            rightBox.Grow(bins[BVH_BINS - 1 - i].bounds);
+            rightArea[BVH_BINS - 2 - i] = rightSum > 0 ? rightBox.HalfArea() : 0.0f;
+        }
+        for (int i = 0; i < BVH_BINS - 1; i++) {
+            float cost = leftCount[i] * leftArea[i] + rightCount[i] * rightArea[i];
+            if (cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = lo + (i + 1) / scale;
+            }
+        }
+    }
+    return bestCost + BVH_TRAVERSAL_COST * node.bounds.HalfArea();
+}
+
+void Bvh::appendSubtree(uint32_t nodeIndex, std::vector<uint32_t>& visible)
+{
+    // the caller's stack is still in use, the subtree gets its own range on top of it
+    size_t base = stack.size();
+    stack.push_back(nodeIndex);
+    while (stack.size() > base) {
+        const BvhNode& node = nodes[stack.back()];
+        stack.pop_back();
+        if (node.IsLeaf()) {
+            for (uint32_t i = 0; i < node.count; i++)
+                visible.push_back(primIndices[node.leftFirst + i]);
+        } else {
+            stack.push_back(node.leftFirst);
+            stack.push_back(node.leftFirst + 1);
+        }
+    }
+}
+
+float Bvh::computeCost() const
+{
+    if (nodes.empty() || !nodes[0].bounds.IsValid())
+        return 0.0f;
+    // SAH cost relative to the root: sum of child area ratios times their cost
+    float rootArea = nodes[0].bounds.HalfArea();
+    if (rootArea <= 0.0f)
+        return 0.0f;
+    float cost = 0.0f;
+    for (const BvhNode& node : nodes) {
+        float ratio = node.bounds.HalfArea() / rootArea;
+        cost += node.IsLeaf() ? ratio * node.count : ratio * BVH_TRAVERSAL_COST;
+    }
+    return cost;
+}
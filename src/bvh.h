@@ -0,0 +1,83 @@
+#ifndef _BVH_H_
+#define _BVH_H_
+
+#include "bounds.h"
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+struct BvhNode
+{
+    AABB bounds;
+    // first child for inner nodes (the second one is leftFirst + 1), first primitive for leaves
+    uint32_t leftFirst = 0;
+    // number of primitives, zero for inner nodes
+    uint32_t count = 0;
+
+    bool IsLeaf() const { return count > 0; }
+};
+
+struct RayHit
+{
+    uint32_t primitive = UINT32_MAX;
+    float t = FLT_MAX;
+};
+
+// timings in milliseconds of the last call of each kind
+struct BvhStats
+{
+    float buildMs = 0.0f;
+    float refitMs = 0.0f;
+    float cullMs = 0.0f;
+    float rayMs = 0.0f;
+    uint32_t nodeCount = 0;
+    uint32_t nodesVisited = 0;
+    // SAH cost right after the build and after the last refit, the ratio tells how much refits degraded the tree
+    float buildCost = 0.0f;
+    float refitCost = 0.0f;
+};
+
+// A bounding volume hierarchy over object bounds, built with binned SAH. Primitives are identified by their index in
+// the bounds array passed to Build(). Moving objects are handled by Refit(), which keeps the topology and only
+// recomputes node bounds; rebuild when NeedsRebuild() reports the tree quality has dropped too much.
+class Bvh
+{
+public:
+    // callback for exact ray tests, returns true and the hit distance in t when the ray hits the primitive before t
+    using RayPrimitiveTest = std::function<bool(uint32_t primitive, const Ray& ray, float& t)>;
+
+    void Build(const std::vector<AABB>& bounds);
+    // recomputes all node bounds bottom-up from new primitive bounds, the primitive count must not change
+    void Refit(const std::vector<AABB>& bounds);
+    // updates a single primitive and walks up its ancestors until the bounds stop changing
+    void Refit(uint32_t primitive, const AABB& bounds);
+    bool NeedsRebuild(float maxCostRatio = 1.5f) const;
+
+    // appends the indices of primitives intersecting the frustum to visible
+    void CullFrustum(const Frustum& frustum, std::vector<uint32_t>& visible);
+    // finds the closest hit; without a primitive test the primitive bounds are hit
+    bool Raycast(const Ray& ray, RayHit& hit, const RayPrimitiveTest& test = nullptr);
+
+    uint32_t GetPrimitiveCount() const { return (uint32_t)primBounds.size(); }
+    const BvhStats& GetStats() const { return stats; }
+    const std::vector<BvhNode>& GetNodes() const { return nodes; }
+
+private:
+    std::vector<BvhNode> nodes;
+    std::vector<uint32_t> primIndices;
+    std::vector<AABB> primBounds;
+    // leaf node of each primitive and parent of each node, used for single primitive refits
+    std::vector<uint32_t> primLeaf;
+    std::vector<uint32_t> parents;
+    std::vector<uint32_t> stack;
+    BvhStats stats;
+
+    void updateNodeBounds(uint32_t nodeIndex);
+    void subdivide(uint32_t nodeIndex, std::vector<glm::vec3>& centroids);
+    float findBestSplit(const BvhNode& node, const std::vector<glm::vec3>& centroids, int& axis, float& split) const;
+    void appendSubtree(uint32_t nodeIndex, std::vector<uint32_t>& visible);
+    float computeCost() const;
+};
+
+#endif//_BVH_H_
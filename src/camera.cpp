@@ -27,6 +27,23 @@ glm::mat4 Camera::GetViewMatrix()
     return glm::lookAt(Position, Position + Front, Up);
 }
 
+// returns the perspective projection matrix for the current zoom
+glm::mat4 Camera::GetProjectionMatrix(float aspect, float zNear, float zFar)
+{
+    return glm::perspective(glm::radians(Zoom), aspect, zNear, zFar);
+}
+
+// returns the world space ray through a window position, used for mouse picking
+Ray Camera::ScreenPointToRay(float x, float y, float width, float height, float aspect)
+{
+    // window coordinates have y pointing down
+    float ndcX = 2.0f * x / width - 1.0f;
+    float ndcY = 1.0f - 2.0f * y / height;
+    float tanHalfFov = tan(glm::radians(Zoom) * 0.5f);
+    glm::vec3 dir = Front + Right * (ndcX * tanHalfFov * aspect) + Up * (ndcY * tanHalfFov);
+    return Ray(Position, glm::normalize(dir));
+}
+
 // processes input received from any keyboard-like input system. Accepts input parameter in the form of camera defined ENUM (to abstract it from windowing systems)
 void Camera::ProcessKeyboard(Camera_Movement direction, float deltaTime)
 {
@@ -90,6 +107,14 @@ void Camera::MouseButton(int button, int action, double x, double y)
     }
 }
 
+// sets the Euler Angles directly, used to play back camera paths
+void Camera::SetOrientation(float yaw, float pitch)
+{
+    Yaw = yaw;
+    Pitch = pitch;
+    updateCameraVectors();
+}
+
 // calculates the front vector from the Camera's (updated) Euler Angles
 void Camera::updateCameraVectors()
 {
@@ -6,6 +6,8 @@
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 
+#include "bounds.h"
+
 // Defines several possible options for camera movement. Used as abstraction to stay away from window-system specific input methods
 enum Camera_Movement {
     FORWARD,
@@ -56,6 +58,10 @@ public:
     Camera(float posX, float posY, float posZ, float upX, float upY, float upZ, float yaw, float pitch);
     // returns the view matrix calculated using Euler Angles and the LookAt Matrix
     glm::mat4 GetViewMatrix();
+    // returns the perspective projection matrix for the current zoom
+    glm::mat4 GetProjectionMatrix(float aspect, float zNear = 0.1f, float zFar = 100.0f);
+    // returns the world space ray through a window position, used for mouse picking; aspect is the projection's
+    Ray ScreenPointToRay(float x, float y, float width, float height, float aspect);
     // processes input received from any keyboard-like input system. Accepts input parameter in the form of camera defined ENUM (to abstract it from windowing systems)
     void ProcessKeyboard(Camera_Movement direction, float deltaTime);
     // processes input received from a mouse input system. Expects the offset value in both the x and y direction.
@@ -64,6 +70,8 @@ public:
     void ProcessMouseScroll(float yoffset);
     // processes input received from a mouse right-click event.
     void MouseButton(int button, int action, double x, double y);
+    // sets the Euler Angles directly, used to play back camera paths
+    void SetOrientation(float yaw, float pitch);
 
 private:
     // calculates the front vector from the Camera's (updated) Euler Angles
@@ -0,0 +1,117 @@
+#include "command_buffer.h"
+
+#include <cstring>
+
+void CommandBuffer::Reset(uint32_t uniformAlignment)
+{
+    commands.clear();
+    uniformData.clear();
+    alignment = uniformAlignment;
+    program = 0;
+    vao = 0;
+}
+
+void CommandBuffer::UseProgram(GLuint newProgram)
+{
+    if (program == newProgram)
+        return;
+    commands.push_back({COMMAND_USE_PROGRAM, {newProgram, 0, 0}});
+    program = newProgram;
+}
+
+void CommandBuffer::BindVertexArray(GLuint newVao)
+{
+    if (vao == newVao)
+        return;
+    commands.push_back({COMMAND_BIND_VERTEX_ARRAY, {newVao, 0, 0}});
+    vao = newVao;
+}
+
+void CommandBuffer::BindUniforms(GLuint binding, const void* data, uint32_t size)
+{
+    // every range has to start on the offset alignment of the driver, the buffer's base does as well
+    uint32_t offset = (uint32_t)uniformData.size();
+    uint32_t padded = (size + alignment - 1) / alignment * alignment;
+    uniformData.resize(offset + padded);
+    std::memcpy(uniformData.data() + offset, data, size);
+    commands.push_back({COMMAND_BIND_UNIFORMS, {binding, offset, size}});
+}
+
+void CommandBuffer::DrawArrays(GLenum mode, GLint first, GLsizei count)
+{
+    commands.push_back({COMMAND_DRAW_ARRAYS, {mode, (uint32_t)first, (uint32_t)count}});
+}
+
+CommandExecutor::CommandExecutor()
+{
+    GLint offsetAlignment = 256;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &offsetAlignment);
+    alignment = (uint32_t)offsetAlignment;
+    glGenBuffers(1, &uniformBuffer);
+}
+
+CommandExecutor::~CommandExecutor()
+{
+    glDeleteBuffers(1, &uniformBuffer);
+}
+
+void CommandExecutor::Begin(uint32_t count)
+{
+    beginTime = std::chrono::steady_clock::now();
+    if (buffers.size() < count)
+        buffers.resize(count);
+    bufferCount = count;
+    for (uint32_t i = 0; i < count; i++)
+        buffers[i].Reset(alignment);
+}
+
+void CommandExecutor::Execute(GLStateCache& state)
+{
+    auto start = std::chrono::steady_clock::now();
+    stats = CommandStats();
+    stats.buffers = bufferCount;
+    stats.recordMs = std::chrono::duration<float, std::milli>(start - beginTime).count();
+
+    // one upload for all buffers, each starts where the previous one ended
+    size_t totalBytes = 0;
+    for (uint32_t i = 0; i < bufferCount; i++)
+        totalBytes += buffers[i].uniformData.size();
+    stats.uniformBytes = (uint32_t)totalBytes;
+    glBindBuffer(GL_UNIFORM_BUFFER, uniformBuffer);
+    if (totalBytes > 0) {
+        // orphaned, the previous frame may still be reading it
+        glBufferData(GL_UNIFORM_BUFFER, totalBytes, nullptr, GL_STREAM_DRAW);
+        size_t base = 0;
+        for (uint32_t i = 0; i < bufferCount; i++) {
+            const std::vector<uint8_t>& data = buffers[i].uniformData;
+            if (!data.empty())
+                glBufferSubData(GL_UNIFORM_BUFFER, base, data.size(), data.data());
+            base += data.size();
+        }
+    }
+
+    size_t base = 0;
+    for (uint32_t i = 0; i < bufferCount; i++) {
+        const CommandBuffer& buffer = buffers[i];
+        for (const Command& cmd : buffer.commands) {
+            switch (cmd.type) {
+            case COMMAND_USE_PROGRAM:
+                state.UseProgram(cmd.args[0]);
+                break;
+            case COMMAND_BIND_VERTEX_ARRAY:
+                state.BindVertexArray(cmd.args[0]);
+                break;
+            case COMMAND_BIND_UNIFORMS:
+                glBindBufferRange(GL_UNIFORM_BUFFER, cmd.args[0], uniformBuffer, base + cmd.args[1], cmd.args[2]);
+                break;
+            case COMMAND_DRAW_ARRAYS:
+                glDrawArrays(cmd.args[0], (GLint)cmd.args[1], (GLsizei)cmd.args[2]);
+                stats.draws++;
+                break;
+            }
+        }
+        stats.commands += (uint32_t)buffer.commands.size();
+        base += buffer.uniformData.size();
+    }
+    stats.replayMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
@@ -0,0 +1,89 @@
+#ifndef _COMMAND_BUFFER_H_
+#define _COMMAND_BUFFER_H_
+
+#include <glad/glad.h>
+
+#include "gl_state.h"
+
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+enum CommandType : uint32_t {
+    COMMAND_USE_PROGRAM,
+    COMMAND_BIND_VERTEX_ARRAY,
+    // binds a range of the buffer's uniform data to a uniform block binding point
+    COMMAND_BIND_UNIFORMS,
+    COMMAND_DRAW_ARRAYS
+};
+
+// plain data so recording is a push_back, the meaning of args depends on the type
+struct Command
+{
+    CommandType type;
+    uint32_t args[3];
+};
+
+struct CommandStats
+{
+    uint32_t buffers = 0;
+    uint32_t commands = 0;
+    uint32_t draws = 0;
+    uint32_t uniformBytes = 0;
+    // from Begin() to Execute(), and the replay itself
+    float recordMs = 0.0f;
+    float replayMs = 0.0f;
+};
+
+// Commands recorded off the GL thread. Nothing in here touches GL, so every worker can fill its own buffer while the
+// GL thread replays them later. Uniform data is copied into the buffer and only referenced by offset, the executor
+// uploads all of it at once before the replay.
+class CommandBuffer
+{
+public:
+    void Reset(uint32_t uniformAlignment);
+
+    // binds already recorded in this buffer are skipped
+    void UseProgram(GLuint program);
+    void BindVertexArray(GLuint vao);
+    void BindUniforms(GLuint binding, const void* data, uint32_t size);
+    void DrawArrays(GLenum mode, GLint first, GLsizei count);
+
+    size_t Size() const { return commands.size(); }
+
+private:
+    friend class CommandExecutor;
+
+    std::vector<Command> commands;
+    std::vector<uint8_t> uniformData;
+    uint32_t alignment = 256;
+    GLuint program = 0;
+    GLuint vao = 0;
+};
+
+// Owns the command buffers of a frame and replays them on the GL thread. Begin() hands out count empty buffers, one
+// per worker or per chunk of work, Execute() uploads their uniform data into one uniform buffer and replays the
+// buffers in order through the state cache.
+class CommandExecutor
+{
+public:
+    CommandExecutor();
+    ~CommandExecutor();
+
+    void Begin(uint32_t count);
+    CommandBuffer& GetBuffer(uint32_t index) { return buffers[index]; }
+    void Execute(GLStateCache& state);
+
+    const CommandStats& GetStats() const { return stats; }
+
+private:
+    GLuint uniformBuffer = 0;
+    uint32_t alignment = 256;
+    uint32_t bufferCount = 0;
+    // only grows, buffers keep their capacity from frame to frame
+    std::vector<CommandBuffer> buffers;
+    std::chrono::steady_clock::time_point beginTime;
+    CommandStats stats;
+};
+
+#endif//_COMMAND_BUFFER_H_
@@ -0,0 +1,229 @@
+#include "cpu_profiler.h"
+#include "logger.h"
+#include "profiler_ui.h"
+
+#include <imgui.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <string_view>
+
+thread_local uint32_t CpuProfiler::threadDepth = 0;
+thread_local CpuProfiler::ThreadRing* CpuProfiler::threadRing = nullptr;
+
+namespace {
+
+void WriteJsonString(std::ostream& out, const char* s)
+{
+    out << '"';
+    for (; *s; s++) {
+        if (*s == '"' || *s == '\\')
+            out << '\\' << *s;
+        else if ((unsigned char)*s >= 0x20)
+            out << *s;
+    }
+    out << '"';
+}
+
+} // namespace
+
+CpuProfiler& CpuProfiler::Get()
+{
+    static CpuProfiler profiler;
+    return profiler;
+}
+
+CpuProfiler::CpuProfiler()
+{
+    startTicks = Now();
+    startTime = std::chrono::steady_clock::now();
+}
+
+CpuProfiler::ThreadRing* CpuProfiler::registerThread()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto ring = std::make_unique<ThreadRing>();
+    ring->index = (uint32_t)rings.size();
+    ring->name = "thread " + std::to_string(ring->index);
+    threadRing = ring.get();
+    rings.push_back(std::move(ring));
+    return threadRing;
+}
+
+void CpuProfiler::SetThreadName(const std::string& name)
+{
+    ThreadRing* ring = threadRing ? threadRing : registerThread();
+    std::lock_guard<std::mutex> lock(mutex);
+    ring->name = name;
+}
+
+const char* CpuProfiler::Intern(const std::string& name)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return names.insert(name).first->c_str();
+}
+
+void CpuProfiler::EndFrame()
+{
+    uint64_t now = Now();
+#ifdef CPU_PROFILER_RDTSC
+    double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    if (elapsedMs > 1.0 && now > startTicks)
+        ticksPerMs = (now - startTicks) / elapsedMs;
+#else
+    ticksPerMs = std::chrono::steady_clock::period::den / (1000.0 * std::chrono::steady_clock::period::num);
+#endif
+    if (!threadRing)
+        registerThread();
+
+    // while paused the rings are still drained, into a frame that is thrown away
+    Frame& frame = paused ? pausedFrame : history[frameCount % HISTORY_FRAMES];
+    frame.begin = lastFrameEnd ? lastFrameEnd : startTicks;
+    frame.end = now;
+    frame.thread = threadRing->index;
+    frame.zones.clear();
+    lastFrameEnd = now;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (auto& ring : rings) {
+            uint64_t head = ring->head.load(std::memory_order_acquire);
+            uint64_t first = std::max(ring->tail, head > RING_SIZE ? head - RING_SIZE : 0);
+            droppedZones += first - ring->tail;
+            size_t copied = frame.zones.size();
+            for (uint64_t i = first; i < head; i++)
+                frame.zones.push_back(ring->events[i & (RING_SIZE - 1)]);
+            // the owner kept recording meanwhile, whatever it may have overwritten is dropped
+            uint64_t newHead = ring->head.load(std::memory_order_acquire);
+            if (newHead > first + RING_SIZE) {
+                uint64_t torn = std::min(newHead - RING_SIZE - first, head - first);
+                frame.zones.erase(frame.zones.begin() + copied, frame.zones.begin() + copied + torn);
+                droppedZones += torn;
+            }
+            ring->tail = head;
+        }
+    }
+    if (paused)
+        return;
+    frameCount++;
+
+    // keyed by the text, the same name from two literals can sit at two addresses
+    std::map<std::string_view, CpuZoneTotal> sums;
+    for (const CpuZoneEvent& zone : frame.zones) {
+        CpuZoneTotal& total = sums[zone.name];
+        total.name = zone.name;
+        total.ms += toMs(zone.end - zone.begin);
+        total.count++;
+    }
+    totals.clear();
+    for (auto& sum : sums)
+        totals.push_back(sum.second);
+    std::sort(totals.begin(), totals.end(), [](const CpuZoneTotal& a, const CpuZoneTotal& b) { return a.ms > b.ms; });
+}
+
+const CpuProfiler::Frame* CpuProfiler::getFrame(uint32_t age) const
+{
+    if (age >= std::min(frameCount, HISTORY_FRAMES))
+        return nullptr;
+    return &history[(frameCount - 1 - age) % HISTORY_FRAMES];
+}
+
+double CpuProfiler::GetFrameMs() const
+{
+    const Frame* frame = getFrame(0);
+    return frame ? toMs(frame->end - frame->begin) : 0.0;
+}
+
+bool CpuProfiler::WriteChromeTrace(const std::string& path)
+{
+    std::ofstream file(path);
+    if (!file) {
+        LOG_ERROR("ERROR::CPU_PROFILER::FAILED_TO_WRITE::%s", path.c_str());
+        return false;
+    }
+    uint32_t count = std::min(frameCount, HISTORY_FRAMES);
+    const Frame* oldest = getFrame(count > 0 ? count - 1 : 0);
+    uint64_t origin = oldest ? oldest->begin : 0;
+    // microseconds from the start of the oldest frame
+    auto toUs = [&](uint64_t ticks) { return toMs(ticks - std::min(ticks, origin)) * 1000.0; };
+
+    file << "{\"traceEvents\":[" << std::endl;
+    bool first = true;
+    auto writeEvent = [&](const char* name, uint64_t begin, uint64_t end, uint32_t thread) {
+        file << (first ? "" : ",\n") << "{\"name\":";
+        WriteJsonString(file, name);
+        file << ",\"ph\":\"X\",\"pid\":0,\"tid\":" << thread << ",\"ts\":" << toUs(begin)
+             << ",\"dur\":" << toMs(end - begin) * 1000.0 << "}";
+        first = false;
+    };
+    for (uint32_t age = count; age-- > 0;) {
+        const Frame* frame = getFrame(age);
+        std::string name = "frame " + std::to_string(frameCount - 1 - age);
+        writeEvent(name.c_str(), frame->begin, frame->end, frame->thread);
+        for (const CpuZoneEvent& zone : frame->zones)
+            writeEvent(zone.name, zone.begin, zone.end, zone.thread);
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto& ring : rings) {
+        file << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << ring->index
+             << ",\"args\":{\"name\":";
+        WriteJsonString(file, ring->name.c_str());
+        file << "}}";
+        first = false;
+    }
+    file << "\n]}" << std::endl;
+    return (bool)file;
+}
+
+void CpuProfiler::DrawWindow(bool* open)
+{
+    if (!ImGui::Begin("CPU profiler", open)) {
+        ImGui::End();
+        return;
+    }
+    bool recording = enabled.load();
+    if (ImGui::Checkbox("Enabled", &recording))
+        enabled.store(recording);
+    ImGui::SameLine();
+    ImGui::Checkbox("Pause", &paused);
+    ImGui::SameLine();
+    if (ImGui::Button("Export Chrome trace") && WriteChromeTrace("./cpu_trace.json"))
+        LOG_INFO("cpu trace of the last %u frames written to ./cpu_trace.json", std::min(frameCount, HISTORY_FRAMES));
+    ImGui::Text("cpu frame %.3f ms, %llu zones dropped", GetFrameMs(), (unsigned long long)droppedZones);
+
+    // the newest frame, a lane per thread with a row per nesting level
+    const Frame* frame = getFrame(0);
+    if (frame && frame->end > frame->begin) {
+        std::vector<uint32_t> laneDepth;
+        std::vector<std::string> laneNames;
+        std::vector<FlameBar> bars;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            for (auto& ring : rings)
+                laneNames.push_back(ring->name);
+        }
+        laneDepth.assign(laneNames.size(), 0);
+        for (const CpuZoneEvent& zone : frame->zones)
+            laneDepth[zone.thread] = std::max(laneDepth[zone.thread], zone.depth + 1);
+        for (uint32_t lane = 0; lane < laneNames.size(); lane++) {
+            if (laneDepth[lane] == 0)
+                continue;
+            bars.clear();
+            for (const CpuZoneEvent& zone : frame->zones) {
+                if (zone.thread != lane)
+                    continue;
+                // zones that started in the previous frame are cut at its start
+                uint64_t begin = std::max(zone.begin, frame->begin);
+                uint64_t end = std::max(zone.end, begin);
+                bars.push_back({zone.name, zone.depth, toMs(begin - frame->begin), toMs(end - begin)});
+            }
+            ImGui::TextUnformatted(laneNames[lane].c_str());
+            DrawFlameLane(laneNames[lane].c_str(), bars, laneDepth[lane], toMs(frame->end - frame->begin));
+        }
+    }
+
+    for (const CpuZoneTotal& total : totals)
+        ImGui::Text("%-24s %8.3f ms %6u", total.name, total.ms, total.count);
+    ImGui::End();
+}
@@ -0,0 +1,176 @@
+#ifndef _CPU_PROFILER_H_
+#define _CPU_PROFILER_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CPU_PROFILER_RDTSC
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
+#endif
+
+// a finished zone, times in profiler ticks
+struct CpuZoneEvent
+{
+    const char* name;
+    uint64_t begin;
+    uint64_t end;
+    uint32_t depth;
+    uint32_t thread;
+};
+
+// one zone name summed over the newest frame, on every thread
+struct CpuZoneTotal
+{
+    const char* name;
+    double ms;
+    uint32_t count;
+};
+
+// CPU zones from every thread. A zone costs two timestamps (rdtsc where there is one, steady_clock otherwise) and a
+// store into a ring owned by its thread, with no lock or shared cache line on the way, so the zones can stay in
+// release builds. The frame loop calls EndFrame(), which drains every ring into a history of the last HISTORY_FRAMES
+// frames and sums the newest one per zone name; a thread recording more than RING_SIZE zones in a frame loses the
+// oldest ones. Ticks are converted to time against steady_clock over the whole run, so the rdtsc rate needs no
+// calibration pause at startup. The history can be written as a Chrome trace (chrome://tracing, Perfetto).
+//
+// Zone names are kept as pointers, use string literals or Intern().
+class CpuProfiler
+{
+public:
+    static const uint32_t RING_SIZE = 8192;
+    static const uint32_t HISTORY_FRAMES = 120;
+
+    // recording can be switched off at run time, zones then only cost the check
+    std::atomic<bool> enabled{true};
+    // keeps the history and the totals as they are
+    bool paused = false;
+
+    static CpuProfiler& Get();
+
+    static uint64_t Now()
+    {
+#ifdef CPU_PROFILER_RDTSC
+        return __rdtsc();
+#else
+        return (uint64_t)std::chrono::steady_clock::now().time_since_epoch().count();
+#endif
+    }
+
+    // names the calling thread in the trace and the view
+    void SetThreadName(const std::string& name);
+    // a pointer that lives as long as the profiler, for names that aren't literals
+    const char* Intern(const std::string& name);
+
+    void Record(const char* name, uint64_t begin, uint64_t end, uint32_t depth)
+    {
+        ThreadRing* ring = threadRing ? threadRing : registerThread();
+        uint64_t head = ring->head.load(std::memory_order_relaxed);
+        ring->events[head & (RING_SIZE - 1)] = {name, begin, end, depth, ring->index};
+        ring->head.store(head + 1, std::memory_order_release);
+    }
+
+    // call from one thread, once per frame
+    void EndFrame();
+
+    const std::vector<CpuZoneTotal>& GetFrameTotals() const { return totals; }
+    double GetFrameMs() const;
+    uint64_t GetDroppedZones() const { return droppedZones; }
+
+    bool WriteChromeTrace(const std::string& path);
+    // the newest frame per thread and the totals, in their own imgui window
+    void DrawWindow(bool* open = nullptr);
+
+    // nesting depth of the calling thread's open zones
+    static thread_local uint32_t threadDepth;
+
+private:
+    struct ThreadRing
+    {
+        uint32_t index = 0;
+        std::string name;
+        std::atomic<uint64_t> head{0};
+        // read by EndFrame() only
+        uint64_t tail = 0;
+        CpuZoneEvent events[RING_SIZE];
+    };
+
+    struct Frame
+    {
+        uint64_t begin = 0;
+        uint64_t end = 0;
+        uint32_t thread = 0;
+        std::vector<CpuZoneEvent> zones;
+    };
+
+    static thread_local ThreadRing* threadRing;
+
+    // guards rings and names, only taken when a thread records its first zone, on EndFrame() and on Intern()
+    std::mutex mutex;
+    std::vector<std::unique_ptr<ThreadRing>> rings;
+    std::unordered_set<std::string> names;
+
+    Frame history[HISTORY_FRAMES];
+    Frame pausedFrame;
+    uint32_t frameCount = 0;
+    uint64_t lastFrameEnd = 0;
+    std::vector<CpuZoneTotal> totals;
+    uint64_t droppedZones = 0;
+
+    // tick rate, measured between the first EndFrame() and the newest one
+    uint64_t startTicks = 0;
+    std::chrono::steady_clock::time_point startTime;
+    double ticksPerMs = 1.0e6;
+
+    CpuProfiler();
+    ThreadRing* registerThread();
+    const Frame* getFrame(uint32_t age) const;
+    double toMs(uint64_t ticks) const { return ticks / ticksPerMs; }
+};
+
+// times the enclosing block on the calling thread
+class CpuZone
+{
+public:
+    explicit CpuZone(const char* name) : name(name)
+    {
+        if (CpuProfiler::Get().enabled.load(std::memory_order_relaxed)) {
+            depth = CpuProfiler::threadDepth++;
+            begin = CpuProfiler::Now();
+        }
+    }
+    ~CpuZone()
+    {
+        if (begin) {
+            uint64_t end = CpuProfiler::Now();
+            CpuProfiler::threadDepth--;
+            CpuProfiler::Get().Record(name, begin, end, depth);
+        }
+    }
+
+private:
+    const char* name;
+    uint64_t begin = 0;
+    uint32_t depth = 0;
+};
+
+// build with CPU_PROFILER_DISABLED to compile the zones out entirely
+#ifndef CPU_PROFILER_DISABLED
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(name) CpuZone PROFILE_CONCAT(cpuZone, __LINE__)(name)
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#endif
+
+#endif//_CPU_PROFILER_H_
@@ -0,0 +1,184 @@
+#include "deferred_renderer.h"
+#include "bounds.h"
+
+#include <cmath>
+
+DeferredRenderer::DeferredRenderer()
+{
+    ambientShader = std::make_unique<Shader>("./shader/fullscreen.vs", "./shader/deferred_ambient.fs");
+    stencilShader = std::make_unique<Shader>("./shader/light_volume.vs", "./shader/deferred_stencil.fs");
+    lightShader = std::make_unique<Shader>("./shader/light_volume.vs", "./shader/deferred_light.fs");
+
+    ambientShader->use();
+    ambientShader->setInt("gAlbedo", 1);
+    ambientShader->setInt("gDepth", 2);
+    lightShader->use();
+    lightShader->setInt("gNormal", 0);
+    lightShader->setInt("gAlbedo", 1);
+    lightShader->setInt("gDepth", 2);
+    // set once per light, so skip the name lookup
+    stencilLightLoc = glGetUniformLocation(stencilShader->ID, "lightVolume");
+    lightLightLoc = glGetUniformLocation(lightShader->ID, "lightVolume");
+    lightColorLoc = glGetUniformLocation(lightShader->ID, "lightColor");
+    lightPositionLoc = glGetUniformLocation(lightShader->ID, "lightPositionRadius");
+
+    glGenVertexArrays(1, &emptyVAO);
+    createSphere(8, 12);
+}
+
+DeferredRenderer::~DeferredRenderer()
+{
+    glDeleteBuffers(1, &sphereEBO);
+    glDeleteBuffers(1, &sphereVBO);
+    glDeleteVertexArrays(1, &sphereVAO);
+    glDeleteVertexArrays(1, &emptyVAO);
+    glDeleteProgram(ambientShader->ID);
+    glDeleteProgram(stencilShader->ID);
+    glDeleteProgram(lightShader->ID);
+}
+
+GBuffer DeferredRenderer::CreateGBuffer(FramePassBuilder& builder, int width, int height)
+{
+    GBuffer gbuffer;
+    gbuffer.normal = builder.Create("g-buffer normal", {width, height, GL_RGBA16F});
+    gbuffer.albedo = builder.Create("g-buffer albedo", {width, height, GL_RGBA8});
+    gbuffer.depth = builder.Create("g-buffer depth", {width, height, GL_R32F});
+    gbuffer.depthStencil = builder.Create("depth stencil", {width, height, GL_DEPTH24_STENCIL8});
+    return gbuffer;
+}
+
+void DeferredRenderer::UseGBuffer(FramePassBuilder& builder, const GBuffer& gbuffer)
+{
+    builder.Read(gbuffer.normal);
+    builder.Read(gbuffer.albedo);
+    builder.Read(gbuffer.depth);
+    builder.Read(gbuffer.depthStencil);
+    builder.Write(gbuffer.depthStencil);
+}
+
+void DeferredRenderer::ClearGBuffer()
+{
+    const GLfloat zero[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    for (GLint i = 0; i < 3; i++)
+        glClearBufferfv(GL_COLOR, i, zero);
+    glClearBufferfi(GL_DEPTH_STENCIL, 0, 1.0f, 0);
+}
+
+void DeferredRenderer::Light(const FrameGraph& graph, const GBuffer& gbuffer, const std::vector<PointLight>& lights,
+                             const glm::mat4& view, const glm::mat4& projection, float fovY, float aspect,
+                             const glm::vec3& ambientColor, const glm::vec3& background)
+{
+    stats = DeferredStats();
+    const FrameResource inputs[3] = {gbuffer.normal, gbuffer.albedo, gbuffer.depth};
+    for (GLuint i = 0; i < 3; i++) {
+        glActiveTexture(GL_TEXTURE0 + i);
+        glBindTexture(GL_TEXTURE_2D, graph.GetTexture(inputs[i]));
+    }
+    glActiveTexture(GL_TEXTURE0);
+
+    // ambient everywhere, the background where the G-buffer is empty
+    glDepthMask(GL_FALSE);
+    glDisable(GL_DEPTH_TEST);
+    ambientShader->use();
+    ambientShader->setVec3("ambientColor", ambientColor);
+    ambientShader->setVec3("background", background);
+    glBindVertexArray(emptyVAO);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    float tanHalfY = std::tan(fovY * 0.5f);
+    stencilShader->use();
+    stencilShader->setMat4("view", view);
+    stencilShader->setMat4("projection", projection);
+    lightShader->use();
+    lightShader->setMat4("view", view);
+    lightShader->setMat4("projection", projection);
+    lightShader->setMat4("invView", glm::inverse(view));
+    lightShader->setVec2("tanHalfFov", glm::vec2(tanHalfY * aspect, tanHalfY));
+
+    glEnable(GL_STENCIL_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_ONE, GL_ONE);
+    glBindVertexArray(sphereVAO);
+    Frustum frustum(projection * view);
+    for (const PointLight& light : lights) {
+        glm::vec3 extent(light.radius);
+        if (frustum.TestAABB(AABB(light.position - extent, light.position + extent)) == CullResult::OUTSIDE) {
+            stats.lightsCulled++;
+            continue;
+        }
+        stats.lightsDrawn++;
+        glm::vec4 volume(light.position, light.radius * sphereScale);
+
+        // mark the pixels whose geometry is inside the volume
+        stencilShader->use();
+        glUniform4fv(stencilLightLoc, 1, &volume[0]);
+        glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+        glEnable(GL_DEPTH_TEST);
+        glDisable(GL_CULL_FACE);
+        glStencilFunc(GL_ALWAYS, 0, 0xff);
+        glStencilOpSeparate(GL_BACK, GL_KEEP, GL_INCR_WRAP, GL_KEEP);
+        glStencilOpSeparate(GL_FRONT, GL_KEEP, GL_DECR_WRAP, GL_KEEP);
+        glDrawElements(GL_TRIANGLES, sphereIndexCount, GL_UNSIGNED_INT, nullptr);
+
+        // shade them through the back faces, which cover them even with the camera inside, and clear the marks
+        lightShader->use();
+        glUniform4fv(lightLightLoc, 1, &volume[0]);
+        glUniform3fv(lightColorLoc, 1, &light.color[0]);
+        glUniform4f(lightPositionLoc, light.position.x, light.position.y, light.position.z, light.radius);
+        glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+        glDisable(GL_DEPTH_TEST);
+        glEnable(GL_CULL_FACE);
+        glCullFace(GL_FRONT);
+        glStencilFunc(GL_NOTEQUAL, 0, 0xff);
+        glStencilOp(GL_KEEP, GL_KEEP, GL_ZERO);
+        glDrawElements(GL_TRIANGLES, sphereIndexCount, GL_UNSIGNED_INT, nullptr);
+    }
+
+    glCullFace(GL_BACK);
+    glDisable(GL_CULL_FACE);
+    glDisable(GL_BLEND);
+    glDisable(GL_STENCIL_TEST);
+    glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glDepthMask(GL_TRUE);
+    glEnable(GL_DEPTH_TEST);
+    glBindVertexArray(0);
+}
+
+void DeferredRenderer::createSphere(int rings, int segments)
+{
+    std::vector<float> vertices;
+    std::vector<uint32_t> indices;
+    const float pi = 3.14159265f;
+    for (int r = 0; r <= rings; r++) {
+        float phi = pi * r / rings;
+        for (int s = 0; s <= segments; s++) {
+            float theta = 2.0f * pi * s / segments;
+            vertices.push_back(std::sin(phi) * std::cos(theta));
+            vertices.push_back(std::cos(phi));
+            vertices.push_back(std::sin(phi) * std::sin(theta));
+        }
+    }
+    // counter-clockwise seen from outside
+    for (int r = 0; r < rings; r++) {
+        for (int s = 0; s < segments; s++) {
+            uint32_t a = r * (segments + 1) + s;
+            uint32_t b = a + segments + 1;
+            indices.insert(indices.end(), {a, a + 1, b, a + 1, b + 1, b});
+        }
+    }
+    sphereIndexCount = (GLsizei)indices.size();
+    sphereScale = 1.0f / (std::cos(pi / segments) * std::cos(pi / (2.0f * rings)));
+
+    glGenVertexArrays(1, &sphereVAO);
+    glGenBuffers(1, &sphereVBO);
+    glGenBuffers(1, &sphereEBO);
+    glBindVertexArray(sphereVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, sphereVBO);
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, sphereEBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t), indices.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glBindVertexArray(0);
+}
@@ -0,0 +1,80 @@
+#ifndef _DEFERRED_RENDERER_H_
+#define _DEFERRED_RENDERER_H_
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "frame_graph.h"
+#include "light_cluster.h"
+#include "shader.h"
+
+#include <memory>
+#include <vector>
+
+// targets of the geometry pass, in attachment order
+struct GBuffer
+{
+    // world space normal
+    FrameResource normal = INVALID_FRAME_RESOURCE;
+    FrameResource albedo = INVALID_FRAME_RESOURCE;
+    // linear view depth, 0 where nothing was drawn
+    FrameResource depth = INVALID_FRAME_RESOURCE;
+    // depth test of the geometry and the stencil of the light volumes
+    FrameResource depthStencil = INVALID_FRAME_RESOURCE;
+};
+
+struct DeferredStats
+{
+    uint32_t lightsDrawn = 0;
+    uint32_t lightsCulled = 0;
+};
+
+// Deferred shading in two frame graph passes. The geometry pass draws the opaque objects with a G-buffer program
+// (any of the phong vertex shaders with shader/gbuffer.fs). The lighting pass reads the G-buffer, writes an ambient
+// term for every pixel and then adds each point light inside a sphere volume: a first draw marks the pixels whose
+// geometry lies inside the sphere in the stencil (depth fail on the back faces increments, on the front faces
+// decrements, which also works with the camera inside the sphere), the second draw shades only those pixels and
+// resets their stencil so the next light starts clean. Lights outside the view frustum are skipped.
+class DeferredRenderer
+{
+public:
+    DeferredRenderer();
+    ~DeferredRenderer();
+
+    // call from the setup of the geometry pass
+    GBuffer CreateGBuffer(FramePassBuilder& builder, int width, int height);
+    // call from the setup of the lighting pass, the depth stencil target stays attached for the light volumes
+    void UseGBuffer(FramePassBuilder& builder, const GBuffer& gbuffer);
+    // clears the bound G-buffer
+    void ClearGBuffer();
+
+    // lights the bound target from the G-buffer, fovY in radians
+    void Light(const FrameGraph& graph, const GBuffer& gbuffer, const std::vector<PointLight>& lights,
+               const glm::mat4& view, const glm::mat4& projection, float fovY, float aspect,
+               const glm::vec3& ambientColor, const glm::vec3& background);
+
+    const DeferredStats& GetStats() const { return stats; }
+
+private:
+    std::unique_ptr<Shader> ambientShader;
+    std::unique_ptr<Shader> stencilShader;
+    std::unique_ptr<Shader> lightShader;
+    GLint stencilLightLoc = -1;
+    GLint lightLightLoc = -1;
+    GLint lightColorLoc = -1;
+    GLint lightPositionLoc = -1;
+
+    GLuint emptyVAO = 0;
+    GLuint sphereVAO = 0;
+    GLuint sphereVBO = 0;
+    GLuint sphereEBO = 0;
+    GLsizei sphereIndexCount = 0;
+    // the mesh is scaled up by this so its faces, not only its vertices, enclose the unit sphere
+    float sphereScale = 1.0f;
+
+    DeferredStats stats;
+
+    void createSphere(int rings, int segments);
+};
+
+#endif//_DEFERRED_RENDERER_H_
@@ -0,0 +1,30 @@
+#include "fixed_timestep.h"
+
+#include <algorithm>
+#include <cmath>
+
+int FixedTimestep::Advance(double frameTime)
+{
+    accumulator += std::max(frameTime, 0.0);
+    steps = 0;
+    while (accumulator >= stepTime && steps < maxSteps) {
+        accumulator -= stepTime;
+        steps++;
+    }
+    if (accumulator >= stepTime) {
+        // behind by more than the clamp allows, keep the fraction of a step so the interpolation stays smooth
+        double kept = std::fmod(accumulator, stepTime);
+        droppedTime += accumulator - kept;
+        accumulator = kept;
+    }
+    totalSteps += steps;
+    return steps;
+}
+
+void FixedTimestep::Reset()
+{
+    accumulator = 0.0;
+    steps = 0;
+    totalSteps = 0;
+    droppedTime = 0.0;
+}
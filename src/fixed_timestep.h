@@ -0,0 +1,38 @@
+#ifndef _FIXED_TIMESTEP_H_
+#define _FIXED_TIMESTEP_H_
+
+#include <cstdint>
+
+// Clock of a simulation that advances in fixed steps however long the frames take: Advance() adds the frame's time to
+// an accumulator and returns how many whole steps it holds, the remainder carries over to the next frame. GetAlpha()
+// is that remainder as a fraction of a step, how far the frame is from the last step to the next one, to draw the
+// state interpolated between the last two steps. A frame runs at most maxSteps steps and drops the time beyond them,
+// so a slow frame slows the simulation down instead of making the next frame slower still.
+class FixedTimestep
+{
+public:
+    int maxSteps = 5;
+
+    explicit FixedTimestep(double stepTime = 1.0 / 60.0) : stepTime(stepTime) {}
+
+    // frameTime in seconds, returns the steps to run
+    int Advance(double frameTime);
+    void SetStepTime(double seconds) { stepTime = seconds; }
+    void Reset();
+
+    double GetStepTime() const { return stepTime; }
+    float GetAlpha() const { return (float)(accumulator / stepTime); }
+    int GetSteps() const { return steps; }
+    uint64_t GetTotalSteps() const { return totalSteps; }
+    // simulated time thrown away by the clamp
+    double GetDroppedTime() const { return droppedTime; }
+
+private:
+    double stepTime;
+    double accumulator = 0.0;
+    int steps = 0;
+    uint64_t totalSteps = 0;
+    double droppedTime = 0.0;
+};
+
+#endif//_FIXED_TIMESTEP_H_
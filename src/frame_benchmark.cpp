@@ -0,0 +1,240 @@
+#include "frame_benchmark.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+namespace {
+
+template <typename T>
+T CatmullRom(const T& p0, const T& p1, const T& p2, const T& p3, float t)
+{
+    float t2 = t * t;
+    float t3 = t2 * t;
+    return 0.5f * ((2.0f * p1) + (p2 - p0) * t + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 +
+                   (3.0f * p1 - p0 - 3.0f * p2 + p3) * t3);
+}
+
+double ElapsedMs(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end)
+{
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+} // namespace
+
+CameraKey CameraPath::Sample(float time) const
+{
+    if (keys.empty())
+        return CameraKey{time, glm::vec3(0.0f), -90.0f, 0.0f};
+    if (keys.size() == 1)
+        return CameraKey{time, keys[0].position, keys[0].yaw, keys[0].pitch};
+    float duration = GetDuration();
+    if (duration > 0.0f)
+        time = std::fmod(std::max(time, 0.0f), duration);
+    // the segment [k1, k2] holding time, the outer keys are clamped at the ends of the path
+    size_t k2 = std::upper_bound(keys.begin(), keys.end(), time,
+                                 [](float t, const CameraKey& key) { return t < key.time; }) - keys.begin();
+    k2 = std::min(std::max(k2, (size_t)1), keys.size() - 1);
+    size_t k1 = k2 - 1;
+    const CameraKey& a = keys[k1 > 0 ? k1 - 1 : k1];
+    const CameraKey& b = keys[k1];
+    const CameraKey& c = keys[k2];
+    const CameraKey& d = keys[std::min(k2 + 1, keys.size() - 1)];
+    float span = c.time - b.time;
+    float t = span > 0.0f ? glm::clamp((time - b.time) / span, 0.0f, 1.0f) : 0.0f;
+
+    CameraKey key;
+    key.time = time;
+    key.position = CatmullRom(a.position, b.position, c.position, d.position, t);
+    key.yaw = CatmullRom(a.yaw, b.yaw, c.yaw, d.yaw, t);
+    key.pitch = glm::clamp(CatmullRom(a.pitch, b.pitch, c.pitch, d.pitch, t), -89.0f, 89.0f);
+    return key;
+}
+
+bool CameraPath::Load(const std::string& path)
+{
+    std::ifstream file(path);
+    if (!file) {
+        LOG_ERROR("ERROR::CAMERA_PATH::FAILED_TO_OPEN::%s", path.c_str());
+        return false;
+    }
+    keys.clear();
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        line = line.substr(0, line.find('#'));
+        if (line.find_first_not_of(" \t\r") == std::string::npos)
+            continue;
+        std::istringstream in(line);
+        CameraKey key;
+        if (!(in >> key.time >> key.position.x >> key.position.y >> key.position.z >> key.yaw >> key.pitch) ||
+            (!keys.empty() && key.time < keys.back().time)) {
+            LOG_ERROR("ERROR::CAMERA_PATH::BAD_KEY::%s:%d", path.c_str(), lineNumber);
+            keys.clear();
+            return false;
+        }
+        keys.push_back(key);
+    }
+    return !keys.empty();
+}
+
+bool CameraPath::Save(const std::string& path) const
+{
+    std::ofstream file(path);
+    if (!file) {
+        LOG_ERROR("ERROR::CAMERA_PATH::FAILED_TO_WRITE::%s", path.c_str());
+        return false;
+    }
+    file << "# time x y z yaw pitch" << std::endl;
+    for (const CameraKey& key : keys) {
+        file << key.time << " " << key.position.x << " " << key.position.y << " " << key.position.z << " " << key.yaw
+             << " " << key.pitch << std::endl;
+    }
+    return (bool)file;
+}
+
+CameraPath CameraPath::CreateOrbit(const glm::vec3& center, float radius, float height, float duration)
+{
+    const int KEY_COUNT = 16;
+    CameraPath path;
+    float pitch = -glm::degrees(std::atan2(height, radius));
+    for (int i = 0; i <= KEY_COUNT; i++) {
+        float angle = 2.0f * 3.14159265f * i / KEY_COUNT;
+        glm::vec3 position = center + glm::vec3(std::cos(angle) * radius, height, std::sin(angle) * radius);
+        // facing back at the center, yaw keeps counting past 360 so the spline doesn't swing around
+        float yaw = glm::degrees(angle) + 180.0f;
+        path.AddKey({duration * i / KEY_COUNT, position, yaw, pitch});
+    }
+    return path;
+}
+
+FrameBenchmark::~FrameBenchmark()
+{
+    if (queries[0])
+        glDeleteQueries(QUERY_COUNT, queries);
+}
+
+void FrameBenchmark::Start(int frames, int warmup)
+{
+    if (!queries[0])
+        glGenQueries(QUERY_COUNT, queries);
+    std::fill(queryFrames, queryFrames + QUERY_COUNT, -1);
+    frameCount = std::max(1, frames);
+    warmupFrames = std::min(std::max(0, warmup), frameCount - 1);
+    frame = 0;
+    frameMs.assign(frameCount, 0.0);
+    cpuMs.assign(frameCount, 0.0);
+    gpuMs.assign(frameCount, 0.0);
+    running = true;
+}
+
+void FrameBenchmark::BeginFrame()
+{
+    if (!running || frame >= frameCount)
+        return;
+    frameStart = std::chrono::steady_clock::now();
+    if (frame > 0)
+        frameMs[frame - 1] = ElapsedMs(previousStart, frameStart);
+    previousStart = frameStart;
+
+    // the slot was last used QUERY_COUNT frames ago, by now it has almost always finished
+    int slot = frame % QUERY_COUNT;
+    readQuery(slot);
+    glBeginQuery(GL_TIME_ELAPSED, queries[slot]);
+    queryFrames[slot] = frame;
+}
+
+void FrameBenchmark::EndFrame()
+{
+    if (!running || frame >= frameCount)
+        return;
+    glEndQuery(GL_TIME_ELAPSED);
+    cpuMs[frame] = ElapsedMs(frameStart, std::chrono::steady_clock::now());
+    frame++;
+}
+
+void FrameBenchmark::Finish()
+{
+    if (!running)
+        return;
+    glFinish();
+    // the last frame has no next start, it ends once the gpu is done with it
+    if (frame > 0)
+        frameMs[frame - 1] = ElapsedMs(previousStart, std::chrono::steady_clock::now());
+    for (int slot = 0; slot < QUERY_COUNT; slot++)
+        readQuery(slot);
+}
+
+void FrameBenchmark::readQuery(int slot)
+{
+    if (queryFrames[slot] < 0)
+        return;
+    GLuint64 elapsed = 0;
+    glGetQueryObjectui64v(queries[slot], GL_QUERY_RESULT, &elapsed);
+    gpuMs[queryFrames[slot]] = elapsed / 1.0e6;
+    queryFrames[slot] = -1;
+}
+
+FrameTimeSummary FrameBenchmark::Summarize(const std::vector<double>& times) const
+{
+    FrameTimeSummary summary;
+    int end = std::min(frame, (int)times.size());
+    if (end <= warmupFrames)
+        return summary;
+    std::vector<double> sorted(times.begin() + warmupFrames, times.begin() + end);
+    std::sort(sorted.begin(), sorted.end());
+    // nearest rank
+    auto percentile = [&](double p) {
+        size_t rank = (size_t)std::ceil(p / 100.0 * sorted.size());
+        return sorted[std::min(std::max(rank, (size_t)1), sorted.size()) - 1];
+    };
+    double total = 0.0;
+    for (double ms : sorted)
+        total += ms;
+    summary.min = sorted.front();
+    summary.avg = total / sorted.size();
+    summary.p50 = percentile(50.0);
+    summary.p95 = percentile(95.0);
+    summary.p99 = percentile(99.0);
+    summary.max = sorted.back();
+    return summary;
+}
+
+void FrameBenchmark::PrintSummary(std::ostream& out) const
+{
+    out << "frame benchmark: " << frame - warmupFrames << " frames after " << warmupFrames << " warm-up frames"
+        << std::endl;
+    std::ios_base::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    out << std::fixed << std::setprecision(3);
+    out << "           min       avg       p50       p95       p99       max" << std::endl;
+    const char* names[] = {"frame", "cpu", "gpu"};
+    const std::vector<double>* columns[] = {&frameMs, &cpuMs, &gpuMs};
+    for (int i = 0; i < 3; i++) {
+        FrameTimeSummary s = Summarize(*columns[i]);
+        out << "  " << std::left << std::setw(5) << names[i] << std::right << std::setw(9) << s.min << " "
+            << std::setw(9) << s.avg << " " << std::setw(9) << s.p50 << " " << std::setw(9) << s.p95 << " "
+            << std::setw(9) << s.p99 << " " << std::setw(9) << s.max << std::endl;
+    }
+    out.flags(flags);
+    out.precision(precision);
+}
+
+bool FrameBenchmark::WriteCsv(const std::string& path) const
+{
+    std::ofstream file(path);
+    if (!file) {
+        LOG_ERROR("ERROR::FRAME_BENCHMARK::FAILED_TO_WRITE::%s", path.c_str());
+        return false;
+    }
+    file << "frame,frame_ms,cpu_ms,gpu_ms" << std::endl;
+    file << std::fixed << std::setprecision(4);
+    for (int i = 0; i < frame; i++)
+        file << i << "," << frameMs[i] << "," << cpuMs[i] << "," << gpuMs[i] << std::endl;
+    return (bool)file;
+}
@@ -0,0 +1,100 @@
+#ifndef _FRAME_BENCHMARK_H_
+#define _FRAME_BENCHMARK_H_
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// camera state at a point in time, angles in degrees like Camera's
+struct CameraKey
+{
+    float time;
+    glm::vec3 position;
+    float yaw;
+    float pitch;
+};
+
+// Keyframed camera flight, sampled with a Catmull-Rom spline through the keys. Stored as text, one key per line:
+//   time x y z yaw pitch
+// with '#' starting a comment, so a path can be recorded in the window and edited by hand.
+class CameraPath
+{
+public:
+    // keys are expected in time order
+    void AddKey(const CameraKey& key) { keys.push_back(key); }
+    void Clear() { keys.clear(); }
+    bool IsEmpty() const { return keys.empty(); }
+    float GetDuration() const { return keys.empty() ? 0.0f : keys.back().time; }
+
+    // times past the end wrap around to the start, so a short path fills any number of frames
+    CameraKey Sample(float time) const;
+
+    bool Load(const std::string& path);
+    bool Save(const std::string& path) const;
+
+    // a circle of radius around center at height above it, always looking at the center, one turn in duration
+    static CameraPath CreateOrbit(const glm::vec3& center, float radius, float height, float duration);
+
+private:
+    std::vector<CameraKey> keys;
+};
+
+// summary of one column of frame times, in milliseconds
+struct FrameTimeSummary
+{
+    double min = 0.0;
+    double avg = 0.0;
+    double p50 = 0.0;
+    double p95 = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;
+};
+
+// Records the times of a fixed number of frames: the interval between frame starts, the CPU time from BeginFrame()
+// to EndFrame(), and the GPU time of everything in between from a GL_TIME_ELAPSED query. Queries go round a small
+// ring and are read a few frames late, so measuring doesn't stall the pipeline. The first warmupFrames frames are
+// recorded but left out of the summary.
+class FrameBenchmark
+{
+public:
+    ~FrameBenchmark();
+
+    void Start(int frameCount, int warmupFrames = 10);
+    bool IsRunning() const { return running; }
+    bool IsDone() const { return running && frame >= frameCount; }
+
+    void BeginFrame();
+    void EndFrame();
+    // waits for the outstanding queries, call before reading the results
+    void Finish();
+
+    FrameTimeSummary Summarize(const std::vector<double>& times) const;
+    void PrintSummary(std::ostream& out) const;
+    // frame, frame_ms, cpu_ms, gpu_ms for every frame, warm-up included
+    bool WriteCsv(const std::string& path) const;
+
+private:
+    static const int QUERY_COUNT = 4;
+
+    bool running = false;
+    int frameCount = 0;
+    int warmupFrames = 0;
+    int frame = 0;
+    std::chrono::steady_clock::time_point frameStart;
+    std::chrono::steady_clock::time_point previousStart;
+    GLuint queries[QUERY_COUNT] = {};
+    // frame each query was issued in, -1 when the query is free
+    int queryFrames[QUERY_COUNT] = {-1, -1, -1, -1};
+
+    std::vector<double> frameMs;
+    std::vector<double> cpuMs;
+    std::vector<double> gpuMs;
+
+    void readQuery(int slot);
+};
+
+#endif//_FRAME_BENCHMARK_H_
@@ -0,0 +1,205 @@
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include "frame_capture.h"
+#include "logger.h"
+
+#include <stb/stb_image_write.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+FrameCapture::FrameCapture()
+{
+    for (auto& slot : readbacks)
+        glGenBuffers(1, &slot.buffer);
+    writer = std::thread(&FrameCapture::writeLoop, this);
+}
+
+FrameCapture::~FrameCapture()
+{
+    Flush();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    writer.join();
+    for (auto& slot : readbacks)
+        glDeleteBuffers(1, &slot.buffer);
+}
+
+bool FrameCapture::Capture(GLuint framebuffer, int width, int height, const std::string& path)
+{
+    auto start = std::chrono::steady_clock::now();
+    Readback& slot = readbacks[next];
+    if (slot.fence) {
+        // every slot is still in flight, skip the frame rather than stall
+        stats.skipped++;
+        return false;
+    }
+
+    GLsizeiptr size = (GLsizeiptr)width * height * 4;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    if (slot.capacity < size) {
+        glBufferData(GL_PIXEL_PACK_BUFFER, size, nullptr, GL_STREAM_READ);
+        slot.capacity = size;
+    }
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    // into the bound pixel buffer, returns right away
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.width = width;
+    slot.height = height;
+    slot.path = path;
+    next = (next + 1) % READBACK_SLOTS;
+    stats.captured++;
+
+    frameMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+void FrameCapture::Update()
+{
+    auto start = std::chrono::steady_clock::now();
+    // oldest first, and only up to the first one still in flight, so the files come out in order
+    for (int i = 0; i < READBACK_SLOTS; i++) {
+        Readback& slot = readbacks[(next + i) % READBACK_SLOTS];
+        if (!slot.fence)
+            continue;
+        GLenum status = glClientWaitSync(slot.fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+            break;
+        collect(slot);
+    }
+    frameMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    stats.mainThreadMs = frameMs;
+    frameMs = 0.0;
+}
+
+void FrameCapture::Flush()
+{
+    for (int i = 0; i < READBACK_SLOTS; i++) {
+        Readback& slot = readbacks[(next + i) % READBACK_SLOTS];
+        if (!slot.fence)
+            continue;
+        glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        collect(slot);
+    }
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this]() { return queue.empty() && !writing; });
+}
+
+const CaptureStats& FrameCapture::GetStats()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.queued = (uint32_t)queue.size();
+    stats.written = written;
+    stats.failed = failed;
+    return stats;
+}
+
+void FrameCapture::collect(Readback& slot)
+{
+    glDeleteSync(slot.fence);
+    slot.fence = nullptr;
+
+    Image image;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if ((int)queue.size() >= MAX_QUEUED) {
+            stats.dropped++;
+            return;
+        }
+        if (!freePixels.empty()) {
+            image.pixels = std::move(freePixels.back());
+            freePixels.pop_back();
+        }
+    }
+
+    size_t size = (size_t)slot.width * slot.height * 4;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+    void* data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr)size, GL_MAP_READ_BIT);
+    if (!data) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+        failed++;
+        return;
+    }
+    // the copy is the only per pixel work on this thread, the writer does the rest
+    image.pixels.resize(size);
+    std::memcpy(image.pixels.data(), data, size);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    image.width = slot.width;
+    image.height = slot.height;
+    image.path = std::move(slot.path);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back(std::move(image));
+    }
+    wake.notify_one();
+}
+
+void FrameCapture::writeLoop()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [this]() { return stopping || !queue.empty(); });
+        if (queue.empty())
+            return;
+        Image image = std::move(queue.front());
+        queue.pop_front();
+        writing = true;
+        lock.unlock();
+
+        if (write(image))
+            written++;
+        else
+            failed++;
+
+        lock.lock();
+        writing = false;
+        freePixels.push_back(std::move(image.pixels));
+        if (queue.empty())
+            idle.notify_all();
+    }
+}
+
+bool FrameCapture::write(Image& image)
+{
+    // GL reads bottom to top, files go top to bottom
+    size_t stride = (size_t)image.width * 4;
+    std::vector<uint8_t> row(stride);
+    for (int y = 0; y < image.height / 2; y++) {
+        uint8_t* top = image.pixels.data() + y * stride;
+        uint8_t* bottom = image.pixels.data() + (image.height - 1 - y) * stride;
+        std::memcpy(row.data(), top, stride);
+        std::memcpy(top, bottom, stride);
+        std::memcpy(bottom, row.data(), stride);
+    }
+    // the window shows the frame opaque whatever ended up in alpha
+    for (size_t i = 3; i < image.pixels.size(); i += 4)
+        image.pixels[i] = 255;
+
+    std::filesystem::path directory = std::filesystem::path(image.path).parent_path();
+    if (!directory.empty() && !std::filesystem::exists(directory)) {
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+    }
+
+    bool ok;
+    if (std::filesystem::path(image.path).extension() == ".png") {
+        ok = stbi_write_png(image.path.c_str(), image.width, image.height, 4, image.pixels.data(), (int)stride) != 0;
+    } else {
+        std::ofstream file(image.path, std::ios::binary);
+        file.write((const char*)image.pixels.data(), (std::streamsize)image.pixels.size());
+        ok = (bool)file;
+    }
+    if (!ok)
+        LOG_ERROR("ERROR::FRAME_CAPTURE::FAILED_TO_WRITE::%s", image.path.c_str());
+    return ok;
+}
@@ -0,0 +1,97 @@
+#ifndef _FRAME_CAPTURE_H_
+#define _FRAME_CAPTURE_H_
+
+#include <glad/glad.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct CaptureStats
+{
+    // readbacks started, and frames skipped because every slot was still in flight
+    uint32_t captured = 0;
+    uint32_t skipped = 0;
+    // finished readbacks dropped because the writer was too far behind
+    uint32_t dropped = 0;
+    uint32_t written = 0;
+    uint32_t failed = 0;
+    // frames waiting for the writer
+    uint32_t queued = 0;
+    // time Capture() and Update() took on the calling thread last frame
+    double mainThreadMs = 0.0;
+};
+
+// Reads frames back without stalling: Capture() has the GPU copy the color attachment into a pixel buffer of a ring
+// of READBACK_SLOTS and puts a fence behind it, and Update() maps the buffers whose fence has passed, a frame or two
+// later, copies the pixels out and hands them to a writer thread that flips and encodes them. Paths ending in .png
+// are written as PNG, anything else as the raw RGBA8 rows, top to bottom. A frame is skipped when every slot is still
+// in flight, and dropped when MAX_QUEUED frames are already waiting for the writer; neither ever waits.
+class FrameCapture
+{
+public:
+    static const int READBACK_SLOTS = 3;
+    static const int MAX_QUEUED = 8;
+
+    FrameCapture();
+    // flushes
+    ~FrameCapture();
+
+    // reads color attachment 0 of framebuffer (the back buffer for 0), which has to be RGBA8
+    bool Capture(GLuint framebuffer, int width, int height, const std::string& path);
+    // collects the finished readbacks, once per frame
+    void Update();
+    // waits for every readback and every write, the only call that blocks
+    void Flush();
+
+    const CaptureStats& GetStats();
+
+private:
+    struct Readback
+    {
+        GLuint buffer = 0;
+        GLsizeiptr capacity = 0;
+        GLsync fence = nullptr;
+        int width = 0;
+        int height = 0;
+        std::string path;
+    };
+
+    struct Image
+    {
+        std::vector<uint8_t> pixels;
+        int width = 0;
+        int height = 0;
+        std::string path;
+    };
+
+    Readback readbacks[READBACK_SLOTS];
+    // the oldest slot, the next one to fill once it is free
+    int next = 0;
+    CaptureStats stats;
+    double frameMs = 0.0;
+
+    std::thread writer;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable idle;
+    std::deque<Image> queue;
+    // pixel vectors the writer is done with, reused so the main thread doesn't allocate every frame
+    std::vector<std::vector<uint8_t>> freePixels;
+    bool writing = false;
+    bool stopping = false;
+    std::atomic<uint32_t> written{0};
+    std::atomic<uint32_t> failed{0};
+
+    // maps the slot and queues its pixels
+    void collect(Readback& slot);
+    void writeLoop();
+    bool write(Image& image);
+};
+
+#endif//_FRAME_CAPTURE_H_
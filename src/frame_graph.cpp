@@ -0,0 +1,436 @@
+#include "frame_graph.h"
+#include "gpu_profiler.h"
+#include "cpu_profiler.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+
+namespace {
+
+struct TextureFormat
+{
+    GLenum format;
+    GLenum type;
+    uint32_t bytesPerTexel;
+};
+
+TextureFormat GetTextureFormat(GLenum internalFormat)
+{
+    switch (internalFormat) {
+    case GL_RGBA16F:
+        return {GL_RGBA, GL_HALF_FLOAT, 8};
+    case GL_RGBA32F:
+        return {GL_RGBA, GL_FLOAT, 16};
+    case GL_RG16F:
+        return {GL_RG, GL_HALF_FLOAT, 4};
+    case GL_R32F:
+        return {GL_RED, GL_FLOAT, 4};
+    case GL_DEPTH_COMPONENT24:
+        return {GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, 4};
+    case GL_DEPTH_COMPONENT32F:
+        return {GL_DEPTH_COMPONENT, GL_FLOAT, 4};
+    case GL_DEPTH24_STENCIL8:
+        return {GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, 4};
+    default:
+        return {GL_RGBA, GL_UNSIGNED_BYTE, 4};
+    }
+}
+
+bool IsDepthFormat(GLenum internalFormat)
+{
+    return internalFormat == GL_DEPTH_COMPONENT24 || internalFormat == GL_DEPTH_COMPONENT32F ||
+           internalFormat == GL_DEPTH24_STENCIL8;
+}
+
+size_t GetByteSize(const FrameTextureDesc& desc)
+{
+    return (size_t)desc.width * desc.height * GetTextureFormat(desc.format).bytesPerTexel;
+}
+
+bool SameDesc(const FrameTextureDesc& a, const FrameTextureDesc& b)
+{
+    return a.width == b.width && a.height == b.height && a.format == b.format;
+}
+
+} // namespace
+
+FrameResource FramePassBuilder::Create(const std::string& name, const FrameTextureDesc& desc)
+{
+    FrameGraph::Resource resource;
+    resource.name = name;
+    resource.desc = desc;
+    graph.resources.push_back(resource);
+    return Write((FrameResource)graph.resources.size() - 1);
+}
+
+FrameResource FramePassBuilder::Read(FrameResource resource)
+{
+    graph.passes[pass].reads.push_back(resource);
+    return resource;
+}
+
+FrameResource FramePassBuilder::Write(FrameResource resource)
+{
+    graph.passes[pass].writes.push_back(resource);
+    graph.resources[resource].writers.push_back(pass);
+    return resource;
+}
+
+void FramePassBuilder::SetSideEffect()
+{
+    graph.passes[pass].sideEffect = true;
+}
+
+FrameGraph::~FrameGraph()
+{
+    for (auto& entry : framebuffers)
+        glDeleteFramebuffers(1, &entry.second);
+    for (PhysicalTexture& physical : pool)
+        glDeleteTextures(1, &physical.texture);
+}
+
+void FrameGraph::Reset()
+{
+    resources.clear();
+    passes.clear();
+    order.clear();
+}
+
+FrameResource FrameGraph::Import(const std::string& name, GLuint texture, const FrameTextureDesc& desc)
+{
+    Resource resource;
+    resource.name = name;
+    resource.desc = desc;
+    resource.imported = true;
+    resource.texture = texture;
+    resources.push_back(resource);
+    return (FrameResource)resources.size() - 1;
+}
+
+void FrameGraph::AddPass(const std::string& name, const SetupFunction& setup, const ExecuteFunction& execute)
+{
+    Pass pass;
+    pass.name = name;
+    const char*& zoneName = zoneNames[name];
+    if (!zoneName)
+        zoneName = CpuProfiler::Get().Intern(name);
+    pass.zoneName = zoneName;
+    pass.execute = execute;
+    passes.push_back(pass);
+    FramePassBuilder builder(*this, (uint32_t)passes.size() - 1);
+    setup(builder);
+}
+
+void FrameGraph::Compile()
+{
+    cullPasses();
+    sortPasses();
+    allocateTextures();
+    releaseUnused();
+}
+
+void FrameGraph::Execute()
+{
+    std::vector<FrameResource> targets;
+    for (uint32_t p : order) {
+        Pass& pass = passes[p];
+        targets.clear();
+        for (FrameResource r : pass.writes) {
+            if (std::find(targets.begin(), targets.end(), r) == targets.end())
+                targets.push_back(r);
+        }
+        if (!targets.empty()) {
+            const FrameTextureDesc& desc = resources[targets[0]].desc;
+            glBindFramebuffer(GL_FRAMEBUFFER, GetFramebuffer(targets));
+            glViewport(0, 0, desc.width, desc.height);
+        }
+        PROFILE_SCOPE(pass.zoneName);
+        if (profiler)
+            profiler->BeginScope(pass.zoneName);
+        pass.execute();
+        if (profiler)
+            profiler->EndScope();
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+GLuint FrameGraph::GetTexture(FrameResource resource) const
+{
+    const Resource& r = resources[resource];
+    if (r.imported)
+        return r.texture;
+    return r.physical >= 0 ? pool[r.physical].texture : 0;
+}
+
+GLuint FrameGraph::GetFramebuffer(const std::vector<FrameResource>& attachments)
+{
+    std::vector<GLuint> key;
+    for (FrameResource r : attachments) {
+        GLuint texture = GetTexture(r);
+        // the default framebuffer can't be mixed with textures
+        if (texture == 0)
+            return 0;
+        key.push_back(texture);
+    }
+    auto it = framebuffers.find(key);
+    if (it != framebuffers.end())
+        return it->second;
+
+    // passes call this while their own framebuffer is bound, so put the bindings back afterwards
+    GLint drawFramebuffer, readFramebuffer;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &drawFramebuffer);
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &readFramebuffer);
+    GLuint framebuffer;
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    std::vector<GLenum> drawBuffers;
+    for (FrameResource r : attachments) {
+        GLenum format = resources[r].desc.format;
+        GLenum attachment = GL_COLOR_ATTACHMENT0 + (GLenum)drawBuffers.size();
+        if (format == GL_DEPTH24_STENCIL8)
+            attachment = GL_DEPTH_STENCIL_ATTACHMENT;
+        else if (IsDepthFormat(format))
+            attachment = GL_DEPTH_ATTACHMENT;
+        else
+            drawBuffers.push_back(attachment);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, GetTexture(r), 0);
+    }
+    // a depth only framebuffer is incomplete on 3.3 unless it reads and draws nothing
+    if (drawBuffers.empty()) {
+        glDrawBuffer(GL_NONE);
+        glReadBuffer(GL_NONE);
+    } else {
+        glDrawBuffers((GLsizei)drawBuffers.size(), drawBuffers.data());
+    }
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        LOG_ERROR("ERROR::FRAME_GRAPH::FRAMEBUFFER_INCOMPLETE");
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, drawFramebuffer);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, readFramebuffer);
+    framebuffers[key] = framebuffer;
+    return framebuffer;
+}
+
+void FrameGraph::Dump(std::ostream& out) const
+{
+    out << "frame graph: " << stats.passes << " passes, " << stats.culledPasses << " culled" << std::endl;
+    for (uint32_t i = 0; i < order.size(); i++)
+        out << "  " << i << ": " << passes[order[i]].name << std::endl;
+    for (const Pass& pass : passes) {
+        if (pass.culled)
+            out << "  culled: " << pass.name << std::endl;
+    }
+    for (const Resource& r : resources) {
+        out << "  " << std::left << std::setw(16) << r.name << std::right << r.desc.width << "x" << r.desc.height;
+        if (r.imported)
+            out << " imported";
+        else if (r.physical < 0)
+            out << " unused";
+        else
+            out << " passes " << r.firstUse << "-" << r.lastUse << " -> texture " << pool[r.physical].texture;
+        out << std::endl;
+    }
+    out << "  transient " << stats.transientBytes / 1024 << " KB, allocated " << stats.allocatedBytes / 1024
+        << " KB in " << stats.physicalTextures << " textures, peak " << stats.peakBytes / 1024 << " KB" << std::endl;
+}
+
+void FrameGraph::cullPasses()
+{
+    // a pass is referenced by every resource it writes, a resource by every pass reading it. Imported resources are
+    // read outside the graph and always referenced.
+    for (Pass& pass : passes) {
+        pass.culled = false;
+        pass.refCount = (uint32_t)pass.writes.size();
+    }
+    for (Resource& r : resources)
+        r.refCount = r.imported ? 1 : 0;
+    for (const Pass& pass : passes) {
+        for (FrameResource r : pass.reads)
+            resources[r].refCount++;
+    }
+
+    std::vector<FrameResource> unreferenced;
+    auto cull = [&](Pass& pass) {
+        pass.culled = true;
+        for (FrameResource r : pass.reads) {
+            if (--resources[r].refCount == 0)
+                unreferenced.push_back(r);
+        }
+    };
+    for (Pass& pass : passes) {
+        if (pass.refCount == 0 && !pass.sideEffect)
+            cull(pass);
+    }
+    for (FrameResource r = 0; r < (FrameResource)resources.size(); r++) {
+        if (resources[r].refCount == 0)
+            unreferenced.push_back(r);
+    }
+    while (!unreferenced.empty()) {
+        FrameResource r = unreferenced.back();
+        unreferenced.pop_back();
+        for (uint32_t writer : resources[r].writers) {
+            Pass& pass = passes[writer];
+            if (!pass.culled && --pass.refCount == 0 && !pass.sideEffect)
+                cull(pass);
+        }
+    }
+}
+
+void FrameGraph::sortPasses()
+{
+    // a pass runs after the passes writing what it reads, and writers of one resource keep their submission order.
+    // Among the passes that are ready the earliest submitted goes first, so a graph added in a valid order stays as is.
+    size_t count = passes.size();
+    std::vector<std::vector<uint32_t>> successors(count);
+    std::vector<uint32_t> predecessors(count, 0);
+    auto addEdge = [&](uint32_t from, uint32_t to) {
+        if (from == to || passes[from].culled || passes[to].culled)
+            return;
+        successors[from].push_back(to);
+        predecessors[to]++;
+    };
+    for (uint32_t p = 0; p < count; p++) {
+        for (FrameResource r : passes[p].reads) {
+            for (uint32_t writer : resources[r].writers)
+                addEdge(writer, p);
+        }
+    }
+    for (const Resource& r : resources) {
+        for (size_t i = 1; i < r.writers.size(); i++)
+            addEdge(r.writers[i - 1], r.writers[i]);
+    }
+
+    order.clear();
+    std::vector<uint32_t> ready;
+    for (uint32_t p = 0; p < count; p++) {
+        if (!passes[p].culled && predecessors[p] == 0)
+            ready.push_back(p);
+    }
+    while (!ready.empty()) {
+        auto next = std::min_element(ready.begin(), ready.end());
+        uint32_t p = *next;
+        ready.erase(next);
+        order.push_back(p);
+        for (uint32_t s : successors[p]) {
+            if (--predecessors[s] == 0)
+                ready.push_back(s);
+        }
+    }
+
+    uint32_t alive = 0;
+    for (const Pass& pass : passes)
+        alive += pass.culled ? 0 : 1;
+    if (order.size() != alive) {
+        LOG_ERROR("ERROR::FRAME_GRAPH::CYCLE_BETWEEN_PASSES");
+        order.clear();
+        for (uint32_t p = 0; p < count; p++) {
+            if (!passes[p].culled)
+                order.push_back(p);
+        }
+    }
+}
+
+void FrameGraph::allocateTextures()
+{
+    stats = FrameGraphStats();
+    stats.passes = (uint32_t)passes.size();
+    for (const Pass& pass : passes)
+        stats.culledPasses += pass.culled ? 1 : 0;
+
+    for (Resource& r : resources) {
+        r.firstUse = UINT32_MAX;
+        r.lastUse = 0;
+        r.physical = -1;
+    }
+    for (uint32_t i = 0; i < order.size(); i++) {
+        const Pass& pass = passes[order[i]];
+        for (const std::vector<FrameResource>* list : {&pass.reads, &pass.writes}) {
+            for (FrameResource r : *list) {
+                resources[r].firstUse = std::min(resources[r].firstUse, i);
+                resources[r].lastUse = std::max(resources[r].lastUse, i);
+            }
+        }
+    }
+
+    // transient resources in order of their first use, each takes the first matching texture that is free by then
+    std::vector<FrameResource> transients;
+    for (FrameResource r = 0; r < (FrameResource)resources.size(); r++) {
+        if (!resources[r].imported && resources[r].firstUse != UINT32_MAX)
+            transients.push_back(r);
+    }
+    std::stable_sort(transients.begin(), transients.end(), [this](FrameResource a, FrameResource b) {
+        return resources[a].firstUse < resources[b].firstUse;
+    });
+    for (PhysicalTexture& physical : pool)
+        physical.busyUntil = -1;
+    for (FrameResource r : transients) {
+        Resource& resource = resources[r];
+        for (size_t i = 0; i < pool.size(); i++) {
+            if (pool[i].busyUntil < (int)resource.firstUse && SameDesc(pool[i].desc, resource.desc)) {
+                resource.physical = (int)i;
+                break;
+            }
+        }
+        if (resource.physical < 0) {
+            PhysicalTexture physical;
+            physical.desc = resource.desc;
+            TextureFormat format = GetTextureFormat(resource.desc.format);
+            glGenTextures(1, &physical.texture);
+            glBindTexture(GL_TEXTURE_2D, physical.texture);
+            glTexImage2D(GL_TEXTURE_2D, 0, resource.desc.format, resource.desc.width, resource.desc.height, 0,
+                         format.format, format.type, nullptr);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+            glBindTexture(GL_TEXTURE_2D, 0);
+            pool.push_back(physical);
+            resource.physical = (int)pool.size() - 1;
+        }
+        PhysicalTexture& physical = pool[resource.physical];
+        if (physical.busyUntil < 0) {
+            stats.physicalTextures++;
+            stats.allocatedBytes += GetByteSize(physical.desc);
+        }
+        physical.busyUntil = (int)resource.lastUse;
+        physical.unusedFrames = 0;
+        stats.transientTextures++;
+        stats.transientBytes += GetByteSize(resource.desc);
+    }
+
+    for (uint32_t i = 0; i < order.size(); i++) {
+        size_t live = 0;
+        for (FrameResource r : transients) {
+            if (resources[r].firstUse <= i && i <= resources[r].lastUse)
+                live += GetByteSize(resources[r].desc);
+        }
+        stats.peakBytes = std::max(stats.peakBytes, live);
+    }
+}
+
+void FrameGraph::releaseUnused()
+{
+    for (size_t i = 0; i < pool.size();) {
+        PhysicalTexture& physical = pool[i];
+        if (physical.busyUntil >= 0 || ++physical.unusedFrames <= maxUnusedFrames) {
+            i++;
+            continue;
+        }
+        for (auto it = framebuffers.begin(); it != framebuffers.end();) {
+            if (std::find(it->first.begin(), it->first.end(), physical.texture) != it->first.end()) {
+                glDeleteFramebuffers(1, &it->second);
+                it = framebuffers.erase(it);
+            } else {
+                it++;
+            }
+        }
+        glDeleteTextures(1, &physical.texture);
+        // resources point into the pool by index
+        for (Resource& r : resources) {
+            if (r.physical > (int)i)
+                r.physical--;
+        }
+        pool.erase(pool.begin() + i);
+    }
+}
@@ -0,0 +1,155 @@
+#ifndef _FRAME_GRAPH_H_
+#define _FRAME_GRAPH_H_
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+typedef uint32_t FrameResource;
+const FrameResource INVALID_FRAME_RESOURCE = UINT32_MAX;
+
+struct FrameTextureDesc
+{
+    int width = 0;
+    int height = 0;
+    // sized internal format, a depth format makes it the depth attachment
+    GLenum format = GL_RGBA8;
+};
+
+struct FrameGraphStats
+{
+    uint32_t passes = 0;
+    uint32_t culledPasses = 0;
+    uint32_t transientTextures = 0;
+    // textures actually backing the transient ones after aliasing
+    uint32_t physicalTextures = 0;
+    // every transient texture on its own, what aliasing allocated, and the most that is alive at any pass
+    size_t transientBytes = 0;
+    size_t allocatedBytes = 0;
+    size_t peakBytes = 0;
+};
+
+class FrameGraph;
+class GpuProfiler;
+
+// handed to the setup function of a pass to declare what the pass touches
+class FramePassBuilder
+{
+public:
+    // a transient texture, it only exists from the first to the last pass using it
+    FrameResource Create(const std::string& name, const FrameTextureDesc& desc);
+    FrameResource Read(FrameResource resource);
+    // written textures are the render targets of the pass, attached in the order they are declared
+    FrameResource Write(FrameResource resource);
+    // keeps the pass even if nothing reads what it writes
+    void SetSideEffect();
+
+private:
+    friend class FrameGraph;
+    FramePassBuilder(FrameGraph& graph, uint32_t pass) : graph(graph), pass(pass) {}
+
+    FrameGraph& graph;
+    uint32_t pass;
+};
+
+// Describes a frame as passes that declare the textures they read and write, rebuilt every frame. Compile() culls the
+// passes whose output nobody reads (unless they have side effects), orders the rest so a pass runs after every pass
+// writing what it reads, and backs the transient textures with a pool of GL textures: two transient textures with the
+// same description whose lifetimes don't overlap share one GL texture. Execute() binds a framebuffer with each pass's
+// written textures and calls the pass. Textures and framebuffers are kept from frame to frame and only released
+// after they went unused for a while.
+//
+// Imported textures live outside the graph and are never aliased, texture 0 stands for the default framebuffer.
+class FrameGraph
+{
+public:
+    typedef std::function<void(FramePassBuilder&)> SetupFunction;
+    typedef std::function<void()> ExecuteFunction;
+
+    // pool entries unused for this many frames are deleted
+    uint32_t maxUnusedFrames = 60;
+
+    ~FrameGraph();
+
+    // forgets the passes and resources of the last frame
+    void Reset();
+    FrameResource Import(const std::string& name, GLuint texture, const FrameTextureDesc& desc);
+    // the setup function runs right away, execute during Execute()
+    void AddPass(const std::string& name, const SetupFunction& setup, const ExecuteFunction& execute);
+    void Compile();
+    void Execute();
+
+    // only valid for passes that were not culled, from Compile() on
+    GLuint GetTexture(FrameResource resource) const;
+    const FrameTextureDesc& GetDesc(FrameResource resource) const { return resources[resource].desc; }
+    // a framebuffer with the given textures attached, cached
+    GLuint GetFramebuffer(const std::vector<FrameResource>& attachments);
+
+    // times every executed pass as a gpu scope of its name
+    void SetProfiler(GpuProfiler* gpuProfiler) { profiler = gpuProfiler; }
+
+    const FrameGraphStats& GetStats() const { return stats; }
+    // passes in execution order, culled ones and the texture each transient resource was given
+    void Dump(std::ostream& out) const;
+
+private:
+    friend class FramePassBuilder;
+
+    struct Resource
+    {
+        std::string name;
+        FrameTextureDesc desc;
+        bool imported = false;
+        GLuint texture = 0;
+        std::vector<uint32_t> writers;
+        uint32_t refCount = 0;
+        // positions in the execution order, firstUse > lastUse when no pass uses it
+        uint32_t firstUse = UINT32_MAX;
+        uint32_t lastUse = 0;
+        int physical = -1;
+    };
+
+    struct Pass
+    {
+        std::string name;
+        // the cpu profiler's copy of the name, cpu zones and gpu scopes keep the pointer
+        const char* zoneName = nullptr;
+        ExecuteFunction execute;
+        std::vector<FrameResource> reads;
+        std::vector<FrameResource> writes;
+        bool sideEffect = false;
+        bool culled = false;
+        uint32_t refCount = 0;
+    };
+
+    struct PhysicalTexture
+    {
+        GLuint texture = 0;
+        FrameTextureDesc desc;
+        // execution position of the last pass using it this frame, -1 when free
+        int busyUntil = -1;
+        uint32_t unusedFrames = 0;
+    };
+
+    std::vector<Resource> resources;
+    std::vector<Pass> passes;
+    std::vector<uint32_t> order;
+    std::vector<PhysicalTexture> pool;
+    std::map<std::vector<GLuint>, GLuint> framebuffers;
+    // interned zone names by pass name, kept over Reset() so the profiler is only asked once per name
+    std::map<std::string, const char*> zoneNames;
+    FrameGraphStats stats;
+    GpuProfiler* profiler = nullptr;
+
+    void cullPasses();
+    void sortPasses();
+    void allocateTextures();
+    void releaseUnused();
+};
+
+#endif//_FRAME_GRAPH_H_
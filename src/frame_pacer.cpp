@@ -0,0 +1,140 @@
+#include "frame_pacer.h"
+
+#include <algorithm>
+#include <thread>
+
+namespace {
+
+double MsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+FramePacer::FramePacer()
+{
+    for (Frame& frame : frames)
+        glGenQueries(1, &frame.query);
+}
+
+FramePacer::~FramePacer()
+{
+    for (Frame& frame : frames) {
+        if (frame.fence)
+            glDeleteSync(frame.fence);
+        glDeleteQueries(1, &frame.query);
+    }
+}
+
+void FramePacer::WaitForFrames(double refreshMs)
+{
+    auto start = std::chrono::steady_clock::now();
+    // oldest first, the frames are fenced in ring order
+    const int slots = MAX_FRAMES_IN_FLIGHT + 1;
+    int inFlight = 0;
+    for (int i = 1; i <= slots; i++) {
+        Frame& frame = frames[(current + i) % slots];
+        if (frame.pending && !retire(frame, false))
+            inFlight++;
+    }
+    if (enabled) {
+        int limit = std::max(1, std::min(maxFramesInFlight, (int)MAX_FRAMES_IN_FLIGHT));
+        for (int i = 1; i <= slots && inFlight >= limit; i++) {
+            Frame& frame = frames[(current + i) % slots];
+            if (frame.pending) {
+                retire(frame, true);
+                inFlight--;
+            }
+        }
+    }
+    stats.framesInFlight = inFlight;
+    stats.waitMs = MsSince(start);
+
+    stats.sleepMs = 0.0;
+    if (!enabled || !sleepBeforeInput || refreshMs <= 0.0 || !hasSwapped)
+        return;
+    // the next vsync after the last swap returned, minus what the frame is expected to need
+    double untilVsync = refreshMs - MsSince(lastSwap);
+    while (untilVsync < 0.0)
+        untilVsync += refreshMs;
+    double sleepMs = untilVsync - stats.predictedMs - marginMs;
+    if (sleepMs > 0.0) {
+        auto sleepStart = std::chrono::steady_clock::now();
+        std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(sleepMs));
+        stats.sleepMs = MsSince(sleepStart);
+    }
+}
+
+void FramePacer::MarkInput()
+{
+    glGetInteger64v(GL_TIMESTAMP, &inputTime);
+}
+
+void FramePacer::EndRender()
+{
+    Frame& frame = frames[current];
+    // unpaced nothing waits on the GPU, a frame still running when the ring wraps around is left out of the stats
+    if (frame.pending && !retire(frame, enabled))
+        drop(frame);
+    glQueryCounter(frame.query, GL_TIMESTAMP);
+}
+
+void FramePacer::EndFrame()
+{
+    lastSwap = std::chrono::steady_clock::now();
+    hasSwapped = true;
+
+    Frame& frame = frames[current];
+    if (enabled) {
+        frame.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        // the fence has to reach the GPU for a later wait on it to ever return
+        glFlush();
+    }
+    frame.inputTime = inputTime;
+    frame.pending = true;
+    current = (current + 1) % (MAX_FRAMES_IN_FLIGHT + 1);
+}
+
+bool FramePacer::retire(Frame& frame, bool wait)
+{
+    if (frame.fence) {
+        GLenum status = glClientWaitSync(frame.fence, 0, wait ? GL_TIMEOUT_IGNORED : 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+            return false;
+    } else {
+        // unfenced frames are never waited for, the query tells whether the GPU got to the end of the frame
+        GLint available = 0;
+        glGetQueryObjectiv(frame.query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            return false;
+    }
+    drop(frame);
+
+    GLuint64 doneTime = 0;
+    glGetQueryObjectui64v(frame.query, GL_QUERY_RESULT, &doneTime);
+    double latencyMs = (double)((int64_t)doneTime - frame.inputTime) / 1.0e6;
+    if (frame.inputTime == 0 || latencyMs < 0.0)
+        return true;
+    history[historyNext] = latencyMs;
+    historyNext = (historyNext + 1) % HISTORY_SIZE;
+    historyCount = std::min(historyCount + 1, (int)HISTORY_SIZE);
+
+    double sum = 0.0;
+    stats.maxLatencyMs = 0.0;
+    for (int i = 0; i < historyCount; i++) {
+        sum += history[i];
+        stats.maxLatencyMs = std::max(stats.maxLatencyMs, history[i]);
+    }
+    stats.latencyMs = sum / historyCount;
+    stats.predictedMs = stats.maxLatencyMs;
+    return true;
+}
+
+void FramePacer::drop(Frame& frame)
+{
+    if (frame.fence)
+        glDeleteSync(frame.fence);
+    frame.fence = nullptr;
+    frame.pending = false;
+}
@@ -0,0 +1,82 @@
+#ifndef _FRAME_PACER_H_
+#define _FRAME_PACER_H_
+
+#include <glad/glad.h>
+
+#include <chrono>
+#include <cstdint>
+
+struct FramePacingStats
+{
+    // from the input being sampled to the GPU being done drawing the frame, on the GPU's clock. Presenting adds up
+    // to a refresh on top, which nothing here can see.
+    double latencyMs = 0.0;
+    double maxLatencyMs = 0.0;
+    // time spent waiting on the fence and sleeping before input, last frame
+    double waitMs = 0.0;
+    double sleepMs = 0.0;
+    // how long a frame is expected to take from input to done, what the sleep leaves room for
+    double predictedMs = 0.0;
+    int framesInFlight = 0;
+};
+
+// Keeps the CPU from queueing frames ahead of the GPU, where every queued frame is a refresh of extra latency. Each
+// frame ends with a fence, and WaitForFrames() blocks until no more than maxFramesInFlight - 1 earlier frames are
+// still on the GPU. With sleepBeforeInput the pacer also sleeps until just before the next vsync less the predicted
+// frame time, the largest input-to-done time of the last HISTORY_SIZE frames plus a margin, so input is sampled as
+// late as the frame can afford. Latency is measured from a GL_TIMESTAMP taken when input is sampled to a timestamp
+// query after the frame's last draw. Disabled, the pacer neither fences nor waits and only reads the queries that are
+// already done, for the stats.
+class FramePacer
+{
+public:
+    static const int MAX_FRAMES_IN_FLIGHT = 3;
+    static const int HISTORY_SIZE = 60;
+
+    bool enabled = false;
+    int maxFramesInFlight = 1;
+    bool sleepBeforeInput = false;
+    float marginMs = 1.5f;
+
+    FramePacer();
+    ~FramePacer();
+
+    // at the start of the frame, waits for the fences and sleeps if asked to
+    void WaitForFrames(double refreshMs);
+    // right before input is read
+    void MarkInput();
+    // after the frame's last draw and before the swap, which may wait for vsync and isn't part of the frame's cost
+    void EndRender();
+    // after the swap, fences the frame when enabled
+    void EndFrame();
+
+    const FramePacingStats& GetStats() const { return stats; }
+
+private:
+    struct Frame
+    {
+        GLsync fence = nullptr;
+        GLuint query = 0;
+        GLint64 inputTime = 0;
+        bool pending = false;
+    };
+
+    Frame frames[MAX_FRAMES_IN_FLIGHT + 1];
+    int current = 0;
+    GLint64 inputTime = 0;
+    std::chrono::steady_clock::time_point lastSwap;
+    bool hasSwapped = false;
+
+    double history[HISTORY_SIZE] = {};
+    int historyCount = 0;
+    int historyNext = 0;
+    FramePacingStats stats;
+
+    // collects the frame's latency once its fence passed, waits for it when wait is set. Frames without a fence are
+    // never waited for.
+    bool retire(Frame& frame, bool wait);
+    // frees the frame's slot without collecting its latency
+    void drop(Frame& frame);
+};
+
+#endif//_FRAME_PACER_H_
@@ -0,0 +1,248 @@
+#include "gl_call_counter.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <cstdarg>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+#ifdef GL_CALL_STATS
+// bytes per pixel of client data in the given format and type
+uint64_t PixelSize(GLenum format, GLenum type)
+{
+    switch (type) {
+    case GL_UNSIGNED_INT_24_8:
+    case GL_UNSIGNED_INT_8_8_8_8:
+    case GL_UNSIGNED_INT_8_8_8_8_REV:
+    case GL_UNSIGNED_INT_2_10_10_10_REV:
+    case GL_UNSIGNED_INT_10F_11F_11F_REV:
+        return 4;
+    case GL_UNSIGNED_SHORT_5_6_5:
+    case GL_UNSIGNED_SHORT_4_4_4_4:
+    case GL_UNSIGNED_SHORT_5_5_5_1:
+        return 2;
+    case GL_FLOAT_32_UNSIGNED_INT_24_8_REV:
+        return 8;
+    }
+    uint64_t components = 4;
+    switch (format) {
+    case GL_RED:
+    case GL_RED_INTEGER:
+    case GL_DEPTH_COMPONENT:
+    case GL_STENCIL_INDEX:
+        components = 1;
+        break;
+    case GL_RG:
+    case GL_RG_INTEGER:
+    case GL_DEPTH_STENCIL:
+        components = 2;
+        break;
+    case GL_RGB:
+    case GL_BGR:
+    case GL_RGB_INTEGER:
+        components = 3;
+        break;
+    }
+    uint64_t size = 1;
+    switch (type) {
+    case GL_SHORT:
+    case GL_UNSIGNED_SHORT:
+    case GL_HALF_FLOAT:
+        size = 2;
+        break;
+    case GL_INT:
+    case GL_UNSIGNED_INT:
+    case GL_FLOAT:
+        size = 4;
+        break;
+    }
+    return components * size;
+}
+
+void IgnoreCall(const char* name, void* function, int argCount, ...)
+{
+}
+#endif
+
+} // namespace
+
+GLCallCounter& GLCallCounter::Get()
+{
+    static GLCallCounter counter;
+    return counter;
+}
+
+bool GLCallCounter::IsAvailable()
+{
+#ifdef GL_CALL_STATS
+    return true;
+#else
+    return false;
+#endif
+}
+
+GLCallCounter::CallKind GLCallCounter::classify(const char* name)
+{
+    // only the entry points that draw, glDrawBuffer(s) shares the prefix but just picks attachments
+    if (!strncmp(name, "glDrawArrays", 12) || !strncmp(name, "glDrawElements", 14) ||
+        !strncmp(name, "glDrawRangeElements", 19) || !strncmp(name, "glMultiDraw", 11))
+        return CALL_DRAW;
+    if (!strncmp(name, "glUniform", 9) || !strncmp(name, "glProgramUniform", 16))
+        return strcmp(name, "glUniformBlockBinding") ? CALL_UNIFORM : CALL_OTHER;
+    if (!strcmp(name, "glBufferData"))
+        return CALL_BUFFER_DATA;
+    if (!strcmp(name, "glBufferSubData"))
+        return CALL_BUFFER_SUB_DATA;
+    if (!strcmp(name, "glTexImage2D"))
+        return CALL_TEX_IMAGE_2D;
+    if (!strcmp(name, "glTexSubImage2D"))
+        return CALL_TEX_SUB_IMAGE_2D;
+    if (!strcmp(name, "glTexImage3D"))
+        return CALL_TEX_IMAGE_3D;
+    if (!strcmp(name, "glTexSubImage3D"))
+        return CALL_TEX_SUB_IMAGE_3D;
+    return CALL_OTHER;
+}
+
+#ifdef GL_CALL_STATS
+
+void GLCallCounter::PreCall(const char* name, void* function, int argCount, ...)
+{
+    GLCallCounter& counter = Get();
+    auto it = counter.entryPoints.find(name);
+    if (it == counter.entryPoints.end()) {
+        it = counter.entryPoints.emplace(name, EntryPoint()).first;
+        it->second.kind = classify(name);
+    }
+    EntryPoint& entry = it->second;
+    entry.calls++;
+    GLCallStats& stats = counter.stats;
+    stats.calls++;
+    if (entry.kind == CALL_OTHER)
+        return;
+    if (entry.kind == CALL_DRAW) {
+        stats.drawCalls++;
+        return;
+    }
+    if (entry.kind == CALL_UNIFORM) {
+        stats.uniformSets++;
+        return;
+    }
+
+    // the arguments follow the GL signatures, integer types promote to int and stay that size
+    va_list args;
+    va_start(args, argCount);
+    switch (entry.kind) {
+    case CALL_BUFFER_DATA: {
+        va_arg(args, GLenum);
+        GLsizeiptr size = va_arg(args, GLsizeiptr);
+        const void* data = va_arg(args, const void*);
+        if (data)
+            stats.bufferBytes += size;
+        break;
+    }
+    case CALL_BUFFER_SUB_DATA: {
+        va_arg(args, GLenum);
+        va_arg(args, GLintptr);
+        stats.bufferBytes += va_arg(args, GLsizeiptr);
+        break;
+    }
+    case CALL_TEX_IMAGE_2D:
+    case CALL_TEX_SUB_IMAGE_2D:
+    case CALL_TEX_IMAGE_3D:
+    case CALL_TEX_SUB_IMAGE_3D: {
+        // (target, level, internalformat | xoffset, [yoffset, [zoffset,]] width, height, [depth,] [border,] format,
+        // type, pixels)
+        bool sub = entry.kind == CALL_TEX_SUB_IMAGE_2D || entry.kind == CALL_TEX_SUB_IMAGE_3D;
+        bool is3D = entry.kind == CALL_TEX_IMAGE_3D || entry.kind == CALL_TEX_SUB_IMAGE_3D;
+        va_arg(args, GLenum);
+        va_arg(args, GLint);
+        int skip = sub ? (is3D ? 3 : 2) : 1;
+        for (int i = 0; i < skip; i++)
+            va_arg(args, GLint);
+        uint64_t pixels = (uint64_t)va_arg(args, GLsizei);
+        pixels *= (uint64_t)va_arg(args, GLsizei);
+        if (is3D)
+            pixels *= (uint64_t)va_arg(args, GLsizei);
+        if (!sub)
+            va_arg(args, GLint);
+        GLenum format = va_arg(args, GLenum);
+        GLenum type = va_arg(args, GLenum);
+        const void* data = va_arg(args, const void*);
+        // with a pixel unpack buffer bound the pointer is an offset, the data was counted on its way into the buffer
+        GLint unpackBuffer = 0;
+        if (data)
+            glad_glGetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING, &unpackBuffer);
+        if (data && !unpackBuffer)
+            stats.textureBytes += pixels * PixelSize(format, type);
+        break;
+    }
+    default:
+        break;
+    }
+    va_end(args);
+}
+
+void GLCallCounter::Install()
+{
+    glad_set_pre_callback(&GLCallCounter::PreCall);
+    // the default post callback checks glGetError after every call, which would be counted and costs a sync
+    glad_set_post_callback(&IgnoreCall);
+}
+
+void GLCallCounter::EndFrame()
+{
+    frameStats = stats;
+    stats = GLCallStats();
+    frameCalls.clear();
+    for (auto& entry : entryPoints) {
+        if (entry.second.calls > 0)
+            frameCalls.push_back({entry.first, entry.second.calls});
+        entry.second.calls = 0;
+    }
+    std::sort(frameCalls.begin(), frameCalls.end(),
+              [](const GLEntryPointCount& a, const GLEntryPointCount& b) { return a.calls > b.calls; });
+    if (frameLog.is_open()) {
+        frameLog << frame << "," << frameStats.calls << "," << frameStats.drawCalls << "," << frameStats.uniformSets
+                 << "," << frameStats.bufferBytes << "," << frameStats.textureBytes << "\n";
+    }
+    frame++;
+}
+
+#else
+
+void GLCallCounter::Install()
+{
+}
+
+void GLCallCounter::EndFrame()
+{
+}
+
+#endif
+
+bool GLCallCounter::WriteCallsCsv(const std::string& path) const
+{
+    std::ofstream file(path);
+    if (!file) {
+        LOG_ERROR("ERROR::GL_CALL_COUNTER::FAILED_TO_WRITE::%s", path.c_str());
+        return false;
+    }
+    file << "entry_point,calls" << std::endl;
+    for (const GLEntryPointCount& count : frameCalls)
+        file << count.name << "," << count.calls << std::endl;
+    return (bool)file;
+}
+
+bool GLCallCounter::OpenFrameLog(const std::string& path)
+{
+    frameLog.open(path);
+    if (!frameLog) {
+        LOG_ERROR("ERROR::GL_CALL_COUNTER::FAILED_TO_WRITE::%s", path.c_str());
+        return false;
+    }
+    frameLog << "frame,calls,draw_calls,uniform_sets,buffer_bytes,texture_bytes" << std::endl;
+    return true;
+}
@@ -0,0 +1,90 @@
+#ifndef _GL_CALL_COUNTER_H_
+#define _GL_CALL_COUNTER_H_
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// what one frame asked of the driver
+struct GLCallStats
+{
+    uint64_t calls = 0;
+    uint64_t drawCalls = 0;
+    uint64_t uniformSets = 0;
+    // data handed to glBufferData/glBufferSubData and to glTexImage/glTexSubImage, allocations without data don't
+    // count
+    uint64_t bufferBytes = 0;
+    uint64_t textureBytes = 0;
+};
+
+struct GLEntryPointCount
+{
+    const char* name;
+    uint64_t calls;
+};
+
+// Counts the GL calls of each frame by entry point. Only built with the GL_CALL_STATS option, which also generates
+// glad with its c-debug generator: every GL function then goes through a wrapper calling a callback before the real
+// function, and Install() points that callback here. Without the option glad calls the driver directly, the
+// functions below do nothing and the counter costs nothing. Calls imgui makes through its own loader are not seen.
+class GLCallCounter
+{
+public:
+    static GLCallCounter& Get();
+    static bool IsAvailable();
+
+    // call once glad is loaded
+    void Install();
+    // takes this frame's counts as the last frame's and starts over, and logs the frame when a log is open
+    void EndFrame();
+
+    const GLCallStats& GetFrameStats() const { return frameStats; }
+    // the last frame's calls by entry point, most called first
+    const std::vector<GLEntryPointCount>& GetFrameCalls() const { return frameCalls; }
+
+    // the last frame's calls by entry point
+    bool WriteCallsCsv(const std::string& path) const;
+    // a row of frame stats per EndFrame() from now on
+    bool OpenFrameLog(const std::string& path);
+
+#ifdef GL_CALL_STATS
+    // glad's pre-call callback
+    static void PreCall(const char* name, void* function, int argCount, ...);
+#endif
+
+private:
+    enum CallKind {
+        CALL_OTHER,
+        CALL_DRAW,
+        CALL_UNIFORM,
+        CALL_BUFFER_DATA,
+        CALL_BUFFER_SUB_DATA,
+        CALL_TEX_IMAGE_2D,
+        CALL_TEX_SUB_IMAGE_2D,
+        CALL_TEX_IMAGE_3D,
+        CALL_TEX_SUB_IMAGE_3D
+    };
+
+    struct EntryPoint
+    {
+        CallKind kind = CALL_OTHER;
+        uint64_t calls = 0;
+    };
+
+    // glad passes the same name pointer on every call of an entry point
+    std::unordered_map<const char*, EntryPoint> entryPoints;
+    GLCallStats stats;
+    GLCallStats frameStats;
+    std::vector<GLEntryPointCount> frameCalls;
+    std::ofstream frameLog;
+    uint64_t frame = 0;
+
+    GLCallCounter() = default;
+    static CallKind classify(const char* name);
+};
+
+#endif//_GL_CALL_COUNTER_H_
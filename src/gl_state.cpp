@@ -0,0 +1,48 @@
+#include "gl_state.h"
+
+void GLStateCache::UseProgram(GLuint newProgram)
+{
+    if (program == newProgram) {
+        stats.redundantBinds++;
+        return;
+    }
+    glUseProgram(newProgram);
+    program = newProgram;
+    stats.programBinds++;
+}
+
+void GLStateCache::BindVertexArray(GLuint newVao)
+{
+    if (vao == newVao) {
+        stats.redundantBinds++;
+        return;
+    }
+    glBindVertexArray(newVao);
+    vao = newVao;
+    stats.vaoBinds++;
+}
+
+void GLStateCache::BindTexture(GLuint unit, GLuint texture)
+{
+    if (unit < MAX_TEXTURE_UNITS && textures[unit] == texture) {
+        stats.redundantBinds++;
+        return;
+    }
+    if (activeUnit != unit) {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        activeUnit = unit;
+    }
+    glBindTexture(GL_TEXTURE_2D, texture);
+    if (unit < MAX_TEXTURE_UNITS)
+        textures[unit] = texture;
+    stats.textureBinds++;
+}
+
+void GLStateCache::Invalidate()
+{
+    program = UINT32_MAX;
+    vao = UINT32_MAX;
+    activeUnit = UINT32_MAX;
+    for (GLuint& texture : textures)
+        texture = UINT32_MAX;
+}
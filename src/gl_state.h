@@ -0,0 +1,43 @@
+#ifndef _GL_STATE_H_
+#define _GL_STATE_H_
+
+#include <glad/glad.h>
+
+#include <cstdint>
+
+// binds that reached the driver and binds the cache dropped because the object was already bound
+struct GLStateStats
+{
+    uint32_t programBinds = 0;
+    uint32_t vaoBinds = 0;
+    uint32_t textureBinds = 0;
+    uint32_t redundantBinds = 0;
+};
+
+// Remembers the currently bound program, VAO and 2D textures so repeated binds of the same object never reach the
+// driver. Code that binds GL objects behind its back (imgui, the hi-z passes, ...) has to be followed by Invalidate().
+class GLStateCache
+{
+public:
+    static const int MAX_TEXTURE_UNITS = 16;
+
+    GLStateCache() { Invalidate(); }
+
+    void UseProgram(GLuint program);
+    void BindVertexArray(GLuint vao);
+    void BindTexture(GLuint unit, GLuint texture);
+    void Invalidate();
+
+    void ResetStats() { stats = GLStateStats(); }
+    const GLStateStats& GetStats() const { return stats; }
+
+private:
+    // UINT32_MAX means unknown, so the next bind always goes through
+    GLuint program = UINT32_MAX;
+    GLuint vao = UINT32_MAX;
+    GLuint activeUnit = UINT32_MAX;
+    GLuint textures[MAX_TEXTURE_UNITS];
+    GLStateStats stats;
+};
+
+#endif//_GL_STATE_H_
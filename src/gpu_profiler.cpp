@@ -0,0 +1,128 @@
+#include "gpu_profiler.h"
+#include "profiler_ui.h"
+
+#include <imgui.h>
+
+#include <algorithm>
+
+GpuProfiler::~GpuProfiler()
+{
+    for (Frame& frame : frames) {
+        if (!frame.queries.empty())
+            glDeleteQueries((GLsizei)frame.queries.size(), frame.queries.data());
+    }
+}
+
+void GpuProfiler::BeginFrame()
+{
+    if (!enabled)
+        return;
+    Frame& frame = frames[current];
+    if (frame.pending) {
+        // queries finish in order, once the frame's end is available everything before it is too
+        GLint available = 0;
+        glGetQueryObjectiv(frame.queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available)
+            resolve(frame);
+        else
+            droppedFrames++;
+        frame.pending = false;
+    }
+    frame.usedQueries = 0;
+    frame.scopes.clear();
+    openScopes.clear();
+    timestamp(frame);
+    timestamp(frame);
+    glQueryCounter(frame.queries[0], GL_TIMESTAMP);
+    inFrame = true;
+}
+
+void GpuProfiler::EndFrame()
+{
+    if (!inFrame)
+        return;
+    // scopes left open end with the frame
+    while (!openScopes.empty())
+        EndScope();
+    Frame& frame = frames[current];
+    glQueryCounter(frame.queries[1], GL_TIMESTAMP);
+    frame.pending = true;
+    inFrame = false;
+    current = (current + 1) % FRAME_LATENCY;
+}
+
+void GpuProfiler::BeginScope(const char* name)
+{
+    if (!inFrame)
+        return;
+    Frame& frame = frames[current];
+    Scope scope;
+    scope.name = name;
+    scope.depth = (int)openScopes.size();
+    scope.beginQuery = timestamp(frame);
+    glQueryCounter(frame.queries[scope.beginQuery], GL_TIMESTAMP);
+    openScopes.push_back((int)frame.scopes.size());
+    frame.scopes.push_back(scope);
+}
+
+void GpuProfiler::EndScope()
+{
+    if (!inFrame || openScopes.empty())
+        return;
+    Frame& frame = frames[current];
+    Scope& scope = frame.scopes[openScopes.back()];
+    openScopes.pop_back();
+    scope.endQuery = timestamp(frame);
+    glQueryCounter(frame.queries[scope.endQuery], GL_TIMESTAMP);
+}
+
+int GpuProfiler::timestamp(Frame& frame)
+{
+    if (frame.usedQueries == (int)frame.queries.size()) {
+        GLuint query;
+        glGenQueries(1, &query);
+        frame.queries.push_back(query);
+    }
+    return frame.usedQueries++;
+}
+
+void GpuProfiler::resolve(Frame& frame)
+{
+    if (paused)
+        return;
+    std::vector<GLuint64> times(frame.usedQueries);
+    for (int i = 0; i < frame.usedQueries; i++)
+        glGetQueryObjectui64v(frame.queries[i], GL_QUERY_RESULT, &times[i]);
+    auto toMs = [&](int query) { return (double)(int64_t)(times[query] - times[0]) / 1.0e6; };
+    frameMs = toMs(1);
+    results.clear();
+    for (const Scope& scope : frame.scopes) {
+        double start = toMs(scope.beginQuery);
+        results.push_back({scope.name, scope.depth, start, toMs(scope.endQuery) - start});
+    }
+}
+
+void GpuProfiler::DrawWindow(bool* open)
+{
+    if (!ImGui::Begin("GPU profiler", open)) {
+        ImGui::End();
+        return;
+    }
+    ImGui::Checkbox("Enabled", &enabled);
+    ImGui::SameLine();
+    ImGui::Checkbox("Pause", &paused);
+    ImGui::Text("gpu frame %.3f ms, %u frames dropped", frameMs, droppedFrames);
+
+    // flame graph: the frame spans the width, a row per nesting level
+    int maxDepth = 0;
+    std::vector<FlameBar> bars;
+    for (const GpuScopeResult& r : results) {
+        maxDepth = std::max(maxDepth, r.depth);
+        bars.push_back({r.name, (uint32_t)r.depth, r.startMs, r.durationMs});
+    }
+    DrawFlameLane("flame", bars, maxDepth + 1, frameMs);
+
+    for (const GpuScopeResult& r : results)
+        ImGui::Text("%*s%-*s %8.3f ms", r.depth * 2, "", 24 - r.depth * 2, r.name, r.durationMs);
+    ImGui::End();
+}
@@ -0,0 +1,91 @@
+#ifndef _GPU_PROFILER_H_
+#define _GPU_PROFILER_H_
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// one finished scope, times in milliseconds from the start of its frame
+struct GpuScopeResult
+{
+    const char* name;
+    int depth;
+    double startMs;
+    double durationMs;
+};
+
+// GPU time of nested named scopes, from a GL_TIMESTAMP query at each end of every scope (timestamps nest where
+// GL_TIME_ELAPSED queries can't). Every frame gets its own set of queries from a ring of FRAME_LATENCY frames and is
+// read once the ring comes back around to it; a frame whose queries still aren't done by then is dropped rather than
+// waited for, so the profiler never stalls the pipeline. The results are those of the newest finished frame.
+//
+// Scope names are kept as pointers, use string literals or CpuProfiler::Intern().
+class GpuProfiler
+{
+public:
+    static const int FRAME_LATENCY = 4;
+
+    bool enabled = true;
+    // keeps showing the current results
+    bool paused = false;
+
+    ~GpuProfiler();
+
+    void BeginFrame();
+    void EndFrame();
+    // scopes only count between BeginFrame() and EndFrame(), and have to be closed in reverse order
+    void BeginScope(const char* name);
+    void EndScope();
+
+    const std::vector<GpuScopeResult>& GetResults() const { return results; }
+    double GetFrameMs() const { return frameMs; }
+    uint32_t GetDroppedFrames() const { return droppedFrames; }
+
+    // the results as a flame graph and a list, in their own imgui window, open is cleared by its close button
+    void DrawWindow(bool* open = nullptr);
+
+private:
+    struct Scope
+    {
+        const char* name;
+        int depth;
+        int beginQuery;
+        int endQuery = -1;
+    };
+
+    struct Frame
+    {
+        std::vector<GLuint> queries;
+        int usedQueries = 0;
+        // the frame's own begin and end are the first two queries
+        std::vector<Scope> scopes;
+        bool pending = false;
+    };
+
+    Frame frames[FRAME_LATENCY];
+    int current = 0;
+    bool inFrame = false;
+    std::vector<int> openScopes;
+
+    std::vector<GpuScopeResult> results;
+    double frameMs = 0.0;
+    uint32_t droppedFrames = 0;
+
+    int timestamp(Frame& frame);
+    void resolve(Frame& frame);
+};
+
+// profiles the enclosing block
+class GpuScope
+{
+public:
+    GpuScope(GpuProfiler& profiler, const char* name) : profiler(profiler) { profiler.BeginScope(name); }
+    ~GpuScope() { profiler.EndScope(); }
+
+private:
+    GpuProfiler& profiler;
+};
+
+#endif//_GPU_PROFILER_H_
@@ -0,0 +1,112 @@
+#include "headless_context.h"
+#include "logger.h"
+
+#ifdef HEADLESS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+HeadlessContext::~HeadlessContext()
+{
+    Destroy();
+}
+
+#ifdef HEADLESS_EGL
+
+bool HeadlessContext::Create(int width, int height)
+{
+    EGLDisplay eglDisplay = EGL_NO_DISPLAY;
+    auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay)
+        eglDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    if (eglDisplay == EGL_NO_DISPLAY)
+        eglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    EGLint major, minor;
+    if (eglDisplay == EGL_NO_DISPLAY || !eglInitialize(eglDisplay, &major, &minor)) {
+        LOG_ERROR("ERROR::HEADLESS::FAILED_TO_INITIALIZE_EGL::%x", (unsigned)eglGetError());
+        return false;
+    }
+    display = eglDisplay;
+    eglBindAPI(EGL_OPENGL_API);
+
+    // nothing is drawn to a surface, any config that does desktop GL will do, or none at all where it is allowed
+    EGLint configAttributes[] = {EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE};
+    EGLConfig config = nullptr;
+    EGLint configCount = 0;
+    eglChooseConfig(eglDisplay, configAttributes, &config, 1, &configCount);
+    EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    EGLContext eglContext = eglCreateContext(eglDisplay, configCount > 0 ? config : EGL_NO_CONFIG_KHR,
+                                             EGL_NO_CONTEXT, contextAttributes);
+    if (eglContext == EGL_NO_CONTEXT) {
+        LOG_ERROR("ERROR::HEADLESS::FAILED_TO_CREATE_CONTEXT::%x", (unsigned)eglGetError());
+        Destroy();
+        return false;
+    }
+    context = eglContext;
+    if (!eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, eglContext)) {
+        LOG_ERROR("ERROR::HEADLESS::SURFACELESS_CONTEXT_NOT_SUPPORTED");
+        Destroy();
+        return false;
+    }
+    if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+        LOG_ERROR("ERROR::HEADLESS::FAILED_TO_INITIALIZE_GLAD");
+        Destroy();
+        return false;
+    }
+
+    glGenTextures(1, &colorTexture);
+    glBindTexture(GL_TEXTURE_2D, colorTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture, 0);
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (!complete) {
+        LOG_ERROR("ERROR::HEADLESS::FRAMEBUFFER_INCOMPLETE");
+        Destroy();
+        return false;
+    }
+    return true;
+}
+
+void HeadlessContext::Destroy()
+{
+    if (context) {
+        // glad may not have gotten as far as loading these
+        if (framebuffer)
+            glDeleteFramebuffers(1, &framebuffer);
+        if (colorTexture)
+            glDeleteTextures(1, &colorTexture);
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(display, context);
+    }
+    if (display)
+        eglTerminate(display);
+    framebuffer = 0;
+    colorTexture = 0;
+    context = nullptr;
+    display = nullptr;
+}
+
+#else
+
+bool HeadlessContext::Create(int width, int height)
+{
+    LOG_ERROR("ERROR::HEADLESS::BUILT_WITHOUT_HEADLESS_EGL");
+    return false;
+}
+
+void HeadlessContext::Destroy()
+{
+}
+
+#endif
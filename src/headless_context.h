@@ -0,0 +1,31 @@
+#ifndef _HEADLESS_CONTEXT_H_
+#define _HEADLESS_CONTEXT_H_
+
+#include <glad/glad.h>
+
+// An OpenGL 3.3 core context without a window or a display, for --headless. EGL is asked for Mesa's surfaceless
+// platform first, which renders with llvmpipe when there is no GPU, and for the default display otherwise. Without a
+// surface there is no default framebuffer either, so the context comes with a color texture the frame ends up in.
+// Only built with the HEADLESS_EGL option, Create() fails otherwise.
+class HeadlessContext
+{
+public:
+    ~HeadlessContext();
+
+    // creates the context, makes it current, loads the GL functions and creates the target
+    bool Create(int width, int height);
+    void Destroy();
+
+    GLuint GetColorTexture() const { return colorTexture; }
+    // the target as a framebuffer, for whatever draws after the frame graph
+    GLuint GetFramebuffer() const { return framebuffer; }
+
+private:
+    // EGLDisplay and EGLContext, kept opaque so egl.h stays out of here
+    void* display = nullptr;
+    void* context = nullptr;
+    GLuint colorTexture = 0;
+    GLuint framebuffer = 0;
+};
+
+#endif//_HEADLESS_CONTEXT_H_
@@ -0,0 +1,262 @@
+#include "hiz.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+
+HiZCuller::HiZCuller()
+{
+    downsampleShader = std::make_unique<Shader>("./shader/hiz_downsample.vs", "./shader/hiz_downsample.fs");
+    cullShader = std::make_unique<Shader>("./shader/hiz_cull.vs", std::vector<const char*>{"Visibility"});
+
+    // a core profile needs a VAO bound even for the attribute-less fullscreen triangle
+    glGenVertexArrays(1, &emptyVAO);
+    glGenFramebuffers(1, &framebuffer);
+
+    glGenVertexArrays(1, &cullVAO);
+    glGenBuffers(1, &cullVBO);
+    glBindVertexArray(cullVAO);
+    glBindBuffer(GL_ARRAY_BUFFER, cullVBO);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(CullInput), (void*)offsetof(CullInput, min));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(CullInput), (void*)offsetof(CullInput, max));
+    glEnableVertexAttribArray(1);
+    glVertexAttribIPointer(2, 1, GL_UNSIGNED_INT, sizeof(CullInput), (void*)offsetof(CullInput, id));
+    glEnableVertexAttribArray(2);
+    glBindVertexArray(0);
+
+    for (auto& slot : readbacks)
+        glGenBuffers(1, &slot.buffer);
+}
+
+HiZCuller::~HiZCuller()
+{
+    releaseTextures();
+    for (auto& slot : readbacks) {
+        if (slot.fence)
+            glDeleteSync(slot.fence);
+        glDeleteBuffers(1, &slot.buffer);
+    }
+    glDeleteBuffers(1, &cullVBO);
+    glDeleteVertexArrays(1, &cullVAO);
+    glDeleteVertexArrays(1, &emptyVAO);
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteProgram(downsampleShader->ID);
+    glDeleteProgram(cullShader->ID);
+}
+
+void HiZCuller::Resize(int newWidth, int newHeight)
+{
+    if (newWidth == width && newHeight == height)
+        return;
+    releaseTextures();
+    width = newWidth;
+    height = newHeight;
+    hasPyramid = false;
+    if (width <= 0 || height <= 0)
+        return;
+    levels = (int)std::floor(std::log2((float)std::max(width, height))) + 1;
+
+    glGenTextures(1, &depthTexture);
+    glBindTexture(GL_TEXTURE_2D, depthTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, width, height, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+
+    glGenTextures(1, &pyramidTexture);
+    glBindTexture(GL_TEXTURE_2D, pyramidTexture);
+    for (int level = 0; level < levels; level++) {
+        int w = std::max(1, width >> level);
+        int h = std::max(1, height >> level);
+        glTexImage2D(GL_TEXTURE_2D, level, GL_R32F, w, h, 0, GL_RED, GL_FLOAT, nullptr);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void HiZCuller::BuildPyramid(const glm::vec3& cameraPos, const glm::vec3& cameraDir, const glm::mat4& viewProjection)
+{
+    if (width <= 0 || height <= 0)
+        return;
+
+    GLint prevFramebuffer;
+    GLint viewport[4];
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &prevFramebuffer);
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+
+    // copy the depth buffer of the framebuffer the scene was drawn to
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, prevFramebuffer);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, depthTexture);
+    glCopyTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, 0, 0, width, height);
+
+    glDisable(GL_DEPTH_TEST);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glBindVertexArray(emptyVAO);
+    downsampleShader->use();
+    downsampleShader->setInt("source", 0);
+
+    // level 0 is a plain copy, depth textures can't be render targets of a color reduction
+    downsampleShader->setBool("copyLevel", true);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, pyramidTexture, 0);
+    glViewport(0, 0, width, height);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+
+    // each level reads the previous one, restricting the sampled levels keeps it from being a feedback loop
+    downsampleShader->setBool("copyLevel", false);
+    glBindTexture(GL_TEXTURE_2D, pyramidTexture);
+    for (int level = 1; level < levels; level++) {
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level - 1);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, pyramidTexture, level);
+        glViewport(0, 0, std::max(1, width >> level), std::max(1, height >> level));
+        glDrawArrays(GL_TRIANGLES, 0, 3);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels - 1);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, prevFramebuffer);
+    glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+    if (depthTest)
+        glEnable(GL_DEPTH_TEST);
+
+    hasPyramid = true;
+    pyramidPos = cameraPos;
+    pyramidDir = cameraDir;
+    pyramidViewProjection = viewProjection;
+}
+
+void HiZCuller::Collect(const glm::vec3& cameraPos, const glm::vec3& cameraDir)
+{
+    // apply finished passes oldest first so the newest one wins
+    for (uint32_t i = 1; i <= READBACK_SLOTS; i++) {
+        Readback& slot = readbacks[(serial + i) % READBACK_SLOTS];
+        if (!slot.fence)
+            continue;
+        GLenum status = glClientWaitSync(slot.fence, 0, 0);
+        if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+            continue;
+        glDeleteSync(slot.fence);
+        slot.fence = nullptr;
+        if (slot.serial > appliedSerial)
+            apply(slot);
+    }
+
+    stats.resultAge = serial - appliedSerial;
+    stats.fallback = true;
+    if (appliedSerial > 0) {
+        float cosAngle = glm::dot(glm::normalize(cameraDir), glm::normalize(appliedDir));
+        bool moved = glm::length(cameraPos - appliedPos) > maxTranslation;
+        bool turned = cosAngle < std::cos(glm::radians(maxRotation));
+        stats.fallback = moved || turned;
+    }
+}
+
+void HiZCuller::Test(const std::vector<uint32_t>& candidates, const std::vector<AABB>& bounds)
+{
+    if (!hasPyramid || candidates.empty())
+        return;
+    Readback& slot = readbacks[(serial + 1) % READBACK_SLOTS];
+    if (slot.fence) {
+        // every slot is still in flight, skip a pass rather than stall
+        stats.skipped++;
+        return;
+    }
+
+    inputs.resize(candidates.size());
+    for (size_t i = 0; i < candidates.size(); i++) {
+        uint32_t id = candidates[i];
+        inputs[i].min = bounds[id].min;
+        inputs[i].max = bounds[id].max;
+        inputs[i].id = id;
+    }
+    GLsizeiptr outputSize = (GLsizeiptr)(candidates.size() * sizeof(uint32_t));
+
+    glBindBuffer(GL_ARRAY_BUFFER, cullVBO);
+    glBufferData(GL_ARRAY_BUFFER, inputs.size() * sizeof(CullInput), inputs.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_TRANSFORM_FEEDBACK_BUFFER, slot.buffer);
+    if (slot.capacity < outputSize) {
+        glBufferData(GL_TRANSFORM_FEEDBACK_BUFFER, outputSize, nullptr, GL_STREAM_READ);
+        slot.capacity = outputSize;
+    }
+
+    cullShader->use();
+    // the current view-projection would put the bounds where last frame's depth isn't, so an object that just came
+    // into view would be tested against whatever was drawn there before
+    cullShader->setMat4("viewProjection", pyramidViewProjection);
+    cullShader->setInt("hiz", 0);
+    cullShader->setVec2("hizSize", glm::vec2((float)width, (float)height));
+    cullShader->setInt("hizLevels", levels);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, pyramidTexture);
+    glBindVertexArray(cullVAO);
+
+    glEnable(GL_RASTERIZER_DISCARD);
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, slot.buffer);
+    glBeginTransformFeedback(GL_POINTS);
+    glDrawArrays(GL_POINTS, 0, (GLsizei)candidates.size());
+    glEndTransformFeedback();
+    glBindBufferBase(GL_TRANSFORM_FEEDBACK_BUFFER, 0, 0);
+    glDisable(GL_RASTERIZER_DISCARD);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    serial++;
+    slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    slot.count = (uint32_t)candidates.size();
+    slot.serial = serial;
+    slot.cameraPos = pyramidPos;
+    slot.cameraDir = pyramidDir;
+    stats.tested = slot.count;
+}
+
+bool HiZCuller::IsOccluded(uint32_t id) const
+{
+    if (stats.fallback || id >= occludedIn.size())
+        return false;
+    return occludedIn[id] == appliedSerial;
+}
+
+void HiZCuller::releaseTextures()
+{
+    if (depthTexture)
+        glDeleteTextures(1, &depthTexture);
+    if (pyramidTexture)
+        glDeleteTextures(1, &pyramidTexture);
+    depthTexture = 0;
+    pyramidTexture = 0;
+}
+
+void HiZCuller::apply(Readback& slot)
+{
+    glBindBuffer(GL_COPY_READ_BUFFER, slot.buffer);
+    auto words = (const uint32_t*)glMapBufferRange(GL_COPY_READ_BUFFER, 0, slot.count * sizeof(uint32_t),
+                                                   GL_MAP_READ_BIT);
+    if (!words) {
+        glBindBuffer(GL_COPY_READ_BUFFER, 0);
+        return;
+    }
+    stats.occluded = 0;
+    for (uint32_t i = 0; i < slot.count; i++) {
+        uint32_t id = words[i] & 0x7fffffffu;
+        if (words[i] & 0x80000000u)
+            continue;
+        if (id >= occludedIn.size())
+            occludedIn.resize(id + 1, 0);
+        occludedIn[id] = slot.serial;
+        stats.occluded++;
+    }
+    glUnmapBuffer(GL_COPY_READ_BUFFER);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+    appliedSerial = slot.serial;
+    appliedPos = slot.cameraPos;
+    appliedDir = slot.cameraDir;
+}
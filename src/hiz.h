@@ -0,0 +1,110 @@
+#ifndef _HIZ_H_
+#define _HIZ_H_
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "bounds.h"
+#include "shader.h"
+
+#include <memory>
+#include <vector>
+
+struct HiZStats
+{
+    // objects sent to the last occlusion pass
+    uint32_t tested = 0;
+    // objects found occluded in the result currently applied
+    uint32_t occluded = 0;
+    // occlusion passes issued since the applied result was issued
+    uint32_t resultAge = 0;
+    // passes skipped because every readback slot was still in flight
+    uint32_t skipped = 0;
+    // the applied result is ignored, either there is none yet or the camera moved too much since its depth
+    bool fallback = true;
+};
+
+// Occlusion culling against a hierarchical depth buffer. After the scene is drawn, BuildPyramid() copies the depth
+// buffer and reduces it into a mip chain that keeps the farthest depth of each footprint. Next frame, Test() projects
+// candidate bounds against that pyramid in a vertex shader and captures one visibility word per object with
+// transform feedback (so it works on GL 3.3). The bounds are projected with the view-projection the pyramid was built
+// with, not the current one, so the test asks what the depth it has can answer: whether an object was hidden last
+// frame. Results are read back a few frames later behind fences, so the CPU
+// never waits for the GPU; when the camera moved too far since the depth the result was built from, every object is
+// treated as visible.
+class HiZCuller
+{
+public:
+    // the result is dropped once the camera moved or turned more than this since its depth was captured
+    float maxTranslation = 0.5f;
+    float maxRotation = 5.0f; // degrees
+
+    HiZCuller();
+    ~HiZCuller();
+
+    void Resize(int width, int height);
+    // copies the depth of the bound framebuffer and builds the pyramid, call once the occluders are drawn with
+    // viewProjection
+    void BuildPyramid(const glm::vec3& cameraPos, const glm::vec3& cameraDir, const glm::mat4& viewProjection);
+    // applies the newest finished occlusion pass and decides whether it can be trusted for the current camera
+    void Collect(const glm::vec3& cameraPos, const glm::vec3& cameraDir);
+    // queues an occlusion pass of the candidates against the last pyramid, seen from where it was built
+    void Test(const std::vector<uint32_t>& candidates, const std::vector<AABB>& bounds);
+    bool IsOccluded(uint32_t id) const;
+
+    const HiZStats& GetStats() const { return stats; }
+
+private:
+    static const int READBACK_SLOTS = 3;
+
+    struct Readback
+    {
+        GLuint buffer = 0;
+        GLsizeiptr capacity = 0;
+        GLsync fence = nullptr;
+        uint32_t count = 0;
+        uint32_t serial = 0;
+        glm::vec3 cameraPos;
+        glm::vec3 cameraDir;
+    };
+
+    // vertex layout of the occlusion pass input
+    struct CullInput
+    {
+        glm::vec3 min;
+        glm::vec3 max;
+        uint32_t id;
+    };
+
+    int width = 0;
+    int height = 0;
+    int levels = 0;
+    GLuint depthTexture = 0;
+    GLuint pyramidTexture = 0;
+    GLuint framebuffer = 0;
+    GLuint emptyVAO = 0;
+    GLuint cullVAO = 0;
+    GLuint cullVBO = 0;
+    std::unique_ptr<Shader> downsampleShader;
+    std::unique_ptr<Shader> cullShader;
+
+    bool hasPyramid = false;
+    glm::vec3 pyramidPos;
+    glm::vec3 pyramidDir;
+    glm::mat4 pyramidViewProjection;
+
+    Readback readbacks[READBACK_SLOTS];
+    uint32_t serial = 0;
+    uint32_t appliedSerial = 0;
+    glm::vec3 appliedPos;
+    glm::vec3 appliedDir;
+    // serial of the last result that found each object occluded
+    std::vector<uint32_t> occludedIn;
+    std::vector<CullInput> inputs;
+    HiZStats stats;
+
+    void releaseTextures();
+    void apply(Readback& slot);
+};
+
+#endif//_HIZ_H_
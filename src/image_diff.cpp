@@ -0,0 +1,104 @@
+#include "image_diff.h"
+
+#include <stb/stb_image.h>
+#include <stb/stb_image_write.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+
+namespace {
+
+// squared YIQ distance of the largest difference there is, black against white
+const float MAX_YIQ_DELTA = 35215.0f;
+
+float Difference(const uint8_t* a, const uint8_t* b)
+{
+    float r = (float)a[0] - (float)b[0];
+    float g = (float)a[1] - (float)b[1];
+    float bl = (float)a[2] - (float)b[2];
+    float y = r * 0.29889531f + g * 0.58662247f + bl * 0.11448223f;
+    float i = r * 0.59597799f - g * 0.27417610f - bl * 0.32180189f;
+    float q = r * 0.21147017f - g * 0.52261711f + bl * 0.31114694f;
+    return std::sqrt((0.5053f * y * y + 0.299f * i * i + 0.1957f * q * q) / MAX_YIQ_DELTA);
+}
+
+// whether one of the 3x3 pixels of other around (x, y) is within the threshold of pixel
+bool MatchesNeighbor(const uint8_t* pixel, const Image& other, int x, int y, float threshold)
+{
+    for (int ny = std::max(y - 1, 0); ny <= std::min(y + 1, other.height - 1); ny++) {
+        for (int nx = std::max(x - 1, 0); nx <= std::min(x + 1, other.width - 1); nx++) {
+            if (Difference(pixel, &other.pixels[((size_t)ny * other.width + nx) * 4]) <= threshold)
+                return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+ImageDiffResult DiffImages(const Image& expected, const Image& actual, const ImageDiffOptions& options, Image* diff)
+{
+    ImageDiffResult result;
+    result.sizeMatches = expected.width == actual.width && expected.height == actual.height &&
+                         expected.pixels.size() == actual.pixels.size();
+    if (!result.sizeMatches)
+        return result;
+
+    if (diff) {
+        diff->width = expected.width;
+        diff->height = expected.height;
+        diff->pixels.resize(expected.pixels.size());
+    }
+    for (int y = 0; y < expected.height; y++) {
+        for (int x = 0; x < expected.width; x++) {
+            size_t offset = ((size_t)y * expected.width + x) * 4;
+            const uint8_t* e = &expected.pixels[offset];
+            const uint8_t* a = &actual.pixels[offset];
+            float difference = Difference(e, a);
+            result.maxDifference = std::max(result.maxDifference, difference);
+
+            uint8_t color[4];
+            if (difference <= options.threshold) {
+                // faded gray of the expected image, so the marked pixels stand out
+                uint8_t gray = (uint8_t)(255.0f - 0.1f * (255.0f - (0.299f * e[0] + 0.587f * e[1] + 0.114f * e[2])));
+                color[0] = color[1] = color[2] = gray;
+            } else if (MatchesNeighbor(e, actual, x, y, options.threshold) &&
+                       MatchesNeighbor(a, expected, x, y, options.threshold)) {
+                result.shiftedPixels++;
+                color[0] = 255, color[1] = 255, color[2] = 0;
+            } else {
+                result.differentPixels++;
+                color[0] = 255, color[1] = 0, color[2] = 0;
+            }
+            color[3] = 255;
+            if (diff)
+                std::memcpy(&diff->pixels[offset], color, 4);
+        }
+    }
+    size_t pixelCount = (size_t)expected.width * expected.height;
+    result.passed = result.differentPixels <= options.maxDifferentFraction * pixelCount;
+    return result;
+}
+
+bool LoadImageFile(const std::string& path, Image& image)
+{
+    int channels;
+    uint8_t* data = stbi_load(path.c_str(), &image.width, &image.height, &channels, STBI_rgb_alpha);
+    if (!data)
+        return false;
+    image.pixels.assign(data, data + (size_t)image.width * image.height * 4);
+    stbi_image_free(data);
+    return true;
+}
+
+bool SaveImageFile(const std::string& path, const Image& image)
+{
+    std::filesystem::path directory = std::filesystem::path(path).parent_path();
+    if (!directory.empty()) {
+        std::error_code error;
+        std::filesystem::create_directories(directory, error);
+    }
+    return stbi_write_png(path.c_str(), image.width, image.height, 4, image.pixels.data(), image.width * 4) != 0;
+}
@@ -0,0 +1,45 @@
+#ifndef _IMAGE_DIFF_H_
+#define _IMAGE_DIFF_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// RGBA8 pixels, rows top to bottom
+struct Image
+{
+    int width = 0;
+    int height = 0;
+    std::vector<uint8_t> pixels;
+};
+
+struct ImageDiffOptions
+{
+    // smallest perceptual difference of a pixel that counts, 0 (any) to 1 (black against white)
+    float threshold = 0.1f;
+    // share of the pixels that may differ before the images do
+    float maxDifferentFraction = 0.001f;
+};
+
+struct ImageDiffResult
+{
+    bool sizeMatches = false;
+    uint32_t differentPixels = 0;
+    // pixels that differ but match a neighbor in the other image, rasterization moving an edge by a pixel
+    uint32_t shiftedPixels = 0;
+    float maxDifference = 0.0f;
+    bool passed = false;
+};
+
+// Compares two images the way they look rather than byte for byte: the difference of two pixels is their distance in
+// YIQ space, weighted like pixelmatch does since the eye sees brightness changes before hue changes, and scaled to
+// [0, 1]. A pixel over the threshold doesn't count when both images have it within the threshold of one of its 3x3
+// neighbors in the other image, so an edge that a different rasterizer puts a pixel over doesn't fail the test.
+// Optionally fills diff with a faded copy of expected where the differing pixels are red and the shifted ones yellow.
+ImageDiffResult DiffImages(const Image& expected, const Image& actual, const ImageDiffOptions& options,
+                           Image* diff = nullptr);
+
+bool LoadImageFile(const std::string& path, Image& image);
+bool SaveImageFile(const std::string& path, const Image& image);
+
+#endif//_IMAGE_DIFF_H_
@@ -0,0 +1,35 @@
+#include "input_queue.h"
+
+bool InputQueue::Push(const InputEvent& event)
+{
+    uint32_t at = head.load(std::memory_order_relaxed);
+    if (at - tail.load(std::memory_order_acquire) == CAPACITY) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    events[at & (CAPACITY - 1)] = event;
+    // publishes the event to the consumer
+    head.store(at + 1, std::memory_order_release);
+    return true;
+}
+
+bool InputQueue::Peek(InputEvent& event) const
+{
+    uint32_t at = tail.load(std::memory_order_relaxed);
+    if (at == head.load(std::memory_order_acquire))
+        return false;
+    event = events[at & (CAPACITY - 1)];
+    return true;
+}
+
+void InputQueue::Pop()
+{
+    uint32_t at = tail.load(std::memory_order_relaxed);
+    if (at != head.load(std::memory_order_acquire))
+        tail.store(at + 1, std::memory_order_release);
+}
+
+uint32_t InputQueue::GetSize() const
+{
+    return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+}
@@ -0,0 +1,45 @@
+#ifndef _INPUT_QUEUE_H_
+#define _INPUT_QUEUE_H_
+
+#include <atomic>
+#include <cstdint>
+
+// a key going down or up, with the glfw values of the key callback that saw it, repeats aren't queued
+struct InputEvent
+{
+    // glfwGetTime() when the event was dispatched
+    double time = 0.0;
+    int key = 0;
+    int action = 0;
+    int mods = 0;
+};
+
+// Ring of the key events the glfw key callback sees, read back in order by whoever steps the simulation, so input is
+// handled once per step at a cost that doesn't depend on how many keys there are. Holds CAPACITY events in place and
+// never allocates. One thread pushes and one pops, not necessarily the same one: the head and the tail are atomics,
+// so the simulation stage can consume while the window thread keeps pushing. A full queue drops the new event and
+// counts it.
+class InputQueue
+{
+public:
+    // a power of two, the indices wrap with a mask
+    static const uint32_t CAPACITY = 256;
+
+    // false when the queue is full
+    bool Push(const InputEvent& event);
+    // the oldest event, false when there is none
+    bool Peek(InputEvent& event) const;
+    void Pop();
+
+    uint32_t GetSize() const;
+    uint32_t GetDropped() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+    InputEvent events[CAPACITY];
+    // free running, head - tail is the number of queued events
+    std::atomic<uint32_t> head{0};
+    std::atomic<uint32_t> tail{0};
+    std::atomic<uint32_t> dropped{0};
+};
+
+#endif//_INPUT_QUEUE_H_
@@ -0,0 +1,184 @@
+#include "job_system.h"
+#include "cpu_profiler.h"
+
+#include <algorithm>
+
+JobDeque::JobDeque(uint32_t capacity) : buffer(capacity), mask((int64_t)capacity - 1)
+{
+    // capacity has to be a power of two for the index mask
+    for (auto& slot : buffer)
+        slot.store(nullptr, std::memory_order_relaxed);
+}
+
+bool JobDeque::Push(Job* job)
+{
+    int64_t b = bottom.load(std::memory_order_relaxed);
+    int64_t t = top.load(std::memory_order_acquire);
+    if (b - t > mask)
+        return false;
+    buffer[b & mask].store(job, std::memory_order_relaxed);
+    // publishes the job, thieves load bottom with acquire
+    bottom.store(b + 1, std::memory_order_release);
+    return true;
+}
+
+Job* JobDeque::Pop()
+{
+    int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+    bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = top.load(std::memory_order_relaxed);
+    if (t > b) {
+        // empty
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    Job* job = buffer[b & mask].load(std::memory_order_relaxed);
+    if (t == b) {
+        // last job, race the thieves for it
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            job = nullptr;
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+Job* JobDeque::Steal()
+{
+    int64_t t = top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = bottom.load(std::memory_order_acquire);
+    if (t >= b)
+        return nullptr;
+    Job* job = buffer[t & mask].load(std::memory_order_relaxed);
+    if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        return nullptr;
+    return job;
+}
+
+thread_local JobSystem* JobSystem::currentSystem = nullptr;
+thread_local unsigned JobSystem::currentWorker = 0;
+
+JobSystem::JobSystem(unsigned threadCount)
+{
+    threadCount = std::max(1u, threadCount);
+    for (unsigned i = 0; i < threadCount; i++)
+        workers.push_back(std::make_unique<Worker>());
+    // worker 0 is the calling thread
+    for (unsigned i = 1; i < threadCount; i++)
+        threads.emplace_back(&JobSystem::workerLoop, this, i);
+}
+
+JobSystem::~JobSystem()
+{
+    running.store(false);
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        wakeUp.notify_all();
+    }
+    for (auto& thread : threads)
+        thread.join();
+}
+
+void JobSystem::ParallelFor(uint32_t count, uint32_t chunkSize,
+                            const std::function<void(uint32_t begin, uint32_t end)>& function)
+{
+    if (count == 0)
+        return;
+    chunkSize = std::max(1u, chunkSize);
+    uint32_t chunkCount = (count + chunkSize - 1) / chunkSize;
+    if (workers.size() == 1 || chunkCount == 1) {
+        for (uint32_t begin = 0; begin < count; begin += chunkSize)
+            function(begin, std::min(count, begin + chunkSize));
+        return;
+    }
+
+    // a worker of ours runs a job that forks, otherwise it is the creating thread
+    unsigned index = currentSystem == this ? currentWorker : 0;
+    Worker& worker = *workers[index];
+    uint32_t firstJob = worker.jobsUsed;
+    uint32_t jobCount = std::min(chunkCount, JOB_STACK_SIZE - firstJob);
+    worker.jobsUsed += jobCount;
+
+    std::atomic<uint32_t> remaining(jobCount);
+    int32_t pushed = 0;
+    for (uint32_t i = 0; i < jobCount; i++) {
+        Job& job = worker.jobs[firstJob + i];
+        job.function = &function;
+        job.begin = i * chunkSize;
+        job.end = std::min(count, job.begin + chunkSize);
+        job.remaining = &remaining;
+        if (worker.deque.Push(&job)) {
+            pushed++;
+        } else {
+            // the deque is full, doing the work here is as good as queueing it
+            execute(&job);
+        }
+    }
+    queued.fetch_add(pushed);
+    if (sleeping.load() > 0) {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        wakeUp.notify_all();
+    }
+    // out of job slots, deep nesting, the rest of the chunks are run here
+    for (uint32_t i = jobCount; i < chunkCount; i++)
+        function(i * chunkSize, std::min(count, (i + 1) * chunkSize));
+
+    // help until every chunk is done, including the ones stolen by other workers
+    while (remaining.load(std::memory_order_acquire) > 0) {
+        Job* job = findJob(index);
+        if (job)
+            execute(job);
+        else
+            std::this_thread::yield();
+    }
+    worker.jobsUsed = firstJob;
+}
+
+void JobSystem::workerLoop(unsigned index)
+{
+    currentSystem = this;
+    currentWorker = index;
+    CpuProfiler::Get().SetThreadName("worker " + std::to_string(index));
+    while (running.load(std::memory_order_relaxed)) {
+        Job* job = findJob(index);
+        if (job) {
+            execute(job);
+            continue;
+        }
+        // spin briefly before going to sleep, new jobs tend to come in bursts
+        bool found = false;
+        for (int spin = 0; spin < 64 && !found; spin++) {
+            std::this_thread::yield();
+            found = queued.load(std::memory_order_relaxed) > 0;
+        }
+        if (found)
+            continue;
+
+        sleeping.fetch_add(1);
+        {
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wakeUp.wait(lock, [this] { return !running.load() || queued.load() > 0; });
+        }
+        sleeping.fetch_sub(1);
+    }
+}
+
+Job* JobSystem::findJob(unsigned index)
+{
+    Job* job = workers[index]->deque.Pop();
+    // look at the other deques starting after our own so thieves spread over the victims
+    unsigned n = (unsigned)workers.size();
+    for (unsigned i = 1; !job && i < n; i++)
+        job = workers[(index + i) % n]->deque.Steal();
+    if (job)
+        queued.fetch_sub(1, std::memory_order_relaxed);
+    return job;
+}
+
+void JobSystem::execute(Job* job)
+{
+    PROFILE_SCOPE("job");
+    (*job->function)(job->begin, job->end);
+    job->remaining->fetch_sub(1, std::memory_order_release);
+}
@@ -0,0 +1,86 @@
+#ifndef _JOB_SYSTEM_H_
+#define _JOB_SYSTEM_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct Job
+{
+    const std::function<void(uint32_t begin, uint32_t end)>* function = nullptr;
+    uint32_t begin = 0;
+    uint32_t end = 0;
+    std::atomic<uint32_t>* remaining = nullptr;
+};
+
+// Chase-Lev work-stealing deque. Only the owning thread pushes and pops at the bottom, any thread steals from the top.
+// The capacity is fixed, Push() fails when it is full and the caller runs the job itself.
+class JobDeque
+{
+public:
+    explicit JobDeque(uint32_t capacity = 4096);
+
+    bool Push(Job* job);
+    Job* Pop();
+    Job* Steal();
+
+private:
+    std::vector<std::atomic<Job*>> buffer;
+    int64_t mask;
+    alignas(64) std::atomic<int64_t> top{0};
+    alignas(64) std::atomic<int64_t> bottom{0};
+};
+
+// A fixed pool of worker threads with one deque each. The thread that creates the system is worker 0 and helps
+// executing jobs while it waits, so a system with one thread runs everything inline. A ParallelFor() pushes its chunks
+// onto the deque of the thread calling it, idle workers steal them from there, so a job can fork more work with a
+// ParallelFor() of its own and its thread works through that first.
+class JobSystem
+{
+public:
+    // jobs per worker for the ParallelFor() calls running on it at once, chunks past that are run by the caller
+    static const uint32_t JOB_STACK_SIZE = 4096;
+
+    explicit JobSystem(unsigned threadCount = std::thread::hardware_concurrency());
+    ~JobSystem();
+
+    // splits [0, count) into chunks of at most chunkSize and runs function(begin, end) on each, returns once all
+    // chunks are done. Call it from the thread that created the system or from inside one of its jobs.
+    void ParallelFor(uint32_t count, uint32_t chunkSize, const std::function<void(uint32_t begin, uint32_t end)>& function);
+    unsigned GetThreadCount() const { return (unsigned)workers.size(); }
+
+private:
+    struct Worker
+    {
+        JobDeque deque;
+        // the jobs of the ParallelFor() calls on this thread, a nested call takes the slots above the one it runs in
+        // and gives them back when it returns
+        std::vector<Job> jobs = std::vector<Job>(JOB_STACK_SIZE);
+        uint32_t jobsUsed = 0;
+    };
+
+    // the system and the index of the worker running on this thread, unset on threads that aren't workers
+    static thread_local JobSystem* currentSystem;
+    static thread_local unsigned currentWorker;
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+    std::atomic<bool> running{true};
+    // jobs pushed and not yet taken, lets idle workers know whether to look around or sleep
+    std::atomic<int32_t> queued{0};
+    // the mutex is only touched by workers going to sleep and by a submitter waking them
+    std::atomic<int32_t> sleeping{0};
+    std::mutex sleepMutex;
+    std::condition_variable wakeUp;
+
+    void workerLoop(unsigned index);
+    Job* findJob(unsigned index);
+    void execute(Job* job);
+};
+
+#endif//_JOB_SYSTEM_H_
@@ -0,0 +1,273 @@
+#include "light_cluster.h"
+#include "job_system.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LIGHT_CLUSTER_SSE
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// tile boundary planes go through the eye, boundary i of n sits at ndc -1 + 2i/n. Signed distances are positive on
+// the side of the higher tiles.
+struct BoundaryPlanes
+{
+    float slope[LightClusterer::CLUSTERS_X + 1];
+    float invLength[LightClusterer::CLUSTERS_X + 1];
+    int count;
+};
+
+BoundaryPlanes MakeBoundaryPlanes(int tiles, float tanHalfFov)
+{
+    BoundaryPlanes planes;
+    planes.count = tiles + 1;
+    for (int i = 0; i <= tiles; i++) {
+        float slope = (-1.0f + 2.0f * i / tiles) * tanHalfFov;
+        planes.slope[i] = slope;
+        planes.invLength[i] = 1.0f / std::sqrt(1.0f + slope * slope);
+    }
+    return planes;
+}
+
+} // namespace
+
+LightClusterer::LightClusterer()
+{
+    const GLenum formats[3] = {GL_RGBA32F, GL_RG32UI, GL_R32UI};
+    glGenBuffers(3, buffers);
+    glGenTextures(3, textures);
+    for (int i = 0; i < 3; i++) {
+        glBindBuffer(GL_TEXTURE_BUFFER, buffers[i]);
+        glBufferData(GL_TEXTURE_BUFFER, 16, nullptr, GL_STREAM_DRAW);
+        glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+        glTexBuffer(GL_TEXTURE_BUFFER, formats[i], buffers[i]);
+    }
+    glBindTexture(GL_TEXTURE_BUFFER, 0);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
+
+LightClusterer::~LightClusterer()
+{
+    glDeleteTextures(3, textures);
+    glDeleteBuffers(3, buffers);
+}
+
+void LightClusterer::Assign(const std::vector<PointLight>& lights, const glm::mat4& view, float fovY, float aspect,
+                            float zNear, float zFar, JobSystem& jobs)
+{
+    auto start = std::chrono::steady_clock::now();
+    stats = LightClusterStats();
+    stats.lights = (uint32_t)lights.size();
+
+    float tanHalfY = std::tan(fovY * 0.5f);
+    float tanHalfX = tanHalfY * aspect;
+    bounds.resize(lights.size());
+    // a multiple of four keeps the simd groups whole
+    jobs.ParallelFor((uint32_t)lights.size(), 256, [&](uint32_t begin, uint32_t end) {
+        computeBounds(lights, begin, end, view, tanHalfX, tanHalfY, zNear, zFar);
+    });
+
+    sliceIndices.resize(CLUSTERS_Z);
+    grid.resize(CLUSTER_COUNT * 2);
+    jobs.ParallelFor(CLUSTERS_Z, 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t slice = begin; slice < end; slice++)
+            fillSlice((int)slice);
+    });
+
+    // the slices' offsets are relative to their own lists until here
+    indices.clear();
+    const int sliceClusters = CLUSTERS_X * CLUSTERS_Y;
+    for (int slice = 0; slice < CLUSTERS_Z; slice++) {
+        uint32_t base = (uint32_t)indices.size();
+        for (int c = slice * sliceClusters; c < (slice + 1) * sliceClusters; c++) {
+            grid[c * 2] += base;
+            stats.maxLightsPerCluster = std::max(stats.maxLightsPerCluster, grid[c * 2 + 1]);
+        }
+        indices.insert(indices.end(), sliceIndices[slice].begin(), sliceIndices[slice].end());
+    }
+    stats.indices = (uint32_t)indices.size();
+    for (const LightBounds& b : bounds)
+        stats.visibleLights += b.minZ <= b.maxZ ? 1 : 0;
+
+    lightData.resize(lights.size() * 2);
+    for (size_t i = 0; i < lights.size(); i++) {
+        lightData[i * 2] = glm::vec4(lights[i].position, lights[i].radius);
+        lightData[i * 2 + 1] = glm::vec4(lights[i].color, 0.0f);
+    }
+    upload();
+    stats.assignMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void LightClusterer::Bind(GLuint firstUnit) const
+{
+    for (GLuint i = 0; i < 3; i++) {
+        glActiveTexture(GL_TEXTURE0 + firstUnit + i);
+        glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+    }
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void LightClusterer::computeBounds(const std::vector<PointLight>& lights, uint32_t begin, uint32_t end,
+                                   const glm::mat4& view, float tanHalfX, float tanHalfY, float zNear, float zFar)
+{
+    const BoundaryPlanes planesX = MakeBoundaryPlanes(CLUSTERS_X, tanHalfX);
+    const BoundaryPlanes planesY = MakeBoundaryPlanes(CLUSTERS_Y, tanHalfY);
+    const float sliceScale = CLUSTERS_Z / std::log(zFar / zNear);
+
+    // the depth range is the same for both paths, it needs a log per light anyway
+    auto setDepthRange = [&](LightBounds& b, float depth, float radius) {
+        float nearest = depth - radius;
+        float farthest = depth + radius;
+        if (farthest < zNear || nearest > zFar) {
+            b.minZ = 1;
+            b.maxZ = 0;
+            return;
+        }
+        b.minZ = nearest <= zNear ? 0 : std::min((int)(std::log(nearest / zNear) * sliceScale), CLUSTERS_Z - 1);
+        b.maxZ = farthest >= zFar ? CLUSTERS_Z - 1
+                                  : std::min((int)(std::log(farthest / zNear) * sliceScale), CLUSTERS_Z - 1);
+    };
+    // a tile range is empty once the sphere lies completely outside the outer boundaries
+    auto checkTiles = [](LightBounds& b) {
+        if (b.minX > b.maxX || b.minY > b.maxY) {
+            b.minZ = 1;
+            b.maxZ = 0;
+        }
+    };
+
+    uint32_t i = begin;
+#ifdef LIGHT_CLUSTER_SSE
+    for (; i + 4 <= end; i += 4) {
+        float px[4], py[4], pz[4], pr[4];
+        for (int k = 0; k < 4; k++) {
+            px[k] = lights[i + k].position.x;
+            py[k] = lights[i + k].position.y;
+            pz[k] = lights[i + k].position.z;
+            pr[k] = lights[i + k].radius;
+        }
+        __m128 x = _mm_loadu_ps(px), y = _mm_loadu_ps(py), z = _mm_loadu_ps(pz);
+        __m128 radius = _mm_loadu_ps(pr);
+        __m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), radius);
+        // view space center of four lights
+        __m128 vx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(view[0][0])), _mm_mul_ps(y, _mm_set1_ps(view[1][0]))),
+                               _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(view[2][0])), _mm_set1_ps(view[3][0])));
+        __m128 vy = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(view[0][1])), _mm_mul_ps(y, _mm_set1_ps(view[1][1]))),
+                               _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(view[2][1])), _mm_set1_ps(view[3][1])));
+        __m128 vz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(view[0][2])), _mm_mul_ps(y, _mm_set1_ps(view[1][2]))),
+                               _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(view[2][2])), _mm_set1_ps(view[3][2])));
+
+        // count the boundaries each sphere lies completely above or below, compare masks are -1 per lane
+        auto countTiles = [&](const BoundaryPlanes& planes, __m128 v, __m128i& above, __m128i& below) {
+            above = _mm_setzero_si128();
+            below = _mm_setzero_si128();
+            for (int p = 0; p < planes.count; p++) {
+                __m128 d = _mm_mul_ps(_mm_add_ps(v, _mm_mul_ps(vz, _mm_set1_ps(planes.slope[p]))),
+                                      _mm_set1_ps(planes.invLength[p]));
+                if (p > 0)
+                    above = _mm_sub_epi32(above, _mm_castps_si128(_mm_cmpge_ps(d, radius)));
+                if (p < planes.count - 1)
+                    below = _mm_sub_epi32(below, _mm_castps_si128(_mm_cmple_ps(d, negRadius)));
+            }
+        };
+        __m128i aboveX, belowX, aboveY, belowY;
+        countTiles(planesX, vx, aboveX, belowX);
+        countTiles(planesY, vy, aboveY, belowY);
+
+        alignas(16) int32_t ax[4], bx[4], ay[4], by[4];
+        alignas(16) float depth[4];
+        _mm_store_si128((__m128i*)ax, aboveX);
+        _mm_store_si128((__m128i*)bx, belowX);
+        _mm_store_si128((__m128i*)ay, aboveY);
+        _mm_store_si128((__m128i*)by, belowY);
+        _mm_store_ps(depth, _mm_sub_ps(_mm_setzero_ps(), vz));
+        for (int k = 0; k < 4; k++) {
+            LightBounds& b = bounds[i + k];
+            b.minX = ax[k];
+            b.maxX = CLUSTERS_X - 1 - bx[k];
+            b.minY = ay[k];
+            b.maxY = CLUSTERS_Y - 1 - by[k];
+            setDepthRange(b, depth[k], pr[k]);
+            checkTiles(b);
+        }
+    }
+#endif
+    for (; i < end; i++) {
+        glm::vec3 center = glm::vec3(view * glm::vec4(lights[i].position, 1.0f));
+        float radius = lights[i].radius;
+        LightBounds& b = bounds[i];
+        auto countTiles = [&](const BoundaryPlanes& planes, float v, int& above, int& below) {
+            above = 0;
+            below = 0;
+            for (int p = 0; p < planes.count; p++) {
+                float d = (v + center.z * planes.slope[p]) * planes.invLength[p];
+                if (p > 0 && d >= radius)
+                    above++;
+                if (p < planes.count - 1 && d <= -radius)
+                    below++;
+            }
+        };
+        int aboveX, belowX, aboveY, belowY;
+        countTiles(planesX, center.x, aboveX, belowX);
+        countTiles(planesY, center.y, aboveY, belowY);
+        b.minX = aboveX;
+        b.maxX = CLUSTERS_X - 1 - belowX;
+        b.minY = aboveY;
+        b.maxY = CLUSTERS_Y - 1 - belowY;
+        setDepthRange(b, -center.z, radius);
+        checkTiles(b);
+    }
+}
+
+void LightClusterer::fillSlice(int slice)
+{
+    // counts first, then offsets, then the indices with the counts as cursors
+    uint32_t* cells = grid.data() + slice * CLUSTERS_X * CLUSTERS_Y * 2;
+    for (int c = 0; c < CLUSTERS_X * CLUSTERS_Y; c++)
+        cells[c * 2 + 1] = 0;
+    for (const LightBounds& b : bounds) {
+        if (slice < b.minZ || slice > b.maxZ)
+            continue;
+        for (int y = b.minY; y <= b.maxY; y++) {
+            for (int x = b.minX; x <= b.maxX; x++)
+                cells[(y * CLUSTERS_X + x) * 2 + 1]++;
+        }
+    }
+    uint32_t total = 0;
+    for (int c = 0; c < CLUSTERS_X * CLUSTERS_Y; c++) {
+        cells[c * 2] = total;
+        total += cells[c * 2 + 1];
+        cells[c * 2 + 1] = 0;
+    }
+    std::vector<uint32_t>& list = sliceIndices[slice];
+    list.resize(total);
+    for (uint32_t light = 0; light < (uint32_t)bounds.size(); light++) {
+        const LightBounds& b = bounds[light];
+        if (slice < b.minZ || slice > b.maxZ)
+            continue;
+        for (int y = b.minY; y <= b.maxY; y++) {
+            for (int x = b.minX; x <= b.maxX; x++) {
+                uint32_t* cell = cells + (y * CLUSTERS_X + x) * 2;
+                list[cell[0] + cell[1]++] = light;
+            }
+        }
+    }
+}
+
+void LightClusterer::upload()
+{
+    // orphaned every frame, the buffers are never empty so the texture buffers stay valid
+    const void* data[3] = {lightData.data(), grid.data(), indices.data()};
+    const size_t sizes[3] = {lightData.size() * sizeof(glm::vec4), grid.size() * sizeof(uint32_t),
+                             indices.size() * sizeof(uint32_t)};
+    for (int i = 0; i < 3; i++) {
+        glBindBuffer(GL_TEXTURE_BUFFER, buffers[i]);
+        glBufferData(GL_TEXTURE_BUFFER, std::max(sizes[i], (size_t)16), nullptr, GL_STREAM_DRAW);
+        if (sizes[i] > 0)
+            glBufferSubData(GL_TEXTURE_BUFFER, 0, sizes[i], data[i]);
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+}
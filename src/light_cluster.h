@@ -0,0 +1,84 @@
+#ifndef _LIGHT_CLUSTER_H_
+#define _LIGHT_CLUSTER_H_
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+struct PointLight
+{
+    glm::vec3 position;
+    // no light reaches past the radius
+    float radius;
+    glm::vec3 color;
+};
+
+struct LightClusterStats
+{
+    uint32_t lights = 0;
+    // lights inside the depth range of the view
+    uint32_t visibleLights = 0;
+    uint32_t indices = 0;
+    uint32_t maxLightsPerCluster = 0;
+    float assignMs = 0.0f;
+};
+
+// Sorts point lights into a grid of view space clusters (froxels): CLUSTERS_X x CLUSTERS_Y tiles across the screen
+// and CLUSTERS_Z slices in depth, spaced exponentially so near slices stay thin. Assign() works in two parallel steps:
+// the bounds of each light in cluster coordinates are computed four lights at a time with SSE (scalar without it),
+// then every depth slice collects the lights overlapping it, so no two jobs write the same cluster. The result is
+// uploaded into three texture buffers the shader reads:
+//  - lights, 2 RGBA32F texels per light: position and radius, color
+//  - grid, one RG32UI texel per cluster: offset into the index list and light count
+//  - indices, R32UI light indices, grouped by cluster
+// Texture buffers rather than SSBOs so this works on GL 3.3.
+class LightClusterer
+{
+public:
+    static const int CLUSTERS_X = 16;
+    static const int CLUSTERS_Y = 9;
+    static const int CLUSTERS_Z = 24;
+    static const int CLUSTER_COUNT = CLUSTERS_X * CLUSTERS_Y * CLUSTERS_Z;
+
+    LightClusterer();
+    ~LightClusterer();
+
+    // fovY in radians, the planes have to match the projection the scene is drawn with
+    void Assign(const std::vector<PointLight>& lights, const glm::mat4& view, float fovY, float aspect, float zNear,
+                float zFar, JobSystem& jobs);
+    // binds the light, grid and index buffers to three consecutive texture units starting at firstUnit
+    void Bind(GLuint firstUnit) const;
+
+    const LightClusterStats& GetStats() const { return stats; }
+
+private:
+    // inclusive cluster ranges of a light, empty when minZ > maxZ
+    struct LightBounds
+    {
+        int minX, maxX;
+        int minY, maxY;
+        int minZ, maxZ;
+    };
+
+    GLuint buffers[3] = {};
+    GLuint textures[3] = {};
+
+    std::vector<LightBounds> bounds;
+    // per slice, filled by the slice's job and concatenated afterwards
+    std::vector<std::vector<uint32_t>> sliceIndices;
+    std::vector<uint32_t> grid;
+    std::vector<uint32_t> indices;
+    std::vector<glm::vec4> lightData;
+    LightClusterStats stats;
+
+    void computeBounds(const std::vector<PointLight>& lights, uint32_t begin, uint32_t end, const glm::mat4& view,
+                       float tanHalfX, float tanHalfY, float zNear, float zFar);
+    void fillSlice(int slice);
+    void upload();
+};
+
+#endif//_LIGHT_CLUSTER_H_
@@ -0,0 +1,147 @@
+#include "logger.h"
+
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+// the colors main.cpp used to mark its messages with
+const char* LEVEL_COLORS[] = {
+    "\033[90m", // debug
+    "\033[96m", // info
+    "\033[93m", // warning
+    "\033[91m", // error
+};
+const char* COLOR_END = "\033[0m";
+
+// what the writer gathers before a write
+const size_t BATCH_SIZE = 64 * 1024;
+
+} // namespace
+
+Logger& Logger::Get()
+{
+    static Logger logger;
+    return logger;
+}
+
+Logger::Logger()
+{
+    for (uint32_t i = 0; i < QUEUE_SIZE; i++)
+        slots[i].sequence.store(i, std::memory_order_relaxed);
+    writer = std::thread(&Logger::writeLoop, this);
+}
+
+Logger::~Logger()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    writer.join();
+    uint64_t droppedCount = GetDropped();
+    if (droppedCount > 0) {
+        std::fprintf(stdout, "%s%llu log messages dropped%s\n", LEVEL_COLORS[LOG_LEVEL_WARNING],
+                     (unsigned long long)droppedCount, COLOR_END);
+        std::fflush(stdout);
+    }
+}
+
+void Logger::Write(LogLevel level, const char* format, ...)
+{
+    // claim the next position, the slot at it is free once the writer moved past it a lap ago
+    uint64_t pos = enqueuePos.load(std::memory_order_relaxed);
+    Slot* slot;
+    while (true) {
+        slot = &slots[pos & (QUEUE_SIZE - 1)];
+        int64_t lap = (int64_t)(slot->sequence.load(std::memory_order_acquire) - pos);
+        if (lap == 0) {
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                break;
+        } else if (lap < 0) {
+            // the writer hasn't caught up, the ring is full
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        } else {
+            pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    slot->level = level;
+    va_list args;
+    va_start(args, format);
+    std::vsnprintf(slot->text, MESSAGE_SIZE, format, args);
+    va_end(args);
+    // hands the slot to the writer
+    slot->sequence.store(pos + 1, std::memory_order_release);
+}
+
+void Logger::Flush()
+{
+    uint64_t target = enqueuePos.load(std::memory_order_acquire);
+    std::unique_lock<std::mutex> lock(mutex);
+    flushing = true;
+    wake.notify_one();
+    written.wait(lock, [this, target]() { return writtenPos >= target; });
+}
+
+void Logger::writeLoop()
+{
+    std::vector<char> buffer(BATCH_SIZE);
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        lock.unlock();
+        writeBatch(buffer.data(), buffer.size());
+        lock.lock();
+        writtenPos = dequeuePos;
+        written.notify_all();
+        if (stopping && dequeuePos == enqueuePos.load(std::memory_order_acquire))
+            return;
+        wake.wait_for(lock, std::chrono::milliseconds(WRITE_INTERVAL_MS), [this]() { return stopping || flushing; });
+        flushing = false;
+    }
+}
+
+bool Logger::writeBatch(char* buffer, size_t capacity)
+{
+    size_t used = 0;
+    bool any = false;
+    while (true) {
+        Slot& slot = slots[dequeuePos & (QUEUE_SIZE - 1)];
+        if (slot.sequence.load(std::memory_order_acquire) != dequeuePos + 1) {
+            // claimed but still being formatted
+            if (dequeuePos < enqueuePos.load(std::memory_order_acquire)) {
+                std::this_thread::yield();
+                continue;
+            }
+            break;
+        }
+        const char* color = LEVEL_COLORS[slot.level];
+        size_t colorLength = std::strlen(color);
+        size_t textLength = std::strlen(slot.text);
+        size_t length = colorLength + textLength + std::strlen(COLOR_END) + 1;
+        if (used + length > capacity) {
+            std::fwrite(buffer, 1, used, stdout);
+            used = 0;
+        }
+        std::memcpy(buffer + used, color, colorLength);
+        std::memcpy(buffer + used + colorLength, slot.text, textLength);
+        std::memcpy(buffer + used + colorLength + textLength, COLOR_END, std::strlen(COLOR_END));
+        buffer[used + length - 1] = '\n';
+        used += length;
+
+        // free for the position a lap ahead
+        slot.sequence.store(dequeuePos + QUEUE_SIZE, std::memory_order_release);
+        dequeuePos++;
+        any = true;
+    }
+    if (used > 0)
+        std::fwrite(buffer, 1, used, stdout);
+    if (any)
+        std::fflush(stdout);
+    return any;
+}
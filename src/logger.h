@@ -0,0 +1,93 @@
+#ifndef _LOGGER_H_
+#define _LOGGER_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+enum LogLevel {
+    LOG_LEVEL_DEBUG,
+    LOG_LEVEL_INFO,
+    LOG_LEVEL_WARNING,
+    LOG_LEVEL_ERROR
+};
+
+// messages below it are compiled out, the LOG_LEVEL cmake setting passes it
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL LOG_LEVEL_DEBUG
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define LOG_PRINTF_FORMAT(formatIndex, firstArg) __attribute__((format(printf, formatIndex, firstArg)))
+#else
+#define LOG_PRINTF_FORMAT(formatIndex, firstArg)
+#endif
+
+// Console output that doesn't block the thread logging it. A message is formatted with printf rules straight into a
+// slot of a fixed ring and the ring is written out by a thread of its own, a batch at a time with one flush per
+// batch, so a message costs the formatting and a compare-and-swap and never a lock, an allocation or a write. Any
+// number of threads may log, the slots carry sequence numbers so producers don't wait on each other and the writer
+// can tell a slot that is still being filled. A full ring drops the message and counts it, a message longer than
+// MESSAGE_SIZE is cut short. The level picks the color, and LOG_MIN_LEVEL removes the levels below it at compile
+// time. Anything written to std::cout directly should Flush() first to come out in order.
+class Logger
+{
+public:
+    // a power of two, the positions wrap with a mask
+    static const uint32_t QUEUE_SIZE = 1024;
+    // room for a shader's 512 byte info log and what is said before it
+    static const uint32_t MESSAGE_SIZE = 1024;
+    // how long the writer sleeps on an empty ring
+    static const int WRITE_INTERVAL_MS = 5;
+
+    static Logger& Get();
+    ~Logger();
+
+    void Write(LogLevel level, const char* format, ...) LOG_PRINTF_FORMAT(3, 4);
+    // blocks until every message logged so far is written
+    void Flush();
+
+    uint64_t GetDropped() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+    struct Slot
+    {
+        // the position the slot is free for, that plus one once its message is ready
+        std::atomic<uint64_t> sequence{0};
+        LogLevel level = LOG_LEVEL_INFO;
+        char text[MESSAGE_SIZE];
+    };
+
+    Slot slots[QUEUE_SIZE];
+    std::atomic<uint64_t> enqueuePos{0};
+    // only the writer moves it
+    uint64_t dequeuePos = 0;
+    std::atomic<uint64_t> dropped{0};
+
+    // only taken by the writer and Flush()
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable written;
+    uint64_t writtenPos = 0;
+    bool flushing = false;
+    bool stopping = false;
+    std::thread writer;
+
+    Logger();
+    void writeLoop();
+    // writes every ready message, returns whether there were any
+    bool writeBatch(char* buffer, size_t capacity);
+};
+
+#define LOG_DEBUG(...) \
+    do { if (LOG_LEVEL_DEBUG >= LOG_MIN_LEVEL) Logger::Get().Write(LOG_LEVEL_DEBUG, __VA_ARGS__); } while (0)
+#define LOG_INFO(...) \
+    do { if (LOG_LEVEL_INFO >= LOG_MIN_LEVEL) Logger::Get().Write(LOG_LEVEL_INFO, __VA_ARGS__); } while (0)
+#define LOG_WARNING(...) \
+    do { if (LOG_LEVEL_WARNING >= LOG_MIN_LEVEL) Logger::Get().Write(LOG_LEVEL_WARNING, __VA_ARGS__); } while (0)
+#define LOG_ERROR(...) \
+    do { if (LOG_LEVEL_ERROR >= LOG_MIN_LEVEL) Logger::Get().Write(LOG_LEVEL_ERROR, __VA_ARGS__); } while (0)
+
+#endif//_LOGGER_H_
@@ -1,6 +1,12 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb/stb_image.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
+#include <random>
+#include <vector>
 #include <glad/glad.h> // this should be before <GLFW/glfw3.h>
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
@@ -12,21 +18,44 @@
 
 #include "shader.h"
 #include "camera.h"
-
-#define OK_MSG_BEGIN "\033[96m"
-#define OK_MSG_END "\033[0m"
-#define ERR_MSG_BEGIN "\033[91m"
-#define ERR_MSG_END "\033[0m"
-#define INFO_MSG_BEGIN "\033[93m"
-#define INFO_MSG_END "\033[0m"
+#include "bvh.h"
+#include "hiz.h"
+#include "scene.h"
+#include "job_system.h"
+#include "transform_benchmark.h"
+#include "render_queue.h"
+#include "static_batch.h"
+#include "command_buffer.h"
+#include "frame_graph.h"
+#include "light_cluster.h"
+#include "deferred_renderer.h"
+#include "shadow_map.h"
+#include "mesh_lod.h"
+#include "meshlet.h"
+#include "headless_context.h"
+#include "frame_benchmark.h"
+#include "gpu_profiler.h"
+#include "cpu_profiler.h"
+#include "gl_call_counter.h"
+#include "frame_capture.h"
+#include "image_diff.h"
+#include "fixed_timestep.h"
+#include "frame_pacer.h"
+#include "pipeline_stage.h"
+#include "input_queue.h"
+#include "logger.h"
 
 void FrameBufferSizeCallback(GLFWwindow *window, int width, int height);
-void ProcessInput(GLFWwindow * window);
 void MouseCallback(GLFWwindow* window, double xpos, double ypos);
 void ScrollCallback(GLFWwindow *window, double xoffset, double yoffset);
 void OnMouseButton(GLFWwindow* window, int button, int action, int modifier);
 void OnCharEvent(GLFWwindow* window, unsigned int ch);
 void OnKeyEvent(GLFWwindow* window, int key, int scancode, int action, int mods);
+void ResetCubeField(int count);
+void UpdateCubeField(float time);
+int PickCube(const Ray& ray, const std::vector<glm::mat4>& worldMatrices);
+int CheckGoldenImages(JobSystem& jobs);
+bool IsNumber(const char* arg);
 
 // camera
 Camera camera(glm::vec3(0.0f, 0.0f, 3.0f));
@@ -38,64 +67,400 @@ glm::vec4 clearColor { glm::vec4(0.1f, 0.2f, 0.3f, 0.0f) };
 glm::vec3 oc = {1.0f, 0.5f, 0.31f};
 glm::vec3 lc = {1.0f, 1.0f, 1.0f};
 
-// light position
-glm::vec3 lightPos(1.2f, 1.0f, 2.0f);
+// transforms of everything drawn; the cubes are nodes [0, cubeCount) so a cube index is its node id
+Scene scene;
+NodeId lightNode = INVALID_NODE;
+uint32_t updatedTransforms = 0;
+
+// cube field, the first ten cubes are placed like in main_02.cpp and the rest are scattered around them
+int cubeCount = 1000;
+bool animateCubes = true;
+bool bvhCulling = true;
+const AABB cubeBox(glm::vec3(-0.5f), glm::vec3(0.5f));
+std::vector<AABB> cubeBounds;
+std::vector<uint32_t> visibleCubes;
+Bvh cubeBvh;
+
+// hi-z occlusion culling of the cubes that survived frustum culling
+bool occlusionCulling = true;
+uint32_t occludedCubes = 0;
+
+// how the cube field is drawn: a draw per cube through the render queue, one static batch, a draw per cube
+// recorded on the worker threads and replayed on this one, or the detailed mesh culled per meshlet
+enum DrawPath {
+    DRAW_PATH_QUEUE,
+    DRAW_PATH_BATCH,
+    DRAW_PATH_RECORDED,
+    DRAW_PATH_MESHLETS
+};
+int drawPath = DRAW_PATH_BATCH;
+std::vector<uint32_t> batchDraws;
+
+// the batch can draw the field as a detailed mesh instead, its levels of detail are baked by --bake-lods
+const char* LOD_MESH_PATH = "./mesh/bumpy_sphere.lod";
+bool detailedMeshes = true;
+bool lodEnabled = true;
+// what the batch's draws would have cost at full detail
+uint32_t fullDetailTriangles = 0;
+// per drawn cube, the meshlets that survived culling
+std::vector<MeshletDrawList> meshletLists;
+MeshletStats meshletStats;
+
+// forward shading has the one light, clustered and deferred shading add up to a few thousand moving point lights
+enum LightingMode {
+    LIGHTING_FORWARD,
+    LIGHTING_CLUSTERED,
+    LIGHTING_DEFERRED
+};
+int lightingMode = LIGHTING_FORWARD;
+int stressLightCount = 256;
+float stressLightRadius = 3.0f;
+std::vector<PointLight> pointLights;
+
+// directional light with cascaded shadows, only the forward programs receive it
+bool sunShadows = true;
+bool cacheShadows = true;
+glm::vec3 sunDirection = {-0.4f, -1.0f, -0.3f};
+glm::vec3 sunColor = {0.5f, 0.5f, 0.45f};
+float shadowDistance = 60.0f;
+std::vector<uint32_t> shadowCasters;
+std::vector<uint32_t> movingShadowCasters;
+uint32_t shadowCasterCount = 0;
+// a cube moving is drawn into the cached cascades every frame, one that stood still for STATIC_CASTER_FRAMES goes
+// back into their static casters. The frame a cube last moved, -1 while it is static.
+const int STATIC_CASTER_FRAMES = 30;
+std::vector<int> cubeMovedFrame;
+std::vector<uint32_t> movingCubes;
+
+// show the linearized scene depth instead of the scene
+bool showDepth = false;
+bool showGpuProfiler = true;
+bool showCpuProfiler = true;
+// --cpu-trace <file>: the cpu zones of the last frames as a chrome trace, written on exit
+std::string cpuTracePath;
+// --gl-stats-csv <file>: the gl call counts of every frame, with GL_CALL_STATS
+std::string glStatsPath;
+// frames read back and written as png on a worker thread, every frame while capturing or a single screenshot.
+// --capture [dir] captures from the first frame, --capture-raw writes the raw rgba8 pixels instead.
+std::string captureDir = "./capture";
+bool capturingFrames = false;
+bool captureRaw = false;
+bool screenshotRequested = false;
+
+// --golden-update [dir] renders the golden views headless and saves them as the reference images, --golden-check [dir]
+// renders them again and compares them to the references, leaving what it rendered and the diffs in GOLDEN_OUT_DIR.
+// A view holds for GOLDEN_VIEW_FRAMES frames so the late hi-z results and the cached cascades settle before it is
+// captured, and a failed check fails the exit code. A check without its references exits with GOLDEN_MISSING_EXIT_CODE
+// instead, which ctest reports as skipped until they are baked.
+enum GoldenMode {
+    GOLDEN_NONE,
+    GOLDEN_UPDATE,
+    GOLDEN_CHECK
+};
+int goldenMode = GOLDEN_NONE;
+std::string goldenDir = "./golden";
+const std::string GOLDEN_OUT_DIR = "./golden_out";
+const int GOLDEN_MISSING_EXIT_CODE = 77;
+const int GOLDEN_VIEW_FRAMES = 8;
+struct GoldenView
+{
+    const char* name;
+    glm::vec3 position;
+    float yaw;
+    float pitch;
+    int lightingMode;
+    int drawPath;
+    bool showDepth;
+};
+// every lighting mode and draw path at least once
+const GoldenView GOLDEN_VIEWS[] = {
+    {"forward_queue", {0.0f, 0.0f, 3.0f}, -90.0f, 0.0f, LIGHTING_FORWARD, DRAW_PATH_QUEUE, false},
+    {"clustered_batch", {6.0f, 4.0f, 6.0f}, -125.0f, -20.0f, LIGHTING_CLUSTERED, DRAW_PATH_BATCH, false},
+    {"deferred_recorded", {-6.0f, 2.0f, 4.0f}, -50.0f, -10.0f, LIGHTING_DEFERRED, DRAW_PATH_RECORDED, false},
+    {"forward_meshlets", {0.0f, 1.0f, 3.0f}, -90.0f, -10.0f, LIGHTING_FORWARD, DRAW_PATH_MESHLETS, false},
+    {"depth_view", {0.0f, 0.0f, 3.0f}, -90.0f, 0.0f, LIGHTING_FORWARD, DRAW_PATH_BATCH, true},
+};
+const int GOLDEN_VIEW_COUNT = IM_ARRAYSIZE(GOLDEN_VIEWS);
+ImageDiffOptions goldenTolerance;
+// --golden-view <name> renders and checks only that view, so the views can run as processes of their own (ctest -j)
+int goldenView = -1;
+
+// --headless [frames] [width height]: renders the frames offscreen at a fixed step and prints how long they took
+bool headless = false;
+int headlessFrames = 600;
+bool headlessFramesGiven = false;
+int headlessWidth = WINDOW_WIDTH;
+int headlessHeight = WINDOW_HEIGHT;
+// of the projection and everything fit to the view frustum, the headless size's when that is set
+float viewAspect = (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT;
+// --benchmark [frames]: flies the camera along a path at the fixed step and writes the frame times to a csv. The path
+// is the file given with --camera-path, or an orbit around the cube field. With --headless the benchmark's frame
+// count wins, a --headless one is ignored.
+bool benchmark = false;
+int benchmarkFrames = 1000;
+std::string benchmarkCsv = "./benchmark.csv";
+CameraPath cameraPath;
+// headless and benchmark runs advance by a fixed step instead of the clock, so every run shows the same frames
+const float FIXED_STEP = 1.0f / 60.0f;
+// the camera movement and the animation are simulated at a fixed rate, and every frame draws them interpolated
+// between the last two steps, so the simulation costs the same at any frame rate. Headless and benchmark runs feed
+// the clock exactly one step per frame.
+struct SimulationState
+{
+    glm::vec3 cameraPosition;
+    double time = 0.0;
+};
+FixedTimestep simulation(FIXED_STEP);
+int simulationRate = 60;
+SimulationState previousState;
+SimulationState currentState;
+// key events of OnKeyEvent, consumed by the simulation steps they fall in
+InputQueue inputQueue;
+// the movement keys held as of the last event consumed, by Camera_Movement
+bool movementHeld[4] = {};
+// Everything the render stage reads of a frame, written by the simulation stage. Pipelined, the next frame is
+// simulated on its own thread while this one renders, into the other of two snapshots, so the stages never share the
+// camera or the scene. The ui is built on the main thread between the stages while nothing else runs, since imgui and
+// the settings it edits aren't thread safe, and culling stays with the render stage, the bvh also feeds the shadow
+// pass and hi-z.
+struct FrameSnapshot
+{
+    int frame = 0;
+    float time = 0.0f;
+    Camera camera;
+    glm::mat4 view;
+    glm::mat4 projection;
+    glm::vec3 objectColor;
+    glm::vec3 lightColor;
+    glm::vec3 lightPos;
+    // world matrices of every node, and the nodes whose matrix changed since the snapshot before
+    std::vector<glm::mat4> worldMatrices;
+    std::vector<NodeId> changedNodes;
+    uint32_t updatedTransforms = 0;
+};
+bool pipelined = true;
+// where the last frame drew the camera, anywhere else means the ui moved it
+glm::vec3 drawnCameraPosition;
+void ConsumeInput(double stepStart, double stepEnd, float heldTime[4]);
+void SimulateFrame(FrameSnapshot& snapshot, int frame, double frameTime, double frameEnd, JobSystem& jobs);
+// what the scene is animated to, the simulated time interpolated to the frame
+float sceneTime = 0.0f;
+// --pace-frames [frames in flight]: caps the frames queued ahead of the gpu, see frame_pacer.h
+bool framePacing = false;
+int pacingFramesInFlight = 1;
+// of the primary monitor, 0 while it is unknown
+double refreshMs = 0.0;
+// a path flown in the window, a key every RECORD_INTERVAL seconds, saved once recording stops
+const char* RECORDED_PATH_FILE = "./camera_path.txt";
+const float RECORD_INTERVAL = 0.1f;
+bool recordingPath = false;
+CameraPath recordedPath;
+float recordStart = 0.0f;
+
+// layout of ObjectBlock in phong_ubo.vs
+struct ObjectUniforms
+{
+    glm::mat4 model;
+    glm::mat4 normalMatrix;
+};
+
+// mouse picking, requested by a left-click and resolved in the render loop
+bool pickRequested = false;
+glm::vec2 pickPos;
+int pickedCube = -1;
+glm::vec3 pickColor = {0.2f, 1.0f, 0.2f};
 
 int main(int argc, char** argv)
 {
-    std::cout << OK_MSG_BEGIN << "START THE PROGRAM" << OK_MSG_END << std::endl;
-    std::cout << OK_MSG_BEGIN << "INITIALIZE GLFW LIBRARY" << OK_MSG_END << std::endl;
-    if (!glfwInit()) {
-        const char* description = nullptr;
-        glfwGetError(&description);
-        std::cout << ERR_MSG_BEGIN << "ERROR::MAIN::FAILED_TO_INITIALIZE_GLFW_LIB::" << description << ERR_MSG_END << std::endl;
-        return -1;
+    // cpu-only benchmarks don't need a window
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == "--bench-transforms") {
+            uint32_t nodeCount = i + 1 < argc && IsNumber(argv[i + 1]) ? (uint32_t)std::stoul(argv[i + 1]) : 1000000;
+            RunTransformBenchmark(nodeCount);
+            return 0;
+        }
+        if (std::string(argv[i]) == "--bake-lods") {
+            BakeBumpySphere(i + 1 < argc ? argv[i + 1] : LOD_MESH_PATH);
+            return 0;
+        }
+        if (std::string(argv[i]) == "--headless") {
+            headless = true;
+            if (i + 1 < argc && IsNumber(argv[i + 1])) {
+                headlessFrames = std::max(1, std::stoi(argv[i + 1]));
+                headlessFramesGiven = true;
+            }
+            if (i + 3 < argc && IsNumber(argv[i + 1]) && IsNumber(argv[i + 2]) && IsNumber(argv[i + 3])) {
+                headlessWidth = std::max(1, std::stoi(argv[i + 2]));
+                headlessHeight = std::max(1, std::stoi(argv[i + 3]));
+            }
+        }
+        if (std::string(argv[i]) == "--benchmark") {
+            benchmark = true;
+            if (i + 1 < argc && IsNumber(argv[i + 1]))
+                benchmarkFrames = std::max(1, std::stoi(argv[i + 1]));
+        }
+        if (std::string(argv[i]) == "--camera-path" && i + 1 < argc) {
+            if (!cameraPath.Load(argv[i + 1]))
+                return -1;
+        }
+        if (std::string(argv[i]) == "--benchmark-csv" && i + 1 < argc)
+            benchmarkCsv = argv[i + 1];
+        if (std::string(argv[i]) == "--cpu-trace" && i + 1 < argc)
+            cpuTracePath = argv[i + 1];
+        if (std::string(argv[i]) == "--gl-stats-csv" && i + 1 < argc)
+            glStatsPath = argv[i + 1];
+        if (std::string(argv[i]) == "--capture") {
+            capturingFrames = true;
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+                captureDir = argv[i + 1];
+        }
+        if (std::string(argv[i]) == "--capture-raw")
+            captureRaw = true;
+        if (std::string(argv[i]) == "--pace-frames") {
+            framePacing = true;
+            if (i + 1 < argc && IsNumber(argv[i + 1]))
+                pacingFramesInFlight = std::max(1, std::stoi(argv[i + 1]));
+        }
+        if (std::string(argv[i]) == "--golden-update" || std::string(argv[i]) == "--golden-check") {
+            goldenMode = std::string(argv[i]) == "--golden-update" ? GOLDEN_UPDATE : GOLDEN_CHECK;
+            headless = true;
+            if (i + 1 < argc && argv[i + 1][0] != '-')
+                goldenDir = argv[i + 1];
+        }
+        if (std::string(argv[i]) == "--golden-view" && i + 1 < argc) {
+            goldenView = -1;
+            for (int v = 0; v < GOLDEN_VIEW_COUNT; v++) {
+                if (std::string(argv[i + 1]) == GOLDEN_VIEWS[v].name)
+                    goldenView = v;
+            }
+            if (goldenView < 0) {
+                LOG_ERROR("ERROR::GOLDEN::UNKNOWN_VIEW::%s", argv[i + 1]);
+                return -1;
+            }
+        }
     }
+    if (headless)
+        viewAspect = (float)headlessWidth / (float)headlessHeight;
+    if (benchmark && headlessFramesGiven)
+        LOG_WARNING("--benchmark runs %d frames, the --headless frame count is ignored", benchmarkFrames);
+    if (benchmark && cameraPath.IsEmpty()) {
+        // around the cube field at the default count, looking at its center
+        float extent = 4.0f * std::cbrt((float)cubeCount);
+        cameraPath = CameraPath::CreateOrbit(glm::vec3(0.0f, 0.0f, -extent), 0.8f * extent, 0.25f * extent, 20.0f);
+    }
+
+    LOG_INFO("START THE PROGRAM");
+    CpuProfiler::Get().SetThreadName("main");
+    GLFWwindow* window = nullptr;
+    HeadlessContext headlessContext;
+    if (headless) {
+        LOG_INFO("CREATE HEADLESS CONTEXT");
+        if (!headlessContext.Create(headlessWidth, headlessHeight))
+            return -1;
+    } else {
+        LOG_INFO("INITIALIZE GLFW LIBRARY");
+        if (!glfwInit()) {
+            const char* description = nullptr;
+            glfwGetError(&description);
+            LOG_ERROR("ERROR::MAIN::FAILED_TO_INITIALIZE_GLFW_LIB::%s", description);
+            return -1;
+        }
 
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 #ifdef __APPLE__
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
 
-    std::cout << OK_MSG_BEGIN << "CREATE GLFW WINDOW" << OK_MSG_END << std::endl;
-    auto window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, WINDOW_NAME, nullptr, nullptr);
-    if (!window) {
-        std::cout << ERR_MSG_BEGIN << "ERROR::MAIN::FAILED_TO_CREATE_GLFW_WINDOW" << ERR_MSG_END << std::endl;
-        glfwTerminate();
-        return -1;
-    }
-    glfwMakeContextCurrent(window);
-    glfwSetFramebufferSizeCallback(window, FrameBufferSizeCallback);
-    glfwSetCursorPosCallback(window, MouseCallback);
-    glfwSetKeyCallback(window, OnKeyEvent);
-    glfwSetCharCallback(window, OnCharEvent);
-    glfwSetScrollCallback(window, ScrollCallback);
-    glfwSetMouseButtonCallback(window, OnMouseButton);
-
-    std::cout << OK_MSG_BEGIN << "LOAD ALL OPENGL FUNCTION POINTERS" << OK_MSG_END << std::endl;
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
-        std::cout << ERR_MSG_BEGIN << "ERROR::MAIN::FAILED_TO_INITIALIZE_GLAD" << ERR_MSG_END << std::endl;
-        glfwTerminate();
-        return -1;
+        LOG_INFO("CREATE GLFW WINDOW");
+        window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, WINDOW_NAME, nullptr, nullptr);
+        if (!window) {
+            LOG_ERROR("ERROR::MAIN::FAILED_TO_CREATE_GLFW_WINDOW");
+            glfwTerminate();
+            return -1;
+        }
+        glfwMakeContextCurrent(window);
+        const GLFWvidmode* videoMode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+        if (videoMode && videoMode->refreshRate > 0)
+            refreshMs = 1000.0 / videoMode->refreshRate;
+        glfwSetFramebufferSizeCallback(window, FrameBufferSizeCallback);
+        glfwSetCursorPosCallback(window, MouseCallback);
+        glfwSetKeyCallback(window, OnKeyEvent);
+        glfwSetCharCallback(window, OnCharEvent);
+        glfwSetScrollCallback(window, ScrollCallback);
+        glfwSetMouseButtonCallback(window, OnMouseButton);
+
+        LOG_INFO("LOAD ALL OPENGL FUNCTION POINTERS");
+        if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+            LOG_ERROR("ERROR::MAIN::FAILED_TO_INITIALIZE_GLAD");
+            glfwTerminate();
+            return -1;
+        }
     }
     auto glVersion = glGetString(GL_VERSION);
-    std::cout << INFO_MSG_BEGIN << "OPENGL CONTEXT VERSION: " << (char*)glVersion << INFO_MSG_END << std::endl;
+    LOG_DEBUG("OPENGL CONTEXT VERSION: %s", (const char*)glVersion);
+    GLCallCounter::Get().Install();
+    if (!glStatsPath.empty()) {
+        if (!GLCallCounter::IsAvailable())
+            LOG_WARNING("ERROR::MAIN::BUILT_WITHOUT_GL_CALL_STATS");
+        else
+            GLCallCounter::Get().OpenFrameLog(glStatsPath);
+    }
 
     // imgui is set up 
     auto imguiContext = ImGui::CreateContext();
     ImGui::SetCurrentContext(imguiContext);
-    ImGui_ImplGlfw_InitForOpenGL(window, false);
+    if (!headless)
+        ImGui_ImplGlfw_InitForOpenGL(window, false);
     ImGui_ImplOpenGL3_Init();
     ImGui_ImplOpenGL3_CreateFontsTexture();
     ImGui_ImplOpenGL3_CreateDeviceObjects();
 
     glEnable(GL_DEPTH_TEST);
 
-    std::cout << OK_MSG_BEGIN << "BUILD AND COMPILE SHADER PROGRAM" << OK_MSG_END << std::endl;
+    LOG_INFO("BUILD AND COMPILE SHADER PROGRAM");
     Shader objectShader("./shader/phong.vs", "./shader/phong.fs");
     Shader lightShader("./shader/light_resourse.vs", "./shader/light_resourse.fs");
+    Shader batchShader("./shader/phong_batch.vs", "./shader/phong.fs");
+    batchShader.use();
+    batchShader.setInt("transforms", 0);
+    Shader uboShader("./shader/phong_ubo.vs", "./shader/phong.fs");
+    uboShader.setBlockBinding("ObjectBlock", 0);
+    for (Shader* shader : {&objectShader, &batchShader, &uboShader}) {
+        shader->use();
+        shader->setInt("shadowMap", 4);
+    }
+    // the same programs with the clustered light loop
+    Shader objectClusteredShader("./shader/phong.vs", "./shader/phong_clustered.fs");
+    Shader batchClusteredShader("./shader/phong_batch.vs", "./shader/phong_clustered.fs");
+    batchClusteredShader.use();
+    batchClusteredShader.setInt("transforms", 0);
+    Shader uboClusteredShader("./shader/phong_ubo.vs", "./shader/phong_clustered.fs");
+    uboClusteredShader.setBlockBinding("ObjectBlock", 0);
+    for (Shader* shader : {&objectClusteredShader, &batchClusteredShader, &uboClusteredShader}) {
+        shader->use();
+        shader->setInt("lightData", 1);
+        shader->setInt("clusterGrid", 2);
+        shader->setInt("lightIndices", 3);
+        shader->setIVec3("clusterCounts", glm::ivec3(LightClusterer::CLUSTERS_X, LightClusterer::CLUSTERS_Y,
+                                                     LightClusterer::CLUSTERS_Z));
+    }
+    // and the ones writing the G-buffer
+    Shader objectDeferredShader("./shader/phong.vs", "./shader/gbuffer.fs");
+    Shader batchDeferredShader("./shader/phong_batch.vs", "./shader/gbuffer.fs");
+    batchDeferredShader.use();
+    batchDeferredShader.setInt("transforms", 0);
+    Shader uboDeferredShader("./shader/phong_ubo.vs", "./shader/gbuffer.fs");
+    uboDeferredShader.setBlockBinding("ObjectBlock", 0);
+    // shadow casters, the batch draws them with the light's matrices
+    Shader shadowShader("./shader/phong_batch.vs", "./shader/shadow_depth.fs");
+    shadowShader.use();
+    shadowShader.setInt("transforms", 0);
+    Shader depthViewShader("./shader/fullscreen.vs", "./shader/depth_view.fs");
+    depthViewShader.use();
+    depthViewShader.setInt("depth", 0);
+    auto hiz = std::make_unique<HiZCuller>();
 
     float vertices[] = {
         // positions          // normals         // texture coords
@@ -166,21 +531,116 @@ int main(int argc, char** argv)
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 8 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(0);
 
+    ResetCubeField(cubeCount);
+    // the stages run side by side, so the cores are split between them: the simulation stage's thread gets half for
+    // its own jobs and the main thread's jobs the rest
+    unsigned threadBudget = std::max(1u, std::thread::hardware_concurrency());
+    JobSystem jobs(threadBudget - threadBudget / 2);
+    auto simulationStage = std::make_unique<PipelineStage>("simulation", std::max(1u, threadBudget / 2));
+    FrameSnapshot snapshots[2];
+    int front = 0;
+    bool snapshotReady = false;
+
+    // every draw goes through the queue, sorted by state so the cache below can drop redundant binds
+    GLStateCache glState;
+    RenderQueue renderQueue;
+    uint32_t objectMaterial = renderQueue.AddMaterial(Material());
+    uint32_t pickMaterial = renderQueue.AddMaterial(Material());
+    uint32_t lightMaterial = renderQueue.AddMaterial(Material());
+
+    // the same cube without texture coordinates, cube i is draw i
+    auto staticBatch = std::make_unique<StaticBatch>();
+    std::vector<float> batchVertices;
+    std::vector<uint32_t> batchIndices;
+    for (uint32_t v = 0; v < 36; v++) {
+        batchVertices.insert(batchVertices.end(), vertices + v * 8, vertices + v * 8 + 6);
+        batchIndices.push_back(v);
+    }
+    uint32_t cubeMesh = staticBatch->AddMesh(batchVertices, batchIndices);
+    // and the levels of the detailed mesh, baked here on the first run
+    LodMesh lodMesh;
+    if (!LoadLodMesh(LOD_MESH_PATH, lodMesh) || lodMesh.levels.empty()) {
+        LOG_INFO("BAKE LEVELS OF DETAIL: %s", LOD_MESH_PATH);
+        lodMesh = BakeBumpySphere(LOD_MESH_PATH);
+    }
+    std::vector<uint32_t> lodMeshes;
+    std::vector<float> lodErrors;
+    for (const MeshLevel& level : lodMesh.levels) {
+        lodMeshes.push_back(staticBatch->AddMesh(level.vertices, level.indices));
+        lodErrors.push_back(level.error);
+    }
+    LodSelector lodSelector;
+    lodSelector.SetLevelErrors(lodErrors);
+    // the full detail level once more, split into meshlets
+    auto meshletMesh = std::make_unique<MeshletMesh>(lodMesh.levels[0]);
+
+    auto commandExecutor = std::make_unique<CommandExecutor>();
+    auto frameGraph = std::make_unique<FrameGraph>();
+    auto gpuProfiler = std::make_unique<GpuProfiler>();
+    frameGraph->SetProfiler(gpuProfiler.get());
+    auto frameCapture = std::make_unique<FrameCapture>();
+    auto framePacer = std::make_unique<FramePacer>();
+    framePacer->enabled = framePacing;
+    framePacer->maxFramesInFlight = pacingFramesInFlight;
+    auto lightClusterer = std::make_unique<LightClusterer>();
+    auto deferredRenderer = std::make_unique<DeferredRenderer>();
+    auto shadowMap = std::make_unique<CascadedShadowMap>();
+    // gpu scopes keep the name pointer, so the cascade names are built once instead of every frame
+    const char* cascadeScopeNames[CascadedShadowMap::CASCADE_COUNT];
+    for (int i = 0; i < CascadedShadowMap::CASCADE_COUNT; i++)
+        cascadeScopeNames[i] = CpuProfiler::Get().Intern("cascade " + std::to_string(i));
+    // fullscreen passes generate their vertices, but core profile still wants a VAO bound
+    uint32_t emptyVAO;
+    glGenVertexArrays(1, &emptyVAO);
+
     // check maximum number of vertex attributes supported
     int nrAttributes;
     glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &nrAttributes);
-    std::cout << INFO_MSG_BEGIN << "MAXIMUM NUMBER OF VERTEX ATTRIBUTES SUPPORTED: " << nrAttributes << INFO_MSG_END << std::endl;
+    LOG_DEBUG("MAXIMUM NUMBER OF VERTEX ATTRIBUTES SUPPORTED: %d", nrAttributes);
 
-    std::cout << OK_MSG_BEGIN << "START MAIN LOOP" << OK_MSG_END << std::endl;
+    LOG_INFO("START MAIN LOOP");
     // render loop
-    while (!glfwWindowShouldClose(window)) {
-        glfwPollEvents();
-
-        ImGui_ImplGlfw_NewFrame();
+    int frame = 0;
+    // headless runs end after their frames, benchmarks after theirs even when headless too
+    int frameLimit = benchmark ? benchmarkFrames : headless ? headlessFrames : 0;
+    if (goldenMode != GOLDEN_NONE)
+        frameLimit = (goldenView >= 0 ? goldenView + 1 : GOLDEN_VIEW_COUNT) * GOLDEN_VIEW_FRAMES;
+    bool fixedStep = headless || benchmark;
+    FrameBenchmark frameBenchmark;
+    if (benchmark)
+        frameBenchmark.Start(benchmarkFrames);
+    std::vector<double> frameCpuMs;
+    auto loopStart = std::chrono::steady_clock::now();
+    double lastFrameTime = fixedStep ? 0.0 : glfwGetTime();
+    currentState.cameraPosition = camera.Position;
+    previousState = currentState;
+    drawnCameraPosition = camera.Position;
+    // a single golden view starts at its frame of the full run, the frames before it are only simulated so the
+    // cubes are where they would be
+    if (goldenMode != GOLDEN_NONE && goldenView >= 0) {
+        for (; frame < goldenView * GOLDEN_VIEW_FRAMES; frame++)
+            SimulateFrame(snapshots[front], frame, FIXED_STEP, lastFrameTime, jobs);
+    }
+    while ((frameLimit == 0 || frame < frameLimit) && !(window && glfwWindowShouldClose(window))) {
+        framePacer->WaitForFrames(refreshMs);
+        auto frameStart = std::chrono::steady_clock::now();
+        frameBenchmark.BeginFrame();
+        gpuProfiler->BeginFrame();
+        framePacer->MarkInput();
+        if (headless) {
+            // no platform backend, imgui is told the size and the step directly
+            ImGuiIO& io = ImGui::GetIO();
+            io.DisplaySize = ImVec2((float)headlessWidth, (float)headlessHeight);
+            io.DeltaTime = FIXED_STEP;
+        } else {
+            glfwPollEvents();
+            ImGui_ImplGlfw_NewFrame();
+        }
         ImGui::NewFrame();
 
         // imgui ui set up
         if (ImGui::Begin("UI window")) {
+            PROFILE_SCOPE("ui");
             ImGui::Text("Color");
             if (ImGui::ColorEdit4("clear", glm::value_ptr(clearColor))) {
                 glClearColor(clearColor.x, clearColor.y, clearColor.z, clearColor.w);
@@ -189,6 +649,11 @@ int main(int argc, char** argv)
             ImGui::Text("Object color");
             ImGui::ColorEdit3("color", glm::value_ptr(oc));
             ImGui::Separator();
+            ImGui::Text("Light");
+            glm::vec3 lightPos = scene.GetPosition(lightNode);
+            if (ImGui::DragFloat3("Light pos", glm::value_ptr(lightPos), 0.01f))
+                scene.SetPosition(lightNode, lightPos);
+            ImGui::Separator();
             ImGui::Text("Camera");
             ImGui::DragFloat3("Pos", glm::value_ptr(camera.Position), 0.01f);
             ImGui::DragFloat("Pitch", &camera.Front.y, 0.01f, -2.0f, 2.0f);
@@ -199,99 +664,834 @@ int main(int argc, char** argv)
                 camera.Front.y = 0.0f;
                 camera.Position = glm::vec3(0.0f, 0.0f, 3.0f);
             }
+            ImGui::Separator();
+            ImGui::Text("Scene");
+            if (ImGui::SliderInt("Cubes", &cubeCount, 10, 200000))
+                ResetCubeField(cubeCount);
+            ImGui::Checkbox("Animate", &animateCubes);
+            ImGui::Text("transforms updated %u / %d on %u threads", updatedTransforms, (int)scene.Size(),
+                        jobs.GetThreadCount());
+            ImGui::Checkbox("BVH culling", &bvhCulling);
+            const BvhStats& bvhStats = cubeBvh.GetStats();
+            ImGui::Text("visible %d / %d, picked %d", (int)visibleCubes.size(), cubeCount, pickedCube);
+            ImGui::Text("bvh nodes %u, sah %.2f / %.2f", bvhStats.nodeCount, bvhStats.refitCost, bvhStats.buildCost);
+            ImGui::Text("build %.3f ms, refit %.3f ms", bvhStats.buildMs, bvhStats.refitMs);
+            ImGui::Text("cull %.3f ms, ray %.3f ms", bvhStats.cullMs, bvhStats.rayMs);
+            const RenderQueueStats& queueStats = renderQueue.GetStats();
+            const GLStateStats& stateStats = glState.GetStats();
+            ImGui::Text("draws %u, sort %.3f ms", queueStats.draws, queueStats.sortMs);
+            ImGui::Text("changes: program %u, material %u, vao %u", queueStats.programChanges,
+                        queueStats.materialChanges, queueStats.vaoChanges);
+            ImGui::Text("binds: program %u, vao %u, redundant %u", stateStats.programBinds, stateStats.vaoBinds,
+                        stateStats.redundantBinds);
+            const char* drawPaths[] = {"Render queue", "Static batch", "Recorded commands", "Meshlets"};
+            ImGui::Combo("Draw path", &drawPath, drawPaths, IM_ARRAYSIZE(drawPaths));
+            if (staticBatch->IsIndirectSupported())
+                ImGui::Checkbox("Multi draw indirect", &staticBatch->useIndirect);
+            const StaticBatchStats& batchStats = staticBatch->GetStats();
+            ImGui::Text("batch: %u draws in %u commands, %s", batchStats.draws, batchStats.commands,
+                        batchStats.indirect ? "indirect" : "instanced");
+            ImGui::Checkbox("Detailed meshes", &detailedMeshes);
+            ImGui::Checkbox("Level of detail", &lodEnabled);
+            ImGui::SliderFloat("Max pixel error", &lodSelector.maxPixelError, 0.1f, 8.0f);
+            ImGui::Text("triangles %u, %u at full detail", batchStats.triangles, fullDetailTriangles);
+            const CommandStats& commandStats = commandExecutor->GetStats();
+            ImGui::Text("recorded: %u commands in %u buffers, %u KB uniforms", commandStats.commands,
+                        commandStats.buffers, commandStats.uniformBytes / 1024);
+            ImGui::Text("record %.3f ms, replay %.3f ms", commandStats.recordMs, commandStats.replayMs);
+            ImGui::Text("meshlets: %u tested, culled %u frustum, %u cone", meshletStats.tested,
+                        meshletStats.frustumCulled, meshletStats.coneCulled);
+            ImGui::Checkbox("Occlusion culling", &occlusionCulling);
+            const HiZStats& hizStats = hiz->GetStats();
+            ImGui::Text("drawn %d, occluded %u", (int)visibleCubes.size(), occludedCubes);
+            ImGui::Text("hi-z tested %u, age %u, skipped %u%s", hizStats.tested, hizStats.resultAge,
+                        hizStats.skipped, hizStats.fallback ? ", fallback" : "");
+            ImGui::Separator();
+            ImGui::Text("Lighting");
+            const char* lightingModes[] = {"Forward", "Clustered", "Deferred"};
+            ImGui::Combo("Lighting", &lightingMode, lightingModes, IM_ARRAYSIZE(lightingModes));
+            ImGui::SliderInt("Stress lights", &stressLightCount, 0, 4096);
+            ImGui::SliderFloat("Light radius", &stressLightRadius, 0.5f, 10.0f);
+            const LightClusterStats& clusterStats = lightClusterer->GetStats();
+            ImGui::Text("lights %u, in view %u, indices %u, max %u per cluster", clusterStats.lights,
+                        clusterStats.visibleLights, clusterStats.indices, clusterStats.maxLightsPerCluster);
+            ImGui::Text("assign %.3f ms", clusterStats.assignMs);
+            const DeferredStats& deferredStats = deferredRenderer->GetStats();
+            ImGui::Text("light volumes drawn %u, culled %u", deferredStats.lightsDrawn, deferredStats.lightsCulled);
+            ImGui::Separator();
+            ImGui::Text("Shadows");
+            ImGui::Checkbox("Sun shadows", &sunShadows);
+            ImGui::Checkbox("Cache far cascades", &cacheShadows);
+            ImGui::SliderFloat3("Sun direction", glm::value_ptr(sunDirection), -1.0f, 1.0f);
+            ImGui::SliderFloat("Shadow distance", &shadowDistance, 10.0f, 100.0f);
+            const ShadowStats& shadowStats = shadowMap->GetStats();
+            ImGui::Text("cascades drawn %u, cached %u, casters %u", shadowStats.rendered, shadowStats.cached,
+                        shadowCasterCount);
+            ImGui::Separator();
+            ImGui::Text("Frame graph");
+            ImGui::Checkbox("Show depth", &showDepth);
+            const FrameGraphStats& graphStats = frameGraph->GetStats();
+            ImGui::Text("passes %u, culled %u", graphStats.passes, graphStats.culledPasses);
+            ImGui::Text("transient %u textures in %u", graphStats.transientTextures, graphStats.physicalTextures);
+            ImGui::Text("memory %zu KB, aliased %zu KB, peak %zu KB", graphStats.transientBytes / 1024,
+                        graphStats.allocatedBytes / 1024, graphStats.peakBytes / 1024);
+            if (ImGui::Button("Dump frame graph")) {
+                Logger::Get().Flush();
+                frameGraph->Dump(std::cout);
+            }
+            ImGui::Checkbox("GPU profiler", &showGpuProfiler);
+            ImGui::SameLine();
+            ImGui::Checkbox("CPU profiler", &showCpuProfiler);
+            ImGui::Separator();
+            ImGui::Text("Driver");
+            if (GLCallCounter::IsAvailable()) {
+                const GLCallStats& callStats = GLCallCounter::Get().GetFrameStats();
+                ImGui::Text("gl calls %llu, draws %llu, uniforms %llu", (unsigned long long)callStats.calls,
+                            (unsigned long long)callStats.drawCalls, (unsigned long long)callStats.uniformSets);
+                ImGui::Text("uploaded: buffers %llu KB, textures %llu KB",
+                            (unsigned long long)callStats.bufferBytes / 1024,
+                            (unsigned long long)callStats.textureBytes / 1024);
+                if (ImGui::TreeNode("Calls by entry point")) {
+                    for (const GLEntryPointCount& count : GLCallCounter::Get().GetFrameCalls())
+                        ImGui::Text("%-32s %llu", count.name, (unsigned long long)count.calls);
+                    ImGui::TreePop();
+                }
+                if (ImGui::Button("Dump GL calls") && GLCallCounter::Get().WriteCallsCsv("./gl_calls.csv"))
+                    LOG_INFO("GL CALLS: ./gl_calls.csv");
+            } else {
+                ImGui::Text("gl call counts need a GL_CALL_STATS build");
+            }
+            ImGui::Separator();
+            ImGui::Text("Capture");
+            ImGui::Checkbox("Capture frames", &capturingFrames);
+            ImGui::SameLine();
+            if (ImGui::Button("Screenshot"))
+                screenshotRequested = true;
+            const CaptureStats& captureStats = frameCapture->GetStats();
+            ImGui::Text("written %u, queued %u, skipped %u, dropped %u", captureStats.written, captureStats.queued,
+                        captureStats.skipped, captureStats.dropped);
+            ImGui::Text("main thread %.3f ms", captureStats.mainThreadMs);
+            ImGui::Separator();
+            ImGui::Text("Benchmark");
+            if (ImGui::Checkbox("Record camera path", &recordingPath)) {
+                if (recordingPath) {
+                    recordedPath.Clear();
+                } else if (recordedPath.Save(RECORDED_PATH_FILE)) {
+                    LOG_INFO("CAMERA PATH SAVED: %s, %g s", RECORDED_PATH_FILE, recordedPath.GetDuration());
+                }
+            }
+            if (benchmark)
+                ImGui::Text("frame %d / %d", frame, benchmarkFrames);
+            ImGui::Separator();
+            ImGui::Text("Frame pacing");
+            ImGui::Checkbox("Pace frames", &framePacer->enabled);
+            ImGui::SameLine();
+            ImGui::Checkbox("Sleep before input", &framePacer->sleepBeforeInput);
+            ImGui::SliderInt("Frames in flight", &framePacer->maxFramesInFlight, 1, FramePacer::MAX_FRAMES_IN_FLIGHT);
+            ImGui::SliderFloat("Margin (ms)", &framePacer->marginMs, 0.0f, 5.0f);
+            const FramePacingStats& pacingStats = framePacer->GetStats();
+            ImGui::Text("latency %.2f ms, max %.2f ms, predicted %.2f ms", pacingStats.latencyMs,
+                        pacingStats.maxLatencyMs, pacingStats.predictedMs);
+            ImGui::Text("in flight %d, waited %.2f ms, slept %.2f ms, refresh %.2f ms", pacingStats.framesInFlight,
+                        pacingStats.waitMs, pacingStats.sleepMs, refreshMs);
+            ImGui::Separator();
+            ImGui::Text("Simulation");
+            ImGui::SliderInt("Steps per second", &simulationRate, 10, 240);
+            ImGui::SliderInt("Max steps per frame", &simulation.maxSteps, 1, 10);
+            ImGui::Checkbox("Pipelined", &pipelined);
+            ImGui::SameLine();
+            ImGui::Text("simulate %.3f ms, waited %.3f ms", simulationStage->GetJobMs(), simulationStage->GetWaitMs());
+            ImGui::Text("steps %d, alpha %.2f, dropped %.2f s", simulation.GetSteps(), simulation.GetAlpha(),
+                        simulation.GetDroppedTime());
+            ImGui::Text("input events: %u queued, %u dropped", inputQueue.GetSize(), inputQueue.GetDropped());
         }
         ImGui::End();
+        if (showGpuProfiler)
+            gpuProfiler->DrawWindow(&showGpuProfiler);
+        if (showCpuProfiler)
+            CpuProfiler::Get().DrawWindow(&showCpuProfiler);
+
+        // golden runs switch the settings with the view, here since the render stage reads them
+        if (goldenMode != GOLDEN_NONE) {
+            const GoldenView& goldenView = GOLDEN_VIEWS[frame / GOLDEN_VIEW_FRAMES];
+            lightingMode = goldenView.lightingMode;
+            drawPath = goldenView.drawPath;
+            showDepth = goldenView.showDepth;
+            // the lod levels keep a history, start it over with the view so it renders the same run alone
+            if (frame % GOLDEN_VIEW_FRAMES == 0)
+                lodSelector.Resize(cubeCount);
+        }
+        // paced, the camera reads input once more right before it is simulated, the ui was built in between
+        if (framePacer->enabled && !headless) {
+            framePacer->MarkInput();
+            glfwPollEvents();
+        }
+        // the frame's time ends after the last poll, so its steps see every event queued so far
+        double frameTime = FIXED_STEP;
+        double frameEnd = lastFrameTime;
+        if (!fixedStep) {
+            frameEnd = glfwGetTime();
+            frameTime = frameEnd - lastFrameTime;
+            lastFrameTime = frameEnd;
+            simulation.SetStepTime(1.0 / simulationRate);
+        }
+
+        // this frame's simulation ran on the stage while the last one rendered, unless there was no last one or the
+        // cube field was rebuilt since, then the next frame's starts on the stage and this thread renders
+        bool pipelineFrame = pipelined;
+        bool stale = snapshotReady && snapshots[front].worldMatrices.size() != scene.Size();
+        if (!pipelineFrame || !snapshotReady || stale) {
+            PROFILE_SCOPE("simulate");
+            // a stale frame already had its time, it is only simulated again for the new field
+            SimulateFrame(snapshots[front], frame, stale ? 0.0 : frameTime, frameEnd, jobs);
+        }
+        snapshotReady = false;
+        if (pipelineFrame) {
+            int back = 1 - front;
+            int next = frame + 1;
+            simulationStage->Kick([&snapshots, back, next, frameTime, frameEnd](JobSystem& stageJobs) {
+                PROFILE_SCOPE("simulate");
+                SimulateFrame(snapshots[back], next, frameTime, frameEnd, stageJobs);
+            });
+        }
+        FrameSnapshot& snapshot = snapshots[front];
+        float currentFrame = snapshot.time;
+        updatedTransforms = snapshot.updatedTransforms;
 
-        // update deltatime
-        float currentFrame = static_cast<float>(glfwGetTime());
-        camera.deltaTime = currentFrame - camera.lastFrame;
-        camera.lastFrame = currentFrame;
-        // input
-        ProcessInput(window);
         // render
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        int fbWidth = headlessWidth, fbHeight = headlessHeight;
+        if (!headless)
+            glfwGetFramebufferSize(window, &fbWidth, &fbHeight);
+        const glm::mat4& projection = snapshot.projection;
+        const glm::mat4& view = snapshot.view;
+        Camera& frameCamera = snapshot.camera;
 
-        // activate shader
-        objectShader.use();
-        objectShader.setVec3("objectColor", oc);
-        objectShader.setVec3("lightColor",  lc);
-        objectShader.setVec3("lightPos", lightPos);
+        // the field was rebuilt, refill the batch
+        if (staticBatch->GetDrawCount() != (size_t)cubeCount) {
+            staticBatch->ClearDraws();
+            for (int i = 0; i < cubeCount; i++)
+                staticBatch->AddDraw(cubeMesh, snapshot.worldMatrices[i]);
+            lodSelector.Resize(cubeCount);
+            cubeMovedFrame.assign(cubeCount, -1);
+            movingCubes.clear();
+        }
+        // a level for every cube, not only the visible ones, the shadow cascades draw the others
+        bool detailed = detailedMeshes && !lodMeshes.empty();
+        float pixelScale = (float)fbHeight / (2.0f * std::tan(glm::radians(frameCamera.Zoom) * 0.5f));
+        jobs.ParallelFor(cubeCount, 4096, [&](uint32_t begin, uint32_t end) {
+            PROFILE_SCOPE("lod select");
+            for (uint32_t i = begin; i < end; i++) {
+                uint32_t mesh = cubeMesh;
+                if (detailed) {
+                    const glm::mat4& model = snapshot.worldMatrices[i];
+                    float distance = glm::length(glm::vec3(model[3]) - frameCamera.Position);
+                    float scale = glm::length(glm::vec3(model[0]));
+                    mesh = lodMeshes[lodEnabled ? lodSelector.Select(i, distance, scale, pixelScale) : 0];
+                }
+                staticBatch->SetMesh(i, mesh);
+            }
+        });
+        // refit the bvh with the bounds of the nodes that changed, rebuild it once refits made it too loose
+        bool staticCastersChanged = false;
+        if (updatedTransforms > 0) {
+            PROFILE_SCOPE("bvh update");
+            for (NodeId node : snapshot.changedNodes) {
+                if (node < (NodeId)cubeCount) {
+                    cubeBounds[node] = TransformAABB(cubeBox, snapshot.worldMatrices[node]);
+                    staticBatch->SetTransform(node, snapshot.worldMatrices[node]);
+                    // the cached cascades still have it where it was
+                    if (cubeMovedFrame[node] < 0) {
+                        movingCubes.push_back(node);
+                        staticCastersChanged = true;
+                    }
+                    cubeMovedFrame[node] = frame;
+                }
+            }
+            if (cubeBvh.NeedsRebuild())
+                cubeBvh.Build(cubeBounds);
+            else
+                cubeBvh.Refit(cubeBounds);
+        }
+        size_t stillMoving = 0;
+        for (uint32_t cube : movingCubes) {
+            if (frame - cubeMovedFrame[cube] >= STATIC_CASTER_FRAMES) {
+                cubeMovedFrame[cube] = -1;
+                staticCastersChanged = true;
+            } else {
+                movingCubes[stillMoving++] = cube;
+            }
+        }
+        movingCubes.resize(stillMoving);
+        if (staticCastersChanged)
+            shadowMap->InvalidateCasters();
+        visibleCubes.clear();
+        if (bvhCulling) {
+            cubeBvh.CullFrustum(Frustum(projection * view), visibleCubes);
+        } else {
+            for (int i = 0; i < cubeCount; i++)
+                visibleCubes.push_back(i);
+        }
+        // drop the cubes the last finished hi-z pass found hidden, and queue a pass for this frame's candidates
+        occludedCubes = 0;
+        if (occlusionCulling) {
+            PROFILE_SCOPE("hi-z collect");
+            hiz->Resize(fbWidth, fbHeight);
+            hiz->Collect(frameCamera.Position, frameCamera.Front);
+            gpuProfiler->BeginScope("hi-z test");
+            hiz->Test(visibleCubes, cubeBounds);
+            gpuProfiler->EndScope();
+            size_t kept = 0;
+            for (uint32_t i : visibleCubes) {
+                if (!hiz->IsOccluded(i))
+                    visibleCubes[kept++] = i;
+            }
+            occludedCubes = (uint32_t)(visibleCubes.size() - kept);
+            visibleCubes.resize(kept);
+        }
+        if (pickRequested) {
+            int width, height;
+            glfwGetWindowSize(window, &width, &height);
+            // the aspect the frame was projected with, which the window no longer has once it was resized
+            Ray ray = frameCamera.ScreenPointToRay(pickPos.x, pickPos.y, (float)width, (float)height, viewAspect);
+            pickedCube = PickCube(ray, snapshot.worldMatrices);
+            pickRequested = false;
+        }
 
-        glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)WINDOW_WIDTH / (float)WINDOW_HEIGHT, 0.1f, 100.0f);
-        objectShader.setMat4("projection", projection);
-        glm::mat4 view = camera.GetViewMatrix();
-        objectShader.setMat4("view", view);
+        // the lights orbit around fixed points spread over the cube field, the scene light is light 0
+        bool clustered = lightingMode == LIGHTING_CLUSTERED;
+        bool deferred = lightingMode == LIGHTING_DEFERRED;
+        if (clustered || deferred) {
+            PROFILE_SCOPE("lights");
+            std::mt19937 rng(4321);
+            std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+            float extent = 4.0f * std::cbrt((float)cubeCount);
+            pointLights.resize(stressLightCount + 1);
+            pointLights[0] = {snapshot.lightPos, 50.0f, snapshot.lightColor};
+            for (int i = 1; i <= stressLightCount; i++) {
+                glm::vec3 center = glm::vec3(dist(rng), dist(rng), dist(rng) - 1.0f) * extent;
+                float phase = dist(rng) * 3.14159265f;
+                glm::vec3 color = glm::abs(glm::vec3(dist(rng), dist(rng), dist(rng)));
+                float angle = currentFrame + phase;
+                glm::vec3 orbit = glm::vec3(std::cos(angle), 0.5f * std::sin(2.0f * angle), std::sin(angle)) * 2.0f;
+                pointLights[i] = {center + orbit, stressLightRadius, color};
+            }
+            if (clustered) {
+                lightClusterer->Assign(pointLights, view, glm::radians(frameCamera.Zoom), viewAspect, 0.1f, 100.0f,
+                                       jobs);
+            }
+        }
+        Shader& objectProgram = deferred ? objectDeferredShader : clustered ? objectClusteredShader : objectShader;
+        Shader& batchProgram = deferred ? batchDeferredShader : clustered ? batchClusteredShader : batchShader;
+        Shader& uboProgram = deferred ? uboDeferredShader : clustered ? uboClusteredShader : uboShader;
 
-        glm::mat4 model = glm::mat4(1.0f);
-        objectShader.setMat4("model", model);
+        // the sun only lights the forward programs, so only they need its shadows
+        bool shadows = sunShadows && lightingMode == LIGHTING_FORWARD;
+        glm::vec3 sunDir = glm::vec3(0.0f, -1.0f, 0.0f);
+        if (glm::length(sunDirection) > 1e-3f)
+            sunDir = glm::normalize(sunDirection);
+        if (shadows) {
+            AABB casterBounds = cubeBvh.GetNodes().empty() ? AABB() : cubeBvh.GetNodes()[0].bounds;
+            shadowMap->SetCaching(cacheShadows);
+            shadowMap->Update(view, glm::radians(frameCamera.Zoom), viewAspect, 0.1f, shadowDistance, sunDir,
+                              casterBounds);
+        }
 
-        glBindVertexArray(objectVAO);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
+        // the frame as a graph: the scene is drawn into transient targets, hi-z and the depth view read its depth and
+        // present copies one of them to the window. The depth view is culled while nothing shows it, and then shares
+        // its texture with the scene color, which is dead by the time the depth view is drawn.
+        frameGraph->Reset();
+        FrameTextureDesc colorDesc = {fbWidth, fbHeight, GL_RGBA8};
+        FrameTextureDesc depthDesc = {fbWidth, fbHeight, GL_DEPTH_COMPONENT24};
+        FrameResource backbuffer = frameGraph->Import("backbuffer", headlessContext.GetColorTexture(), colorDesc);
+        FrameResource sceneColor, sceneDepth, depthView;
+        // deferred: the scene pass fills the G-buffer and the lighting pass produces the scene color
+        GBuffer gbuffer;
+        if (shadows) {
+            // the near cascades in full, the cached ones get their moving casters drawn over the static ones kept from
+            // earlier frames, the scene pass samples the map afterwards
+            frameGraph->AddPass("shadow maps", [&](FramePassBuilder& builder) {
+                builder.SetSideEffect();
+            }, [&]() {
+                shadowCasterCount = 0;
+                shadowShader.use();
+                shadowShader.setMat4("view", shadowMap->GetView());
+                for (int i = 0; i < CascadedShadowMap::CASCADE_COUNT; i++) {
+                    bool cached = shadowMap->IsCached(i);
+                    if (cached && !shadowMap->NeedsRender(i) && movingCubes.empty()) {
+                        shadowMap->UseStaticCasters(i);
+                        continue;
+                    }
+                    shadowCasters.clear();
+                    cubeBvh.CullFrustum(Frustum(shadowMap->GetViewProjection(i)), shadowCasters);
+                    GpuScope cascadeScope(*gpuProfiler, cascadeScopeNames[i]);
+                    shadowShader.setMat4("projection", shadowMap->GetProjection(i));
+                    if (!cached) {
+                        shadowMap->BeginCascade(i);
+                        staticBatch->Draw(shadowCasters, 0);
+                        shadowCasterCount += (uint32_t)shadowCasters.size();
+                        continue;
+                    }
+                    movingShadowCasters.clear();
+                    size_t staticCount = 0;
+                    for (uint32_t cube : shadowCasters) {
+                        if (cubeMovedFrame[cube] >= 0)
+                            movingShadowCasters.push_back(cube);
+                        else
+                            shadowCasters[staticCount++] = cube;
+                    }
+                    shadowCasters.resize(staticCount);
+                    if (shadowMap->NeedsRender(i)) {
+                        shadowMap->BeginStaticCasters(i);
+                        staticBatch->Draw(shadowCasters, 0);
+                        shadowCasterCount += (uint32_t)shadowCasters.size();
+                    }
+                    if (movingShadowCasters.empty()) {
+                        shadowMap->UseStaticCasters(i);
+                    } else {
+                        shadowMap->BeginDynamicCasters(i);
+                        staticBatch->Draw(movingShadowCasters, 0);
+                        shadowCasterCount += (uint32_t)movingShadowCasters.size();
+                    }
+                }
+                shadowMap->End();
+            });
+        }
+        frameGraph->AddPass(deferred ? "g-buffer" : "scene", [&](FramePassBuilder& builder) {
+            if (deferred) {
+                gbuffer = deferredRenderer->CreateGBuffer(builder, fbWidth, fbHeight);
+                sceneDepth = gbuffer.depthStencil;
+            } else {
+                sceneColor = builder.Create("scene color", colorDesc);
+                sceneDepth = builder.Create("scene depth", depthDesc);
+            }
+        }, [&]() {
+            if (deferred)
+                deferredRenderer->ClearGBuffer();
+            else
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
-        lightShader.use();
-        lightShader.setMat4("projection", projection);
-        lightShader.setMat4("view", view);
-        model = glm::mat4(1.0f);
-        model = glm::translate(model, lightPos);
-        model = glm::scale(model, glm::vec3(0.2f)); // a smaller cube
-        lightShader.setMat4("model", model);
+            // per frame uniforms, the queue sets the model matrix and the object color. Uniforms a program doesn't
+            // have are ignored, so every program gets the lot.
+            for (Shader* shader : {&objectProgram, &batchProgram, &uboProgram}) {
+                shader->use();
+                shader->setVec3("objectColor", snapshot.objectColor);
+                shader->setVec3("lightColor",  snapshot.lightColor);
+                shader->setVec3("lightPos", snapshot.lightPos);
+                shader->setMat4("projection", projection);
+                shader->setMat4("view", view);
+                shader->setVec3("ambientColor", snapshot.lightColor);
+                shader->setVec2("screenSize", glm::vec2((float)fbWidth, (float)fbHeight));
+                shader->setFloat("zNear", 0.1f);
+                shader->setFloat("zFar", 100.0f);
+                shader->setVec3("sunDirection", sunDir);
+                shader->setVec3("sunColor", sunColor);
+                shader->setBool("shadowsEnabled", shadows);
+                if (shadows)
+                    shadowMap->Apply(*shader);
+            }
+            lightShader.use();
+            lightShader.setMat4("projection", projection);
+            lightShader.setMat4("view", view);
+            if (clustered)
+                lightClusterer->Bind(1);
+            shadowMap->Bind(4);
 
-        glBindVertexArray(lightVAO);
-        glDrawArrays(GL_TRIANGLES, 0, 36);
+            renderQueue.GetMaterial(objectMaterial).color = snapshot.objectColor;
+            renderQueue.GetMaterial(pickMaterial).color = pickColor;
+            renderQueue.GetMaterial(lightMaterial).color = snapshot.lightColor;
+            renderQueue.Clear();
+            batchDraws.clear();
+            for (uint32_t i : visibleCubes) {
+                // the picked cube needs its own color, so it stays in the queue
+                if (drawPath != DRAW_PATH_QUEUE && (int)i != pickedCube) {
+                    batchDraws.push_back(i);
+                    continue;
+                }
+                const glm::mat4& model = snapshot.worldMatrices[i];
+                uint32_t material = (int)i == pickedCube ? pickMaterial : objectMaterial;
+                float depth = glm::dot(glm::vec3(model[3]) - frameCamera.Position, frameCamera.Front);
+                DrawItem item = {objectProgram.ID, objectVAO, material, GL_TRIANGLES, 0, 36, model};
+                renderQueue.Submit(RENDER_PASS_OPAQUE, item, depth);
+            }
+            // the light cube is unlit, deferred draws it after the lighting pass
+            if (!deferred) {
+                const glm::mat4& lightModel = snapshot.worldMatrices[lightNode];
+                float lightDepth = glm::dot(glm::vec3(lightModel[3]) - frameCamera.Position, frameCamera.Front);
+                DrawItem lightItem = {lightShader.ID, lightVAO, lightMaterial, GL_TRIANGLES, 0, 36, lightModel};
+                renderQueue.Submit(RENDER_PASS_OPAQUE, lightItem, lightDepth);
+            }
 
-        ImGui::Render();
-        ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+            // the hi-z passes and imgui bind behind the cache's back
+            glState.Invalidate();
+            glState.ResetStats();
+            renderQueue.Sort();
+            gpuProfiler->BeginScope("render queue");
+            renderQueue.Execute(glState);
+            gpuProfiler->EndScope();
 
-        // glfw: swap buffer and poll IO events
-        glfwSwapBuffers(window);
+            gpuProfiler->BeginScope("cube field");
+            if (drawPath == DRAW_PATH_BATCH) {
+                glState.UseProgram(batchProgram.ID);
+                staticBatch->Draw(batchDraws, 0);
+                uint32_t fullMesh = detailed ? lodMeshes[0] : cubeMesh;
+                fullDetailTriangles = (uint32_t)batchDraws.size() * staticBatch->GetMeshTriangleCount(fullMesh);
+            } else if (drawPath == DRAW_PATH_RECORDED) {
+                // a few buffers per thread so the workers can balance, each chunk of cubes records into its own buffer
+                uint32_t count = (uint32_t)batchDraws.size();
+                uint32_t bufferCount = jobs.GetThreadCount() * 4;
+                uint32_t chunkSize = std::max(1u, (count + bufferCount - 1) / bufferCount);
+                commandExecutor->Begin((count + chunkSize - 1) / chunkSize);
+                jobs.ParallelFor(count, chunkSize, [&](uint32_t begin, uint32_t end) {
+                    CommandBuffer& commands = commandExecutor->GetBuffer(begin / chunkSize);
+                    commands.UseProgram(uboProgram.ID);
+                    commands.BindVertexArray(objectVAO);
+                    for (uint32_t i = begin; i < end; i++) {
+                        ObjectUniforms uniforms;
+                        uniforms.model = snapshot.worldMatrices[batchDraws[i]];
+                        uniforms.normalMatrix = glm::transpose(glm::inverse(uniforms.model));
+                        commands.BindUniforms(0, &uniforms, sizeof(uniforms));
+                        commands.DrawArrays(GL_TRIANGLES, 0, 36);
+                    }
+                });
+                commandExecutor->Execute(glState);
+            } else if (drawPath == DRAW_PATH_MESHLETS) {
+                // the workers cull the meshlets of the cubes, then each cube's survivors go out in one draw
+                uint32_t count = (uint32_t)batchDraws.size();
+                if (meshletLists.size() < count)
+                    meshletLists.resize(count);
+                Frustum frustum(projection * view);
+                jobs.ParallelFor(count, 64, [&](uint32_t begin, uint32_t end) {
+                    PROFILE_SCOPE("meshlet cull");
+                    for (uint32_t i = begin; i < end; i++) {
+                        meshletLists[i].Clear();
+                        meshletMesh->Cull(snapshot.worldMatrices[batchDraws[i]], frustum, frameCamera.Position,
+                                          meshletLists[i]);
+                    }
+                });
+                glState.UseProgram(objectProgram.ID);
+                // the queue may have left the picked color behind
+                objectProgram.setVec3("objectColor", snapshot.objectColor);
+                GLint modelLocation = glGetUniformLocation(objectProgram.ID, "model");
+                meshletStats = MeshletStats();
+                for (uint32_t i = 0; i < count; i++) {
+                    glUniformMatrix4fv(modelLocation, 1, GL_FALSE, &snapshot.worldMatrices[batchDraws[i]][0][0]);
+                    meshletMesh->Draw(meshletLists[i]);
+                    meshletStats.tested += meshletLists[i].stats.tested;
+                    meshletStats.frustumCulled += meshletLists[i].stats.frustumCulled;
+                    meshletStats.coneCulled += meshletLists[i].stats.coneCulled;
+                }
+                // Draw() bound the meshlet VAO behind the cache's back
+                glState.Invalidate();
+            }
+            gpuProfiler->EndScope();
+        });
+        if (deferred) {
+            frameGraph->AddPass("deferred lighting", [&](FramePassBuilder& builder) {
+                // created first so it is attachment 0
+                sceneColor = builder.Create("scene color", colorDesc);
+                deferredRenderer->UseGBuffer(builder, gbuffer);
+            }, [&]() {
+                deferredRenderer->Light(*frameGraph, gbuffer, pointLights, view, projection,
+                                        glm::radians(frameCamera.Zoom), viewAspect,
+                                        snapshot.lightColor, glm::vec3(clearColor));
+                lightShader.use();
+                lightShader.setMat4("model", snapshot.worldMatrices[lightNode]);
+                glBindVertexArray(lightVAO);
+                glDrawArrays(GL_TRIANGLES, 0, 36);
+                glState.Invalidate();
+            });
+        }
+        if (occlusionCulling) {
+            // this frame's depth is what next frame's candidates are tested against
+            frameGraph->AddPass("hi-z", [&](FramePassBuilder& builder) {
+                builder.Read(sceneDepth);
+                builder.SetSideEffect();
+            }, [&]() {
+                glBindFramebuffer(GL_FRAMEBUFFER, frameGraph->GetFramebuffer({sceneDepth}));
+                hiz->BuildPyramid(frameCamera.Position, frameCamera.Front, projection * view);
+            });
+        }
+        frameGraph->AddPass("depth view", [&](FramePassBuilder& builder) {
+            builder.Read(sceneDepth);
+            depthView = builder.Create("depth view", colorDesc);
+        }, [&]() {
+            glDisable(GL_DEPTH_TEST);
+            depthViewShader.use();
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_2D, frameGraph->GetTexture(sceneDepth));
+            glBindVertexArray(emptyVAO);
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+            glEnable(GL_DEPTH_TEST);
+        });
+        std::string capturePath;
+        if (goldenMode != GOLDEN_NONE) {
+            // on the last frame of the view
+            if (frame % GOLDEN_VIEW_FRAMES == GOLDEN_VIEW_FRAMES - 1) {
+                const std::string& directory = goldenMode == GOLDEN_UPDATE ? goldenDir : GOLDEN_OUT_DIR;
+                capturePath = directory + "/" + GOLDEN_VIEWS[frame / GOLDEN_VIEW_FRAMES].name + ".png";
+            }
+        } else if (capturingFrames || screenshotRequested) {
+            char name[32];
+            std::snprintf(name, sizeof(name), "%s_%05d.%s", capturingFrames ? "frame" : "screenshot", frame,
+                          captureRaw ? "rgba" : "png");
+            capturePath = captureDir + "/" + name;
+            screenshotRequested = false;
+        }
+        if (!capturePath.empty()) {
+            // what present shows, without the ui
+            frameGraph->AddPass("capture", [&](FramePassBuilder& builder) {
+                builder.Read(showDepth ? depthView : sceneColor);
+                builder.SetSideEffect();
+            }, [&]() {
+                frameCapture->Capture(frameGraph->GetFramebuffer({showDepth ? depthView : sceneColor}), fbWidth,
+                                      fbHeight, capturePath);
+            });
+        }
+        frameGraph->AddPass("present", [&](FramePassBuilder& builder) {
+            builder.Read(showDepth ? depthView : sceneColor);
+            builder.Write(backbuffer);
+        }, [&]() {
+            glBindFramebuffer(GL_READ_FRAMEBUFFER, frameGraph->GetFramebuffer({showDepth ? depthView : sceneColor}));
+            glBlitFramebuffer(0, 0, fbWidth, fbHeight, 0, 0, fbWidth, fbHeight, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        });
+        frameGraph->Compile();
+        frameGraph->Execute();
+        frameCapture->Update();
+
+        // headless, the ui goes on top of the offscreen target so the frame costs what it would in the window
+        if (headless)
+            glBindFramebuffer(GL_FRAMEBUFFER, headlessContext.GetFramebuffer());
+        {
+            PROFILE_SCOPE("imgui");
+            GpuScope imguiScope(*gpuProfiler, "imgui");
+            ImGui::Render();
+            ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
+        }
+        framePacer->EndRender();
+        gpuProfiler->EndFrame();
+
+        frameBenchmark.EndFrame();
+        if (headless) {
+            frameCpuMs.push_back(
+                std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count());
+        } else {
+            // glfw: swap buffer and poll IO events
+            PROFILE_SCOPE("swap");
+            glfwSwapBuffers(window);
+        }
+        framePacer->EndFrame();
+        if (pipelineFrame) {
+            PROFILE_SCOPE("wait simulation");
+            simulationStage->Wait();
+            front = 1 - front;
+            snapshotReady = true;
+        }
+        CpuProfiler::Get().EndFrame();
+        GLCallCounter::Get().EndFrame();
+        frame++;
+    }
+    frameCapture->Flush();
+    const CaptureStats& captureStats = frameCapture->GetStats();
+    int exitCode = 0;
+    if (goldenMode == GOLDEN_UPDATE) {
+        LOG_INFO("GOLDEN: %u images written to %s", captureStats.written, goldenDir.c_str());
+    } else if (goldenMode == GOLDEN_CHECK) {
+        exitCode = CheckGoldenImages(jobs);
+    } else if (captureStats.captured > 0) {
+        LOG_INFO("CAPTURE: %u frames written to %s, %u skipped, %u dropped", captureStats.written, captureDir.c_str(),
+                 captureStats.skipped, captureStats.dropped);
+    }
+    if (!cpuTracePath.empty() && CpuProfiler::Get().WriteChromeTrace(cpuTracePath))
+        LOG_INFO("CPU TRACE: %s", cpuTracePath.c_str());
+    if (benchmark) {
+        frameBenchmark.Finish();
+        // the table is written straight to the console, after what is still queued
+        Logger::Get().Flush();
+        frameBenchmark.PrintSummary(std::cout);
+        if (frameBenchmark.WriteCsv(benchmarkCsv))
+            LOG_INFO("BENCHMARK CSV: %s", benchmarkCsv.c_str());
+    }
+    if (headless) {
+        // without a swap nothing waits for the gpu, the total only counts once it is done with the last frame
+        glFinish();
+        auto loopTime = std::chrono::steady_clock::now() - loopStart;
+        double totalMs = std::chrono::duration<double, std::milli>(loopTime).count();
+        std::sort(frameCpuMs.begin(), frameCpuMs.end());
+        double cpuMs = 0.0;
+        for (double ms : frameCpuMs)
+            cpuMs += ms;
+        LOG_INFO("HEADLESS: %d frames at %dx%d in %g ms, %g ms per frame, %g fps", frame, headlessWidth, headlessHeight,
+                 totalMs, totalMs / frame, 1000.0 * frame / totalMs);
+        LOG_INFO("HEADLESS: cpu %g ms per frame, min %g ms, max %g ms", cpuMs / frame, frameCpuMs.front(),
+                 frameCpuMs.back());
+        if (framePacer->enabled) {
+            const FramePacingStats& pacingStats = framePacer->GetStats();
+            LOG_INFO("HEADLESS: latency %g ms, max %g ms", pacingStats.latencyMs, pacingStats.maxLatencyMs);
+        }
     }
     // optional: de-allocate all resources once they've outlived their purpose:
     // ------------------------------------------------------------------------
     glDeleteVertexArrays(1, &objectVAO);
     glDeleteVertexArrays(1, &lightVAO);
+    glDeleteVertexArrays(1, &emptyVAO);
     glDeleteBuffers(1, &VBO);
     glDeleteProgram(objectShader.ID);
     glDeleteProgram(lightShader.ID);
+    glDeleteProgram(batchShader.ID);
+    glDeleteProgram(uboShader.ID);
+    glDeleteProgram(objectClusteredShader.ID);
+    glDeleteProgram(batchClusteredShader.ID);
+    glDeleteProgram(uboClusteredShader.ID);
+    glDeleteProgram(objectDeferredShader.ID);
+    glDeleteProgram(batchDeferredShader.ID);
+    glDeleteProgram(uboDeferredShader.ID);
+    glDeleteProgram(shadowShader.ID);
+    glDeleteProgram(depthViewShader.ID);
+    staticBatch.reset();
+    meshletMesh.reset();
+    commandExecutor.reset();
+    frameGraph.reset();
+    gpuProfiler.reset();
+    frameCapture.reset();
+    simulationStage.reset();
+    framePacer.reset();
+    lightClusterer.reset();
+    deferredRenderer.reset();
+    shadowMap.reset();
+    hiz.reset();
 
     // terminate imgui
     ImGui_ImplOpenGL3_DestroyFontsTexture();
     ImGui_ImplOpenGL3_DestroyDeviceObjects();
     ImGui_ImplOpenGL3_Shutdown();
-    ImGui_ImplGlfw_Shutdown();
+    if (!headless)
+        ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext(imguiContext);
 
     // glfw: terminate, clearing all previously allocated GLFW resources
-    glfwTerminate();
+    if (headless)
+        headlessContext.Destroy();
+    else
+        glfwTerminate();
+
+    return exitCode;
+}
 
-    return 0;
+bool IsNumber(const char* arg)
+{
+    // short enough for std::stoi
+    size_t length = std::strlen(arg);
+    if (length == 0 || length > 9)
+        return false;
+    for (size_t i = 0; i < length; i++) {
+        if (arg[i] < '0' || arg[i] > '9')
+            return false;
+    }
+    return true;
 }
 
 void FrameBufferSizeCallback(GLFWwindow *window, int width, int height)
 {
-    std::cout << INFO_MSG_BEGIN << "FRAMEBUFFER SIZE CHANGED: " << "(" << width << " x " << height << ")" << INFO_MSG_END << std::endl;
+    LOG_DEBUG("FRAMEBUFFER SIZE CHANGED: (%d x %d)", width, height);
     glViewport(0, 0, width, height);
 }
 
-void ProcessInput(GLFWwindow * window)
+void ConsumeInput(double stepStart, double stepEnd, float heldTime[4])
 {
-    if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
-        glfwSetWindowShouldClose(window, true);
-    
-    // right-click
-    if (camera.CameraControl == false)
-        return;
-
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
-        camera.ProcessKeyboard(FORWARD, camera.deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS)
-        camera.ProcessKeyboard(BACKWARD, camera.deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS)
-        camera.ProcessKeyboard(LEFT, camera.deltaTime);
-    if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
-        camera.ProcessKeyboard(RIGHT, camera.deltaTime);
-    
-    // make sure the user stays at the ground level.
-    // camera.Position.y = 0.0f;
+    // the keys that were held before the step count from its start, events before it only change what is held
+    double from = stepStart;
+    InputEvent event;
+    while (inputQueue.Peek(event) && event.time <= stepEnd) {
+        inputQueue.Pop();
+        int movement = event.key == GLFW_KEY_W ? FORWARD
+                     : event.key == GLFW_KEY_S ? BACKWARD
+                     : event.key == GLFW_KEY_A ? LEFT
+                     : event.key == GLFW_KEY_D ? RIGHT : -1;
+        if (movement < 0)
+            continue;
+        double at = std::max(event.time, stepStart);
+        for (int i = 0; i < 4; i++) {
+            if (movementHeld[i])
+                heldTime[i] += (float)(at - from);
+        }
+        from = at;
+        movementHeld[movement] = event.action == GLFW_PRESS;
+    }
+    for (int i = 0; i < 4; i++) {
+        if (movementHeld[i])
+            heldTime[i] += (float)(stepEnd - from);
+    }
+}
+
+void SimulateFrame(FrameSnapshot& snapshot, int frame, double frameTime, double frameEnd, JobSystem& jobs)
+{
+    // the ui moved the camera since the last frame, jump there
+    if (camera.Position != drawnCameraPosition) {
+        currentState.cameraPosition = camera.Position;
+        previousState.cameraPosition = camera.Position;
+    }
+    // simulate the steps the frame's time holds, then interpolate between the last two for drawing
+    int steps = simulation.Advance(frameTime);
+    // the last frame left the interpolated position in the camera
+    camera.Position = currentState.cameraPosition;
+    for (int step = 0; step < steps; step++) {
+        previousState = currentState;
+        // the steps end where the frame does less the remainder that carries over, each moves the camera for as long
+        // as the keys were held within it
+        double stepTime = simulation.GetStepTime();
+        double stepEnd = frameEnd - (steps - 1 - step + simulation.GetAlpha()) * stepTime;
+        float heldTime[4] = {};
+        ConsumeInput(stepEnd - stepTime, stepEnd, heldTime);
+        // right-click
+        if (camera.CameraControl) {
+            for (int i = 0; i < 4; i++) {
+                if (heldTime[i] > 0.0f)
+                    camera.ProcessKeyboard((Camera_Movement)i, heldTime[i]);
+            }
+        }
+        currentState.cameraPosition = camera.Position;
+        currentState.time += simulation.GetStepTime();
+    }
+    float alpha = simulation.GetAlpha();
+    camera.Position = glm::mix(previousState.cameraPosition, currentState.cameraPosition, alpha);
+    float time = (float)(previousState.time + (currentState.time - previousState.time) * alpha);
+    sceneTime = time;
+    // the camera path while benchmarking, or the golden view
+    if (benchmark) {
+        CameraKey key = cameraPath.Sample(time);
+        camera.Position = key.position;
+        camera.SetOrientation(key.yaw, key.pitch);
+    } else if (goldenMode != GOLDEN_NONE) {
+        const GoldenView& goldenView = GOLDEN_VIEWS[std::min(frame / GOLDEN_VIEW_FRAMES, GOLDEN_VIEW_COUNT - 1)];
+        camera.Position = goldenView.position;
+        camera.SetOrientation(goldenView.yaw, goldenView.pitch);
+    }
+    drawnCameraPosition = camera.Position;
+    if (recordingPath) {
+        if (recordedPath.IsEmpty())
+            recordStart = time;
+        float recordTime = time - recordStart;
+        if (recordedPath.IsEmpty() || recordTime - recordedPath.GetDuration() >= RECORD_INTERVAL)
+            recordedPath.AddKey({recordTime, camera.Position, camera.Yaw, camera.Pitch});
+    }
+
+    // move the cubes
+    if (animateCubes)
+        UpdateCubeField(time);
+    snapshot.updatedTransforms = scene.UpdateTransforms(jobs);
+
+    snapshot.frame = frame;
+    snapshot.time = time;
+    snapshot.camera = camera;
+    snapshot.projection = camera.GetProjectionMatrix(viewAspect);
+    snapshot.view = camera.GetViewMatrix();
+    snapshot.objectColor = oc;
+    snapshot.lightColor = lc;
+    snapshot.lightPos = scene.GetPosition(lightNode);
+    snapshot.worldMatrices.resize(scene.Size());
+    for (NodeId node = 0; node < (NodeId)scene.Size(); node++)
+        snapshot.worldMatrices[node] = scene.GetWorldMatrix(node);
+    snapshot.changedNodes = scene.GetChangedNodes();
 }
 
 void MouseCallback(GLFWwindow* window, double xposIn, double yposIn)
@@ -324,6 +1524,11 @@ void OnMouseButton(GLFWwindow *window, int button, int action, int modifier)
     double x, y;
     glfwGetCursorPos(window, &x, &y);
     camera.MouseButton(button, action, x, y);
+
+    if (button == GLFW_MOUSE_BUTTON_LEFT && action == GLFW_PRESS && !ImGui::GetIO().WantCaptureMouse) {
+        pickRequested = true;
+        pickPos = glm::vec2((float)x, (float)y);
+    }
 }
 
 void OnCharEvent(GLFWwindow* window, unsigned int ch) {
@@ -333,22 +1538,138 @@ void OnCharEvent(GLFWwindow* window, unsigned int ch) {
 void OnKeyEvent(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
     ImGui_ImplGlfw_KeyCallback(window, key, scancode, action, mods);
-   
-    std::string actionStr = action == GLFW_PRESS ? "Pressed"
-                       : action == GLFW_RELEASE ? "Released"
-                       : action == GLFW_REPEAT ? "Repeat" : "Unknown";
-    std::string modsStr = mods & GLFW_MOD_SHIFT ? "S" : "-";
-    modsStr += mods & GLFW_MOD_ALT ? "A" : "-";
-
-    // std::cout << INFO_MSG_BEGIN
-    //           << "Key: " << key
-    //           << ", scancode: " << scancode
-    //           << ", action: " << actionStr
-    //           << ", mods : " << modsStr
-    //           << INFO_MSG_END << std::endl;
+    // benchmarks fly the camera path, keys would only pile up
+    if (!benchmark && action != GLFW_REPEAT)
+        inputQueue.Push({glfwGetTime(), key, action, mods});
 
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
     {
         glfwSetWindowShouldClose(window, true);
     }
-}
\ No newline at end of file
+}
+
+void ResetCubeField(int count)
+{
+    static const glm::vec3 firstPositions[] = {
+        glm::vec3(0.0f, 0.0f, 0.0f),
+        glm::vec3(2.0f, 5.0f, -15.0f),
+        glm::vec3(-1.5f, -2.2f, -2.5f),
+        glm::vec3(-3.8f, -2.0f, -12.3f),
+        glm::vec3(2.4f, -0.4f, -3.5f),
+        glm::vec3(-1.7f, 3.0f, -7.5f),
+        glm::vec3(1.3f, -2.0f, -2.5f),
+        glm::vec3(1.5f, 2.0f, -2.5f),
+        glm::vec3(1.5f, 0.2f, -1.5f),
+        glm::vec3(-1.3f, 1.0f, -1.5f)
+    };
+    // fixed seed so every run shows the same scene, the box grows with the count to keep the density
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    float extent = 4.0f * std::cbrt((float)count);
+
+    // the light keeps its place when the field is rebuilt
+    glm::vec3 lightPos = lightNode != INVALID_NODE ? scene.GetPosition(lightNode) : glm::vec3(1.2f, 1.0f, 2.0f);
+    scene.Clear();
+    scene.Reserve(count + 1);
+    for (int i = 0; i < count; i++) {
+        NodeId node = scene.CreateNode();
+        if (i < 10)
+            scene.SetPosition(node, firstPositions[i]);
+        else
+            scene.SetPosition(node, glm::vec3(dist(rng), dist(rng), dist(rng) - 1.0f) * extent);
+    }
+    lightNode = scene.CreateNode();
+    scene.SetPosition(lightNode, lightPos);
+    scene.SetScale(lightNode, glm::vec3(0.2f)); // a smaller cube
+
+    UpdateCubeField(sceneTime);
+    scene.UpdateTransforms();
+    cubeBounds.resize(count);
+    for (int i = 0; i < count; i++)
+        cubeBounds[i] = TransformAABB(cubeBox, scene.GetWorldMatrix(i));
+    cubeBvh.Build(cubeBounds);
+    pickedCube = -1;
+}
+
+void UpdateCubeField(float time)
+{
+    const glm::vec3 axis = glm::normalize(glm::vec3(1.0f, 0.3f, 0.5f));
+    for (int i = 0; i < cubeCount; i++) {
+        float angle = 20.0f * i;
+        if (animateCubes)
+            angle += 50.0f * time;
+        scene.SetRotation(i, glm::angleAxis(glm::radians(angle), axis));
+    }
+}
+
+// returns the exit code: 0 when every view matches, GOLDEN_MISSING_EXIT_CODE when references are missing but nothing
+// that could be compared failed, 1 otherwise
+int CheckGoldenImages(JobSystem& jobs)
+{
+    // the views rendered, all of them or the one --golden-view picked
+    int firstView = goldenView >= 0 ? goldenView : 0;
+    int viewCount = goldenView >= 0 ? 1 : GOLDEN_VIEW_COUNT;
+    // the views are independent, so they are compared on the workers
+    ImageDiffResult results[GOLDEN_VIEW_COUNT];
+    bool referenced[GOLDEN_VIEW_COUNT] = {};
+    bool loaded[GOLDEN_VIEW_COUNT] = {};
+    jobs.ParallelFor(viewCount, 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = firstView + begin; i < firstView + end; i++) {
+            std::string name = GOLDEN_VIEWS[i].name;
+            Image expected, actual, diff;
+            referenced[i] = LoadImageFile(goldenDir + "/" + name + ".png", expected);
+            loaded[i] = referenced[i] && LoadImageFile(GOLDEN_OUT_DIR + "/" + name + ".png", actual);
+            if (!loaded[i])
+                continue;
+            results[i] = DiffImages(expected, actual, goldenTolerance, &diff);
+            if (!results[i].passed && results[i].sizeMatches)
+                SaveImageFile(GOLDEN_OUT_DIR + "/" + name + "_diff.png", diff);
+        }
+    });
+
+    int failed = 0;
+    int missing = 0;
+    for (int i = firstView; i < firstView + viewCount; i++) {
+        const ImageDiffResult& result = results[i];
+        if (!referenced[i]) {
+            LOG_WARNING("GOLDEN: %s has no reference in %s", GOLDEN_VIEWS[i].name, goldenDir.c_str());
+            missing++;
+            continue;
+        }
+        if (!loaded[i]) {
+            LOG_ERROR("ERROR::GOLDEN::FAILED_TO_LOAD::%s", GOLDEN_VIEWS[i].name);
+        } else if (!result.sizeMatches) {
+            LOG_ERROR("ERROR::GOLDEN::SIZE_MISMATCH::%s", GOLDEN_VIEWS[i].name);
+        } else if (result.passed) {
+            LOG_INFO("GOLDEN: %s passed, %u pixels differ, %u shifted, max difference %g", GOLDEN_VIEWS[i].name,
+                     result.differentPixels, result.shiftedPixels, result.maxDifference);
+        } else {
+            LOG_ERROR("GOLDEN: %s FAILED, %u pixels differ, %u shifted, max difference %g", GOLDEN_VIEWS[i].name,
+                      result.differentPixels, result.shiftedPixels, result.maxDifference);
+        }
+        if (!loaded[i] || !result.passed)
+            failed++;
+    }
+    if (failed)
+        LOG_ERROR("GOLDEN: %d / %d views match %s", viewCount - failed - missing, viewCount, goldenDir.c_str());
+    else
+        LOG_INFO("GOLDEN: %d / %d views match %s", viewCount - missing, viewCount, goldenDir.c_str());
+    if (failed)
+        return 1;
+    return missing ? GOLDEN_MISSING_EXIT_CODE : 0;
+}
+
+int PickCube(const Ray& ray, const std::vector<glm::mat4>& worldMatrices)
+{
+    RayHit hit;
+    // the world bounds of a rotated cube are loose, test the ray against the cube in its own space
+    auto hitCube = [&worldMatrices](uint32_t i, const Ray& worldRay, float& t) {
+        glm::mat4 inv = glm::inverse(worldMatrices[i]);
+        glm::vec3 origin = glm::vec3(inv * glm::vec4(worldRay.origin, 1.0f));
+        glm::vec3 direction = glm::vec3(inv * glm::vec4(worldRay.direction, 0.0f));
+        return IntersectRayAABB(Ray(origin, direction), cubeBox, t, t);
+    };
+    if (!cubeBvh.Raycast(ray, hit, hitCube))
+        return -1;
+    return (int)hit.primitive;
+}
@@ -7,18 +7,19 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include "shader.h"
+#include "logger.h"
 
 void FrameBufferSizeCallback(GLFWwindow *window, int width, int height);
 void ProcessInput(GLFWwindow * window);
 
 int main(int argc, char** argv)
 {
-    std::cout << "START THE PROGRAM" << std::endl;
-    std::cout << "INITIALIZE GLFW LIBRARY" << std::endl;
+    LOG_INFO("START THE PROGRAM");
+    LOG_INFO("INITIALIZE GLFW LIBRARY");
     if (!glfwInit()) {
         const char* description = nullptr;
         glfwGetError(&description);
-        std::cout << "ERROR::MAIN::FAILED_TO_INITIALIZE_GLFW_LIB::" << description << std::endl;
+        LOG_ERROR("ERROR::MAIN::FAILED_TO_INITIALIZE_GLFW_LIB::%s", description);
         return -1;
     }
 
@@ -29,26 +30,26 @@ int main(int argc, char** argv)
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
 
-    std::cout << "CREATE GLFW WINDOW" << std::endl;
+    LOG_INFO("CREATE GLFW WINDOW");
     auto window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, WINDOW_NAME, nullptr, nullptr);
     if (!window) {
-        std::cout << "ERROR::MAIN::FAILED_TO_CREATE_GLFW_WINDOW" << std::endl;
+        LOG_ERROR("ERROR::MAIN::FAILED_TO_CREATE_GLFW_WINDOW");
         glfwTerminate();
         return -1;
     }
     glfwMakeContextCurrent(window);
     glfwSetFramebufferSizeCallback(window, FrameBufferSizeCallback);
 
-    std::cout << "LOAD ALL OPENGL FUNCTION POINTERS" << std::endl;
+    LOG_INFO("LOAD ALL OPENGL FUNCTION POINTERS");
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
-        std::cout << "ERROR::MAIN::FAILED_TO_INITIALIZE_GLAD" << std::endl;
+        LOG_ERROR("ERROR::MAIN::FAILED_TO_INITIALIZE_GLAD");
         glfwTerminate();
         return -1;
     }
     auto glVersion = glGetString(GL_VERSION);
-    std::cout << "OPENGL CONTEXT VERSION: " << (char*)glVersion << std::endl;
+    LOG_DEBUG("OPENGL CONTEXT VERSION: %s", (const char*)glVersion);
 
-    std::cout << "BUILD AND COMPILE SHADER PROGRAM" << std::endl;
+    LOG_INFO("BUILD AND COMPILE SHADER PROGRAM");
     Shader shader("./shader/texture.vs", "./shader/texture.fs");
 
     float vertices[] = {
@@ -109,7 +110,7 @@ int main(int argc, char** argv)
     // check maximum number of vertex attributes supported
     int nrAttributes;
     glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &nrAttributes);
-    std::cout << "MAXIMUM NUMBER OF VERTEX ATTRIBUTES SUPPORTED: " << nrAttributes << std::endl;
+    LOG_DEBUG("MAXIMUM NUMBER OF VERTEX ATTRIBUTES SUPPORTED: %d", nrAttributes);
 
     // uncomment this call to draw in wireframe polygons.
     //glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
@@ -130,7 +131,7 @@ int main(int argc, char** argv)
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
         glGenerateMipmap(GL_TEXTURE_2D);
     } else {
-        std::cout << "ERROR::MAIN::FAILED TO LOAD TEXTURE" << std::endl;
+        LOG_ERROR("ERROR::MAIN::FAILED TO LOAD TEXTURE");
     }
     stbi_image_free(data);
 
@@ -147,7 +148,7 @@ int main(int argc, char** argv)
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
         glGenerateMipmap(GL_TEXTURE_2D);
     } else {
-        std::cout << "ERROR::MAIN::FAILED TO LOAD TEXTURE" << std::endl;
+        LOG_ERROR("ERROR::MAIN::FAILED TO LOAD TEXTURE");
     }
     stbi_image_free(data);
 
@@ -161,7 +162,7 @@ int main(int argc, char** argv)
     // uint32_t transformLoc = glGetUniformLocation(shader.ID, "transform");
     // glUniformMatrix4fv(transformLoc, 1, GL_FALSE, glm::value_ptr(trans));
 
-    std::cout << "START MAIN LOOP" << std::endl;
+    LOG_INFO("START MAIN LOOP");
     // render loop
     while (!glfwWindowShouldClose(window)) {
         // input
@@ -216,7 +217,7 @@ int main(int argc, char** argv)
 
 void FrameBufferSizeCallback(GLFWwindow *window, int width, int height)
 {
-    std::cout << "FRAMEBUFFER SIZE CHANGED: " << "(" << width << " x " << height << ")" << std::endl;
+    LOG_DEBUG("FRAMEBUFFER SIZE CHANGED: (%d x %d)", width, height);
     glViewport(0, 0, width, height);
 }
 
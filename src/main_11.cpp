@@ -12,13 +12,8 @@
 
 #include "shader.h"
 #include "camera.h"
+#include "logger.h"
 
-#define OK_MSG_BEGIN "\033[96m"
-#define OK_MSG_END "\033[0m"
-#define ERR_MSG_BEGIN "\033[91m"
-#define ERR_MSG_END "\033[0m"
-#define INFO_MSG_BEGIN "\033[93m"
-#define INFO_MSG_END "\033[0m"
 
 void FrameBufferSizeCallback(GLFWwindow *window, int width, int height);
 void ProcessInput(GLFWwindow * window);
@@ -36,12 +31,12 @@ glm::vec4 clearColor { glm::vec4(0.1f, 0.2f, 0.3f, 0.0f) };
 
 int main(int argc, char** argv)
 {
-    std::cout << OK_MSG_BEGIN << "START THE PROGRAM" << OK_MSG_END << std::endl;
-    std::cout << OK_MSG_BEGIN << "INITIALIZE GLFW LIBRARY" << OK_MSG_END << std::endl;
+    LOG_INFO("START THE PROGRAM");
+    LOG_INFO("INITIALIZE GLFW LIBRARY");
     if (!glfwInit()) {
         const char* description = nullptr;
         glfwGetError(&description);
-        std::cout << ERR_MSG_BEGIN << "ERROR::MAIN::FAILED_TO_INITIALIZE_GLFW_LIB::" << description << ERR_MSG_END << std::endl;
+        LOG_ERROR("ERROR::MAIN::FAILED_TO_INITIALIZE_GLFW_LIB::%s", description);
         return -1;
     }
 
@@ -52,10 +47,10 @@ int main(int argc, char** argv)
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
 
-    std::cout << OK_MSG_BEGIN << "CREATE GLFW WINDOW" << OK_MSG_END << std::endl;
+    LOG_INFO("CREATE GLFW WINDOW");
     auto window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, WINDOW_NAME, nullptr, nullptr);
     if (!window) {
-        std::cout << ERR_MSG_BEGIN << "ERROR::MAIN::FAILED_TO_CREATE_GLFW_WINDOW" << ERR_MSG_END << std::endl;
+        LOG_ERROR("ERROR::MAIN::FAILED_TO_CREATE_GLFW_WINDOW");
         glfwTerminate();
         return -1;
     }
@@ -67,14 +62,14 @@ int main(int argc, char** argv)
     glfwSetScrollCallback(window, ScrollCallback);
     glfwSetMouseButtonCallback(window, OnMouseButton);
 
-    std::cout << OK_MSG_BEGIN << "LOAD ALL OPENGL FUNCTION POINTERS" << OK_MSG_END << std::endl;
+    LOG_INFO("LOAD ALL OPENGL FUNCTION POINTERS");
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
-        std::cout << ERR_MSG_BEGIN << "ERROR::MAIN::FAILED_TO_INITIALIZE_GLAD" << ERR_MSG_END << std::endl;
+        LOG_ERROR("ERROR::MAIN::FAILED_TO_INITIALIZE_GLAD");
         glfwTerminate();
         return -1;
     }
     auto glVersion = glGetString(GL_VERSION);
-    std::cout << INFO_MSG_BEGIN << "OPENGL CONTEXT VERSION: " << (char*)glVersion << INFO_MSG_END << std::endl;
+    LOG_DEBUG("OPENGL CONTEXT VERSION: %s", (const char*)glVersion);
 
     // imgui is set up 
     auto imguiContext = ImGui::CreateContext();
@@ -84,7 +79,7 @@ int main(int argc, char** argv)
     ImGui_ImplOpenGL3_CreateFontsTexture();
     ImGui_ImplOpenGL3_CreateDeviceObjects();
 
-    std::cout << OK_MSG_BEGIN << "BUILD AND COMPILE SHADER PROGRAM" << OK_MSG_END << std::endl;
+    LOG_INFO("BUILD AND COMPILE SHADER PROGRAM");
     Shader shader("../shader/texture.vs", "../shader/texture.fs");
 
    
@@ -165,7 +160,7 @@ int main(int argc, char** argv)
     // check maximum number of vertex attributes supported
     int nrAttributes;
     glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &nrAttributes);
-    std::cout << INFO_MSG_BEGIN << "MAXIMUM NUMBER OF VERTEX ATTRIBUTES SUPPORTED: " << nrAttributes << INFO_MSG_END << std::endl;
+    LOG_DEBUG("MAXIMUM NUMBER OF VERTEX ATTRIBUTES SUPPORTED: %d", nrAttributes);
 
     // load and create textures
     unsigned int texture1;
@@ -184,7 +179,7 @@ int main(int argc, char** argv)
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
         glGenerateMipmap(GL_TEXTURE_2D);
     } else {
-        std::cout << ERR_MSG_BEGIN << "ERROR::MAIN::FAILED TO LOAD TEXTURE" << ERR_MSG_END << std::endl;
+        LOG_ERROR("ERROR::MAIN::FAILED TO LOAD TEXTURE");
     }
     stbi_image_free(data);
 
@@ -203,7 +198,7 @@ int main(int argc, char** argv)
         glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
         glGenerateMipmap(GL_TEXTURE_2D);
     } else {
-        std::cout << ERR_MSG_BEGIN << "ERROR::MAIN::FAILED TO LOAD TEXTURE" << ERR_MSG_END << std::endl;
+        LOG_ERROR("ERROR::MAIN::FAILED TO LOAD TEXTURE");
     }
     stbi_image_free(data);
 
@@ -215,7 +210,7 @@ int main(int argc, char** argv)
     // tell OpenGL to enable depth testing
     glEnable(GL_DEPTH_TEST);
 
-    std::cout << OK_MSG_BEGIN << "START MAIN LOOP" << OK_MSG_END << std::endl;
+    LOG_INFO("START MAIN LOOP");
     // render loop
     while (!glfwWindowShouldClose(window)) {
         glfwPollEvents();
@@ -308,7 +303,7 @@ int main(int argc, char** argv)
 
 void FrameBufferSizeCallback(GLFWwindow *window, int width, int height)
 {
-    std::cout << INFO_MSG_BEGIN << "FRAMEBUFFER SIZE CHANGED: " << "(" << width << " x " << height << ")" << INFO_MSG_END << std::endl;
+    LOG_DEBUG("FRAMEBUFFER SIZE CHANGED: (%d x %d)", width, height);
     glViewport(0, 0, width, height);
 }
 
@@ -374,18 +369,11 @@ void OnKeyEvent(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
     ImGui_ImplGlfw_KeyCallback(window, key, scancode, action, mods);
    
-    std::string actionStr = action == GLFW_PRESS ? "Pressed"
-                       : action == GLFW_RELEASE ? "Released"
-                       : action == GLFW_REPEAT ? "Repeat" : "Unknown";
-    std::string modsStr = mods & GLFW_MOD_SHIFT ? "S" : "-";
-    modsStr += mods & GLFW_MOD_ALT ? "A" : "-";
-
-    std::cout << INFO_MSG_BEGIN
-              << "Key: " << key
-              << ", scancode: " << scancode
-              << ", action: " << actionStr
-              << ", mods : " << modsStr
-              << INFO_MSG_END << std::endl;
+    const char* actionStr = action == GLFW_PRESS ? "Pressed"
+                          : action == GLFW_RELEASE ? "Released"
+                          : action == GLFW_REPEAT ? "Repeat" : "Unknown";
+    LOG_DEBUG("Key: %d, scancode: %d, action: %s, mods : %c%c", key, scancode, actionStr,
+              mods & GLFW_MOD_SHIFT ? 'S' : '-', mods & GLFW_MOD_ALT ? 'A' : '-');
 
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
     {
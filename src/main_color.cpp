@@ -12,13 +12,7 @@
 
 #include "shader.h"
 #include "camera.h"
-
-#define OK_MSG_BEGIN "\033[96m"
-#define OK_MSG_END "\033[0m"
-#define ERR_MSG_BEGIN "\033[91m"
-#define ERR_MSG_END "\033[0m"
-#define INFO_MSG_BEGIN "\033[93m"
-#define INFO_MSG_END "\033[0m"
+#include "logger.h"
 
 void FrameBufferSizeCallback(GLFWwindow *window, int width, int height);
 void ProcessInput(GLFWwindow * window);
@@ -43,12 +37,12 @@ glm::vec3 lightPos(1.2f, 1.0f, 2.0f);
 
 int main(int argc, char** argv)
 {
-    std::cout << OK_MSG_BEGIN << "START THE PROGRAM" << OK_MSG_END << std::endl;
-    std::cout << OK_MSG_BEGIN << "INITIALIZE GLFW LIBRARY" << OK_MSG_END << std::endl;
+    LOG_INFO("START THE PROGRAM");
+    LOG_INFO("INITIALIZE GLFW LIBRARY");
     if (!glfwInit()) {
         const char* description = nullptr;
         glfwGetError(&description);
-        std::cout << ERR_MSG_BEGIN << "ERROR::MAIN::FAILED_TO_INITIALIZE_GLFW_LIB::" << description << ERR_MSG_END << std::endl;
+        LOG_ERROR("ERROR::MAIN::FAILED_TO_INITIALIZE_GLFW_LIB::%s", description);
         return -1;
     }
 
@@ -59,10 +53,10 @@ int main(int argc, char** argv)
     glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
 
-    std::cout << OK_MSG_BEGIN << "CREATE GLFW WINDOW" << OK_MSG_END << std::endl;
+    LOG_INFO("CREATE GLFW WINDOW");
     auto window = glfwCreateWindow(WINDOW_WIDTH, WINDOW_HEIGHT, WINDOW_NAME, nullptr, nullptr);
     if (!window) {
-        std::cout << ERR_MSG_BEGIN << "ERROR::MAIN::FAILED_TO_CREATE_GLFW_WINDOW" << ERR_MSG_END << std::endl;
+        LOG_ERROR("ERROR::MAIN::FAILED_TO_CREATE_GLFW_WINDOW");
         glfwTerminate();
         return -1;
     }
@@ -74,14 +68,14 @@ int main(int argc, char** argv)
     glfwSetScrollCallback(window, ScrollCallback);
     glfwSetMouseButtonCallback(window, OnMouseButton);
 
-    std::cout << OK_MSG_BEGIN << "LOAD ALL OPENGL FUNCTION POINTERS" << OK_MSG_END << std::endl;
+    LOG_INFO("LOAD ALL OPENGL FUNCTION POINTERS");
     if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
-        std::cout << ERR_MSG_BEGIN << "ERROR::MAIN::FAILED_TO_INITIALIZE_GLAD" << ERR_MSG_END << std::endl;
+        LOG_ERROR("ERROR::MAIN::FAILED_TO_INITIALIZE_GLAD");
         glfwTerminate();
         return -1;
     }
     auto glVersion = glGetString(GL_VERSION);
-    std::cout << INFO_MSG_BEGIN << "OPENGL CONTEXT VERSION: " << (char*)glVersion << INFO_MSG_END << std::endl;
+    LOG_DEBUG("OPENGL CONTEXT VERSION: %s", (const char*)glVersion);
 
     // imgui is set up 
     auto imguiContext = ImGui::CreateContext();
@@ -91,7 +85,7 @@ int main(int argc, char** argv)
     ImGui_ImplOpenGL3_CreateFontsTexture();
     ImGui_ImplOpenGL3_CreateDeviceObjects();
 
-    std::cout << OK_MSG_BEGIN << "BUILD AND COMPILE SHADER PROGRAM" << OK_MSG_END << std::endl;
+    LOG_INFO("BUILD AND COMPILE SHADER PROGRAM");
     Shader objectShader("./shader/color.vs", "./shader/color.fs");
     Shader lightShader("./shader/light_resourse.vs", "./shader/light_resourse.fs");
 
@@ -164,9 +158,9 @@ int main(int argc, char** argv)
     // check maximum number of vertex attributes supported
     int nrAttributes;
     glGetIntegerv(GL_MAX_VERTEX_ATTRIBS, &nrAttributes);
-    std::cout << INFO_MSG_BEGIN << "MAXIMUM NUMBER OF VERTEX ATTRIBUTES SUPPORTED: " << nrAttributes << INFO_MSG_END << std::endl;
+    LOG_DEBUG("MAXIMUM NUMBER OF VERTEX ATTRIBUTES SUPPORTED: %d", nrAttributes);
 
-    std::cout << OK_MSG_BEGIN << "START MAIN LOOP" << OK_MSG_END << std::endl;
+    LOG_INFO("START MAIN LOOP");
     // render loop
     while (!glfwWindowShouldClose(window)) {
         glfwPollEvents();
@@ -263,7 +257,7 @@ int main(int argc, char** argv)
 
 void FrameBufferSizeCallback(GLFWwindow *window, int width, int height)
 {
-    std::cout << INFO_MSG_BEGIN << "FRAMEBUFFER SIZE CHANGED: " << "(" << width << " x " << height << ")" << INFO_MSG_END << std::endl;
+    LOG_DEBUG("FRAMEBUFFER SIZE CHANGED: (%d x %d)", width, height);
     glViewport(0, 0, width, height);
 }
 
@@ -335,12 +329,7 @@ void OnKeyEvent(GLFWwindow* window, int key, int scancode, int action, int mods)
     std::string modsStr = mods & GLFW_MOD_SHIFT ? "S" : "-";
     modsStr += mods & GLFW_MOD_ALT ? "A" : "-";
 
-    // std::cout << INFO_MSG_BEGIN
-    //           << "Key: " << key
-    //           << ", scancode: " << scancode
-    //           << ", action: " << actionStr
-    //           << ", mods : " << modsStr
-    //           << INFO_MSG_END << std::endl;
+    // LOG_DEBUG("Key: %d, scancode: %d, action: %s, mods : %s", key, scancode, actionStr.c_str(), modsStr.c_str());
 
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS)
     {
@@ -0,0 +1,453 @@
+#include "mesh_lod.h"
+#include "logger.h"
+
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <queue>
+#include <unordered_map>
+
+namespace {
+
+const uint32_t LOD_MESH_VERSION = 1;
+// open edges are held in place this much harder than the surface
+const double BORDER_WEIGHT = 10.0;
+// a collapse may turn a triangle's normal by about 80 degrees at most
+const float MIN_NORMAL_DOT = 0.2f;
+
+// symmetric 4x4 matrix, the upper triangle row by row
+struct Quadric
+{
+    double a[10] = {};
+
+    void AddPlane(const glm::dvec3& n, double d, double weight)
+    {
+        double p[4] = {n.x, n.y, n.z, d};
+        int k = 0;
+        for (int i = 0; i < 4; i++) {
+            for (int j = i; j < 4; j++)
+                a[k++] += weight * p[i] * p[j];
+        }
+    }
+
+    void Add(const Quadric& q)
+    {
+        for (int i = 0; i < 10; i++)
+            a[i] += q.a[i];
+    }
+
+    double Evaluate(const glm::dvec3& v) const
+    {
+        double e = a[0] * v.x * v.x + 2.0 * a[1] * v.x * v.y + 2.0 * a[2] * v.x * v.z + 2.0 * a[3] * v.x
+                 + a[4] * v.y * v.y + 2.0 * a[5] * v.y * v.z + 2.0 * a[6] * v.y
+                 + a[7] * v.z * v.z + 2.0 * a[8] * v.z
+                 + a[9];
+        return std::max(e, 0.0);
+    }
+
+    // the point with the least error, false when the 3x3 part is close to singular (flat or straight regions)
+    bool Minimize(glm::dvec3& v) const
+    {
+        glm::dmat3 m(a[0], a[1], a[2], a[1], a[4], a[5], a[2], a[5], a[7]);
+        double det = glm::determinant(m);
+        if (std::abs(det) < 1e-12)
+            return false;
+        v = glm::inverse(m) * -glm::dvec3(a[3], a[6], a[8]);
+        return true;
+    }
+};
+
+struct Collapse
+{
+    double cost;
+    uint32_t from, to;
+    // versions of both vertices when the entry was pushed, stale entries are dropped when popped
+    uint32_t fromVersion, toVersion;
+    glm::dvec3 position;
+
+    bool operator>(const Collapse& other) const { return cost > other.cost; }
+};
+
+uint64_t EdgeKey(uint32_t a, uint32_t b)
+{
+    return a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+}
+
+void ComputeNormals(MeshLevel& mesh)
+{
+    size_t vertexCount = mesh.vertices.size() / 6;
+    std::vector<glm::vec3> normals(vertexCount, glm::vec3(0.0f));
+    for (size_t t = 0; t + 2 < mesh.indices.size(); t += 3) {
+        glm::vec3 p[3];
+        for (int k = 0; k < 3; k++)
+            p[k] = glm::vec3(mesh.vertices[mesh.indices[t + k] * 6], mesh.vertices[mesh.indices[t + k] * 6 + 1],
+                             mesh.vertices[mesh.indices[t + k] * 6 + 2]);
+        // not normalized, so larger triangles weigh more
+        glm::vec3 n = glm::cross(p[1] - p[0], p[2] - p[0]);
+        for (int k = 0; k < 3; k++)
+            normals[mesh.indices[t + k]] += n;
+    }
+    for (size_t v = 0; v < vertexCount; v++) {
+        float length = glm::length(normals[v]);
+        glm::vec3 n = length > 0.0f ? normals[v] / length : glm::vec3(0.0f, 1.0f, 0.0f);
+        mesh.vertices[v * 6 + 3] = n.x;
+        mesh.vertices[v * 6 + 4] = n.y;
+        mesh.vertices[v * 6 + 5] = n.z;
+    }
+}
+
+class Simplifier
+{
+public:
+    explicit Simplifier(const MeshLevel& mesh)
+    {
+        size_t vertexCount = mesh.vertices.size() / 6;
+        positions.resize(vertexCount);
+        for (size_t v = 0; v < vertexCount; v++)
+            positions[v] = glm::dvec3(mesh.vertices[v * 6], mesh.vertices[v * 6 + 1], mesh.vertices[v * 6 + 2]);
+        indices = mesh.indices;
+        liveTriangles = (uint32_t)indices.size() / 3;
+        triangleAlive.assign(liveTriangles, true);
+        vertexAlive.assign(vertexCount, true);
+        versions.assign(vertexCount, 0);
+        quadrics.resize(vertexCount);
+        vertexTriangles.resize(vertexCount);
+
+        std::unordered_map<uint64_t, uint32_t> edgeUses;
+        for (uint32_t t = 0; t < liveTriangles; t++) {
+            glm::dvec3 n = triangleNormal(t);
+            double length = glm::length(n);
+            if (length > 0.0) {
+                n /= length;
+                for (int k = 0; k < 3; k++)
+                    quadrics[indices[t * 3 + k]].AddPlane(n, -glm::dot(n, positions[indices[t * 3]]), 1.0);
+            }
+            for (int k = 0; k < 3; k++) {
+                vertexTriangles[indices[t * 3 + k]].push_back(t);
+                edgeUses[EdgeKey(indices[t * 3 + k], indices[t * 3 + (k + 1) % 3])]++;
+            }
+        }
+        for (uint32_t t = 0; t < liveTriangles; t++) {
+            glm::dvec3 n = triangleNormal(t);
+            for (int k = 0; k < 3; k++) {
+                uint32_t a = indices[t * 3 + k], b = indices[t * 3 + (k + 1) % 3];
+                if (edgeUses[EdgeKey(a, b)] != 1)
+                    continue;
+                glm::dvec3 edge = positions[b] - positions[a];
+                glm::dvec3 side = glm::cross(edge, n);
+                double length = glm::length(side);
+                if (length == 0.0)
+                    continue;
+                side /= length;
+                double d = -glm::dot(side, positions[a]);
+                quadrics[a].AddPlane(side, d, BORDER_WEIGHT);
+                quadrics[b].AddPlane(side, d, BORDER_WEIGHT);
+            }
+        }
+        for (const auto& edge : edgeUses)
+            push((uint32_t)(edge.first >> 32), (uint32_t)edge.first);
+    }
+
+    // collapses edges until at most targetTriangles are left, false when nothing could be collapsed any more
+    bool Run(uint32_t targetTriangles)
+    {
+        while (liveTriangles > targetTriangles) {
+            if (heap.empty())
+                return false;
+            Collapse c = heap.top();
+            heap.pop();
+            if (!vertexAlive[c.from] || !vertexAlive[c.to] || versions[c.from] != c.fromVersion ||
+                versions[c.to] != c.toVersion)
+                continue;
+            if (flips(c.from, c.to, c.position) || flips(c.to, c.from, c.position))
+                continue;
+            apply(c);
+        }
+        return true;
+    }
+
+    MeshLevel Extract() const
+    {
+        MeshLevel level;
+        level.error = (float)std::sqrt(maxCost);
+        std::vector<uint32_t> remap(positions.size(), UINT32_MAX);
+        for (uint32_t t = 0; t < triangleAlive.size(); t++) {
+            if (!triangleAlive[t])
+                continue;
+            for (int k = 0; k < 3; k++) {
+                uint32_t v = indices[t * 3 + k];
+                if (remap[v] == UINT32_MAX) {
+                    remap[v] = (uint32_t)level.vertices.size() / 6;
+                    level.vertices.insert(level.vertices.end(), {(float)positions[v].x, (float)positions[v].y,
+                                                                 (float)positions[v].z, 0.0f, 0.0f, 0.0f});
+                }
+                level.indices.push_back(remap[v]);
+            }
+        }
+        ComputeNormals(level);
+        return level;
+    }
+
+    uint32_t GetTriangleCount() const { return liveTriangles; }
+
+private:
+    std::vector<glm::dvec3> positions;
+    std::vector<uint32_t> indices;
+    std::vector<bool> triangleAlive;
+    std::vector<bool> vertexAlive;
+    std::vector<uint32_t> versions;
+    std::vector<Quadric> quadrics;
+    std::vector<std::vector<uint32_t>> vertexTriangles;
+    std::priority_queue<Collapse, std::vector<Collapse>, std::greater<Collapse>> heap;
+    uint32_t liveTriangles = 0;
+    double maxCost = 0.0;
+
+    glm::dvec3 triangleNormal(uint32_t t) const
+    {
+        const glm::dvec3& a = positions[indices[t * 3]];
+        return glm::cross(positions[indices[t * 3 + 1]] - a, positions[indices[t * 3 + 2]] - a);
+    }
+
+    void push(uint32_t a, uint32_t b)
+    {
+        Quadric q = quadrics[a];
+        q.Add(quadrics[b]);
+        Collapse c;
+        c.from = b;
+        c.to = a;
+        c.fromVersion = versions[b];
+        c.toVersion = versions[a];
+        if (!q.Minimize(c.position)) {
+            // no unique minimum, take the best of the ends and the middle
+            glm::dvec3 candidates[3] = {positions[a], positions[b], (positions[a] + positions[b]) * 0.5};
+            c.position = candidates[0];
+            for (const glm::dvec3& p : candidates) {
+                if (q.Evaluate(p) < q.Evaluate(c.position))
+                    c.position = p;
+            }
+        }
+        c.cost = q.Evaluate(c.position);
+        heap.push(c);
+    }
+
+    // whether moving v to position turns one of its triangles that don't also hold other over
+    bool flips(uint32_t v, uint32_t other, const glm::dvec3& position) const
+    {
+        for (uint32_t t : vertexTriangles[v]) {
+            if (!triangleAlive[t])
+                continue;
+            const uint32_t* tri = &indices[t * 3];
+            if (tri[0] == other || tri[1] == other || tri[2] == other)
+                continue;
+            glm::dvec3 p[3];
+            for (int k = 0; k < 3; k++)
+                p[k] = tri[k] == v ? position : positions[tri[k]];
+            glm::dvec3 before = triangleNormal(t);
+            glm::dvec3 after = glm::cross(p[1] - p[0], p[2] - p[0]);
+            double lengths = glm::length(before) * glm::length(after);
+            if (lengths == 0.0 || glm::dot(before, after) < MIN_NORMAL_DOT * lengths)
+                return true;
+        }
+        return false;
+    }
+
+    void apply(const Collapse& c)
+    {
+        uint32_t from = c.from, to = c.to;
+        positions[to] = c.position;
+        quadrics[to].Add(quadrics[from]);
+        vertexAlive[from] = false;
+        versions[to]++;
+        maxCost = std::max(maxCost, c.cost);
+
+        for (uint32_t t : vertexTriangles[from]) {
+            if (!triangleAlive[t])
+                continue;
+            uint32_t* tri = &indices[t * 3];
+            if (tri[0] == to || tri[1] == to || tri[2] == to) {
+                triangleAlive[t] = false;
+                liveTriangles--;
+                continue;
+            }
+            for (int k = 0; k < 3; k++) {
+                if (tri[k] == from)
+                    tri[k] = to;
+            }
+            vertexTriangles[to].push_back(t);
+        }
+        vertexTriangles[from].clear();
+
+        // drop the dead triangles and queue the edges around the merged vertex again
+        std::vector<uint32_t>& triangles = vertexTriangles[to];
+        triangles.erase(std::remove_if(triangles.begin(), triangles.end(),
+                                       [&](uint32_t t) { return !triangleAlive[t]; }), triangles.end());
+        std::vector<uint32_t> neighbors;
+        for (uint32_t t : triangles) {
+            for (int k = 0; k < 3; k++) {
+                uint32_t n = indices[t * 3 + k];
+                if (n != to && std::find(neighbors.begin(), neighbors.end(), n) == neighbors.end())
+                    neighbors.push_back(n);
+            }
+        }
+        for (uint32_t n : neighbors)
+            push(to, n);
+    }
+};
+
+} // namespace
+
+LodMesh BuildLodChain(const MeshLevel& base, int levelCount, float reduction)
+{
+    LodMesh lod;
+    lod.levels.push_back(base);
+    lod.levels[0].error = 0.0f;
+    Simplifier simplifier(base);
+    uint32_t target = base.GetTriangleCount();
+    for (int i = 1; i < levelCount; i++) {
+        target = (uint32_t)(target * reduction);
+        if (!simplifier.Run(target) && simplifier.GetTriangleCount() >= lod.levels.back().GetTriangleCount())
+            break;
+        lod.levels.push_back(simplifier.Extract());
+    }
+    return lod;
+}
+
+bool SaveLodMesh(const std::string& path, const LodMesh& mesh)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        LOG_ERROR("ERROR::MESH_LOD::FAILED_TO_OPEN::%s", path.c_str());
+        return false;
+    }
+    uint32_t header[2] = {LOD_MESH_VERSION, (uint32_t)mesh.levels.size()};
+    file.write("LODM", 4);
+    file.write((const char*)header, sizeof(header));
+    for (const MeshLevel& level : mesh.levels) {
+        uint32_t counts[2] = {(uint32_t)level.vertices.size() / 6, (uint32_t)level.indices.size()};
+        file.write((const char*)counts, sizeof(counts));
+        file.write((const char*)&level.error, sizeof(float));
+        file.write((const char*)level.vertices.data(), level.vertices.size() * sizeof(float));
+        file.write((const char*)level.indices.data(), level.indices.size() * sizeof(uint32_t));
+    }
+    return (bool)file;
+}
+
+bool LoadLodMesh(const std::string& path, LodMesh& mesh)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+    char magic[4];
+    uint32_t header[2];
+    file.read(magic, 4);
+    file.read((char*)header, sizeof(header));
+    if (!file || std::string(magic, 4) != "LODM" || header[0] != LOD_MESH_VERSION) {
+        LOG_ERROR("ERROR::MESH_LOD::NOT_A_LOD_MESH::%s", path.c_str());
+        return false;
+    }
+    // the counts are checked against what is left of the file before anything is allocated for them
+    file.seekg(0, std::ios::end);
+    uint64_t fileSize = (uint64_t)file.tellg();
+    file.seekg(4 + sizeof(header));
+    const uint64_t levelHeaderSize = 2 * sizeof(uint32_t) + sizeof(float);
+    if (header[1] == 0 || header[1] > (fileSize - 4 - sizeof(header)) / levelHeaderSize) {
+        LOG_ERROR("ERROR::MESH_LOD::TRUNCATED::%s", path.c_str());
+        return false;
+    }
+    mesh.levels.resize(header[1]);
+    for (MeshLevel& level : mesh.levels) {
+        uint32_t counts[2];
+        file.read((char*)counts, sizeof(counts));
+        file.read((char*)&level.error, sizeof(float));
+        if (!file)
+            break;
+        uint64_t dataSize = (uint64_t)counts[0] * 6 * sizeof(float) + (uint64_t)counts[1] * sizeof(uint32_t);
+        if (dataSize > fileSize - (uint64_t)file.tellg()) {
+            file.setstate(std::ios::failbit);
+            break;
+        }
+        level.vertices.resize((size_t)counts[0] * 6);
+        level.indices.resize(counts[1]);
+        file.read((char*)level.vertices.data(), level.vertices.size() * sizeof(float));
+        file.read((char*)level.indices.data(), level.indices.size() * sizeof(uint32_t));
+        if (!file)
+            break;
+        // an index past the vertices would have the gpu fetch outside the vertex buffer
+        bool inRange = level.indices.size() % 3 == 0;
+        for (size_t i = 0; i < level.indices.size() && inRange; i++)
+            inRange = level.indices[i] < counts[0];
+        if (!inRange) {
+            LOG_ERROR("ERROR::MESH_LOD::BAD_INDICES::%s", path.c_str());
+            mesh.levels.clear();
+            return false;
+        }
+    }
+    if (!file) {
+        LOG_ERROR("ERROR::MESH_LOD::TRUNCATED::%s", path.c_str());
+        mesh.levels.clear();
+        return false;
+    }
+    return true;
+}
+
+MeshLevel CreateBumpySphere(int rings, int segments)
+{
+    MeshLevel mesh;
+    const float pi = 3.14159265f;
+    auto addVertex = [&](float phi, float theta) {
+        float radius = 0.4f + 0.04f * std::sin(6.0f * theta) * std::sin(5.0f * phi)
+                     + 0.02f * std::sin(13.0f * theta + 2.0f * phi);
+        mesh.vertices.insert(mesh.vertices.end(), {radius * std::sin(phi) * std::cos(theta), radius * std::cos(phi),
+                                                   radius * std::sin(phi) * std::sin(theta), 0.0f, 0.0f, 0.0f});
+    };
+    // one vertex per pole and none doubled along the seam, so the mesh is closed
+    addVertex(0.0f, 0.0f);
+    for (int r = 1; r < rings; r++) {
+        for (int s = 0; s < segments; s++)
+            addVertex(pi * r / rings, 2.0f * pi * s / segments);
+    }
+    addVertex(pi, 0.0f);
+
+    uint32_t south = (uint32_t)mesh.vertices.size() / 6 - 1;
+    auto ring = [&](int r, int s) { return 1 + (uint32_t)((r - 1) * segments + (s % segments)); };
+    for (int s = 0; s < segments; s++) {
+        mesh.indices.insert(mesh.indices.end(), {0, ring(1, s + 1), ring(1, s)});
+        mesh.indices.insert(mesh.indices.end(), {south, ring(rings - 1, s), ring(rings - 1, s + 1)});
+    }
+    for (int r = 1; r < rings - 1; r++) {
+        for (int s = 0; s < segments; s++) {
+            uint32_t a = ring(r, s), b = ring(r, s + 1), c = ring(r + 1, s), d = ring(r + 1, s + 1);
+            mesh.indices.insert(mesh.indices.end(), {a, b, d, a, d, c});
+        }
+    }
+    ComputeNormals(mesh);
+    return mesh;
+}
+
+LodMesh BakeBumpySphere(const std::string& path)
+{
+    LodMesh lod = BuildLodChain(CreateBumpySphere(48, 64), 6);
+    for (size_t i = 0; i < lod.levels.size(); i++) {
+        LOG_INFO("LOD %zu: %u triangles, error %g", i, lod.levels[i].GetTriangleCount(), lod.levels[i].error);
+    }
+    std::error_code error;
+    std::filesystem::path directory = std::filesystem::path(path).parent_path();
+    if (!directory.empty())
+        std::filesystem::create_directories(directory, error);
+    SaveLodMesh(path, lod);
+    return lod;
+}
+
+uint32_t LodSelector::Select(uint32_t object, float distance, float scale, float pixelScale)
+{
+    uint8_t& level = levels[object];
+    uint32_t count = (uint32_t)levelErrors.size();
+    float toPixels = scale * pixelScale / std::max(distance, 1e-4f);
+    // finer as soon as the current level is over the limit, coarser only once the next one is clearly under it
+    while (level > 0 && levelErrors[level] * toPixels > maxPixelError)
+        level--;
+    while (level + 1u < count && levelErrors[level + 1] * toPixels <= maxPixelError * (1.0f - hysteresis))
+        level++;
+    return level;
+}
@@ -0,0 +1,68 @@
+#ifndef _MESH_LOD_H_
+#define _MESH_LOD_H_
+
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// one level of detail, vertices are position + normal (6 floats) like StaticBatch wants them
+struct MeshLevel
+{
+    std::vector<float> vertices;
+    std::vector<uint32_t> indices;
+    // how far the surface may be off the full detail mesh, in object space
+    float error = 0.0f;
+
+    uint32_t GetTriangleCount() const { return (uint32_t)indices.size() / 3; }
+};
+
+// levels from the full detail mesh down, errors never decrease
+struct LodMesh
+{
+    std::vector<MeshLevel> levels;
+};
+
+// Quadric error metric simplification (Garland and Heckbert): every vertex collects the planes of its triangles,
+// edges are collapsed cheapest first to the point with the least squared distance to the planes of both ends, and
+// collapses that would flip a triangle are skipped. Open edges get an extra plane at a right angle to their triangle
+// so borders keep their shape. The levels come out of a single run, each one taken once the triangle count dropped
+// to reduction times the previous level's, and their error is the largest collapse cost so far.
+LodMesh BuildLodChain(const MeshLevel& base, int levelCount, float reduction = 0.5f);
+
+// Baked LOD chain, binary and native endian:
+//   "LODM", uint32 version, uint32 level count
+//   per level: uint32 vertex count, uint32 index count, float error, vertices, indices
+bool SaveLodMesh(const std::string& path, const LodMesh& mesh);
+bool LoadLodMesh(const std::string& path, LodMesh& mesh);
+
+// a sphere with bumps on it, fits the unit cube centered at the origin
+MeshLevel CreateBumpySphere(int rings, int segments);
+// builds the LOD chain of the bumpy sphere and writes it to path, the offline step of --bake-lods
+LodMesh BakeBumpySphere(const std::string& path);
+
+// Picks a level per object from the error of each level projected to the screen: the coarsest level that stays under
+// maxPixelError. Objects only move to a coarser level once it is under the limit by the hysteresis fraction, so the
+// ones sitting at a threshold don't flip back and forth every frame.
+class LodSelector
+{
+public:
+    float maxPixelError = 1.0f;
+    float hysteresis = 0.25f;
+
+    void SetLevelErrors(const std::vector<float>& errors) { levelErrors = errors; }
+    // every object starts at full detail
+    void Resize(size_t objectCount) { levels.assign(objectCount, 0); }
+
+    // distance to the camera and the object's scale in world units, pixelScale is viewport height / (2 tan(fovY / 2)).
+    // Objects are independent, so different ones can be selected on different threads.
+    uint32_t Select(uint32_t object, float distance, float scale, float pixelScale);
+    uint32_t GetLevel(uint32_t object) const { return levels[object]; }
+
+private:
+    std::vector<float> levelErrors;
+    std::vector<uint8_t> levels;
+};
+
+#endif//_MESH_LOD_H_
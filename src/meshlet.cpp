@@ -0,0 +1,286 @@
+#include "meshlet.h"
+
+#include <algorithm>
+#include <cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define MESHLET_SSE
+#include <emmintrin.h>
+#endif
+
+// cones wider than this (the normals spread over more than about 84 degrees from the axis) can't cull anything useful
+static const float MIN_CONE_DOT = 0.1f;
+
+MeshletMesh::MeshletMesh(const MeshLevel& mesh)
+{
+    std::vector<uint32_t> indices;
+    build(mesh, indices);
+
+    size_t padded = (meshlets.size() + 3) & ~(size_t)3;
+    for (std::vector<float>* soa : {&centerX, &centerY, &centerZ, &radius, &axisX, &axisY, &axisZ, &cutoff})
+        soa->assign(padded, 0.0f);
+    for (size_t i = 0; i < meshlets.size(); i++) {
+        const Meshlet& m = meshlets[i];
+        centerX[i] = m.center.x;
+        centerY[i] = m.center.y;
+        centerZ[i] = m.center.z;
+        radius[i] = m.radius;
+        axisX[i] = m.coneAxis.x;
+        axisY[i] = m.coneAxis.y;
+        axisZ[i] = m.coneAxis.z;
+        cutoff[i] = m.coneCutoff;
+    }
+
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vertexBuffer);
+    glGenBuffers(1, &indexBuffer);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, mesh.vertices.size() * sizeof(float), mesh.vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t), indices.data(), GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glBindVertexArray(0);
+}
+
+MeshletMesh::~MeshletMesh()
+{
+    glDeleteBuffers(1, &indexBuffer);
+    glDeleteBuffers(1, &vertexBuffer);
+    glDeleteVertexArrays(1, &vao);
+}
+
+void MeshletMesh::build(const MeshLevel& mesh, std::vector<uint32_t>& indices)
+{
+    uint32_t vertexCount = (uint32_t)mesh.vertices.size() / 6;
+    uint32_t triangleCount = mesh.GetTriangleCount();
+
+    // triangles around each vertex, as offsets into one list
+    std::vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+    for (uint32_t v : mesh.indices)
+        adjacencyOffsets[v + 1]++;
+    for (uint32_t v = 0; v < vertexCount; v++)
+        adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+    std::vector<uint32_t> adjacency(mesh.indices.size());
+    std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (uint32_t t = 0; t < triangleCount; t++) {
+        for (int k = 0; k < 3; k++)
+            adjacency[fill[mesh.indices[t * 3 + k]]++] = t;
+    }
+
+    std::vector<bool> used(triangleCount, false);
+    // the meshlet a vertex was last added to
+    std::vector<uint32_t> vertexMeshlet(vertexCount, UINT32_MAX);
+    std::vector<uint32_t> meshletVertices;
+    uint32_t nextSeed = 0;
+    Meshlet current = {};
+    // sum of the triangle centroids, ties go to the triangle closest to the middle so meshlets grow round
+    glm::vec3 centroidSum(0.0f);
+    auto centroid = [&](uint32_t t) {
+        glm::vec3 sum(0.0f);
+        for (int k = 0; k < 3; k++) {
+            const float* p = &mesh.vertices[mesh.indices[t * 3 + k] * 6];
+            sum += glm::vec3(p[0], p[1], p[2]);
+        }
+        return sum / 3.0f;
+    };
+
+    auto newVertices = [&](uint32_t t) {
+        uint32_t count = 0;
+        for (int k = 0; k < 3; k++)
+            count += vertexMeshlet[mesh.indices[t * 3 + k]] != (uint32_t)meshlets.size();
+        return count;
+    };
+    auto finish = [&]() {
+        computeBounds(mesh, indices, current);
+        meshlets.push_back(current);
+        meshletVertices.clear();
+        centroidSum = glm::vec3(0.0f);
+        current = {};
+        current.firstIndex = (uint32_t)indices.size();
+    };
+
+    for (uint32_t placed = 0; placed < triangleCount; placed++) {
+        // the neighbor that adds the fewest vertices, a new meshlet when there are no free neighbors left
+        uint32_t best = UINT32_MAX;
+        uint32_t bestCost = 4;
+        float bestDistance = 0.0f;
+        glm::vec3 middle = centroidSum / std::max((float)(current.indexCount / 3), 1.0f);
+        for (uint32_t v : meshletVertices) {
+            for (uint32_t a = adjacencyOffsets[v]; a < adjacencyOffsets[v + 1]; a++) {
+                uint32_t t = adjacency[a];
+                if (used[t])
+                    continue;
+                uint32_t cost = newVertices(t);
+                float distance = glm::length(centroid(t) - middle);
+                if (cost < bestCost || (cost == bestCost && distance < bestDistance)) {
+                    best = t;
+                    bestCost = cost;
+                    bestDistance = distance;
+                }
+            }
+        }
+        if (best == UINT32_MAX) {
+            if (current.indexCount > 0)
+                finish();
+            while (used[nextSeed])
+                nextSeed++;
+            best = nextSeed;
+            bestCost = newVertices(best);
+        }
+        if (current.vertexCount + bestCost > MAX_VERTICES || current.indexCount / 3 + 1 > MAX_TRIANGLES) {
+            finish();
+            bestCost = 3;
+        }
+
+        used[best] = true;
+        centroidSum += centroid(best);
+        for (int k = 0; k < 3; k++) {
+            uint32_t v = mesh.indices[best * 3 + k];
+            if (vertexMeshlet[v] != (uint32_t)meshlets.size()) {
+                vertexMeshlet[v] = (uint32_t)meshlets.size();
+                meshletVertices.push_back(v);
+                current.vertexCount++;
+            }
+            indices.push_back(v);
+        }
+        current.indexCount += 3;
+    }
+    if (current.indexCount > 0)
+        finish();
+}
+
+void MeshletMesh::computeBounds(const MeshLevel& mesh, const std::vector<uint32_t>& indices, Meshlet& meshlet) const
+{
+    auto position = [&](uint32_t v) {
+        return glm::vec3(mesh.vertices[v * 6], mesh.vertices[v * 6 + 1], mesh.vertices[v * 6 + 2]);
+    };
+    uint32_t end = meshlet.firstIndex + meshlet.indexCount;
+
+    // sphere around the centroid of the corners, a corner may be counted more than once but that only shifts it
+    glm::vec3 center(0.0f);
+    for (uint32_t i = meshlet.firstIndex; i < end; i++)
+        center += position(indices[i]);
+    center /= (float)meshlet.indexCount;
+    float r = 0.0f;
+    for (uint32_t i = meshlet.firstIndex; i < end; i++)
+        r = std::max(r, glm::length(position(indices[i]) - center));
+    meshlet.center = center;
+    meshlet.radius = r;
+
+    std::vector<glm::vec3> normals;
+    glm::vec3 axis(0.0f);
+    for (uint32_t i = meshlet.firstIndex; i < end; i += 3) {
+        glm::vec3 a = position(indices[i]);
+        glm::vec3 n = glm::cross(position(indices[i + 1]) - a, position(indices[i + 2]) - a);
+        float length = glm::length(n);
+        if (length > 0.0f) {
+            normals.push_back(n / length);
+            axis += normals.back();
+        }
+    }
+    meshlet.coneAxis = glm::vec3(0.0f, 0.0f, 1.0f);
+    meshlet.coneCutoff = 1.0f;
+    float length = glm::length(axis);
+    if (length < 1e-6f)
+        return;
+    axis /= length;
+    float minDot = 1.0f;
+    for (const glm::vec3& n : normals)
+        minDot = std::min(minDot, glm::dot(n, axis));
+    if (minDot <= MIN_CONE_DOT)
+        return;
+    meshlet.coneAxis = axis;
+    meshlet.coneCutoff = std::sqrt(1.0f - minDot * minDot);
+}
+
+void MeshletMesh::Cull(const glm::mat4& model, const Frustum& frustum, const glm::vec3& cameraPosition,
+                       MeshletDrawList& list) const
+{
+    // everything happens in object space: the camera moves in, the planes move in with the transpose of the model
+    glm::vec3 camera = glm::vec3(glm::inverse(model) * glm::vec4(cameraPosition, 1.0f));
+    glm::mat4 toObject = glm::transpose(model);
+    glm::vec4 planes[6];
+    for (int p = 0; p < 6; p++) {
+        planes[p] = toObject * frustum.planes[p];
+        planes[p] /= glm::length(glm::vec3(planes[p]));
+    }
+
+    uint32_t count = (uint32_t)meshlets.size();
+    list.stats.instances++;
+    list.stats.tested += count;
+    auto append = [&](uint32_t i) {
+        list.counts.push_back((GLsizei)meshlets[i].indexCount);
+        list.offsets.push_back((const void*)(meshlets[i].firstIndex * sizeof(uint32_t)));
+    };
+
+    uint32_t i = 0;
+#ifdef MESHLET_SSE
+    // the arrays are padded, lanes past the last meshlet are dropped from the masks
+    __m128 camX = _mm_set1_ps(camera.x), camY = _mm_set1_ps(camera.y), camZ = _mm_set1_ps(camera.z);
+    for (; i < count; i += 4) {
+        __m128 x = _mm_loadu_ps(&centerX[i]), y = _mm_loadu_ps(&centerY[i]), z = _mm_loadu_ps(&centerZ[i]);
+        __m128 r = _mm_loadu_ps(&radius[i]);
+        __m128 negR = _mm_sub_ps(_mm_setzero_ps(), r);
+
+        // a sphere is out once it lies completely behind one plane, compare masks are all ones per lane
+        __m128 outside = _mm_setzero_ps();
+        for (const glm::vec4& plane : planes) {
+            __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, _mm_set1_ps(plane.x)), _mm_mul_ps(y, _mm_set1_ps(plane.y))),
+                                  _mm_add_ps(_mm_mul_ps(z, _mm_set1_ps(plane.z)), _mm_set1_ps(plane.w)));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(d, negR));
+        }
+
+        // backfacing once the whole sphere sees the camera outside the cone: dot(v, axis) > cutoff * (|v| + r) + r
+        __m128 vx = _mm_sub_ps(x, camX), vy = _mm_sub_ps(y, camY), vz = _mm_sub_ps(z, camZ);
+        __m128 lengthSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz));
+        __m128 distance = _mm_sqrt_ps(lengthSq);
+        __m128 along = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, _mm_loadu_ps(&axisX[i])),
+                                             _mm_mul_ps(vy, _mm_loadu_ps(&axisY[i]))),
+                                  _mm_mul_ps(vz, _mm_loadu_ps(&axisZ[i])));
+        __m128 limit = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&cutoff[i]), _mm_add_ps(distance, r)), r);
+        __m128 backfacing = _mm_cmpgt_ps(along, limit);
+
+        int lanes = count - i < 4 ? (1 << (count - i)) - 1 : 0xf;
+        int out = _mm_movemask_ps(outside) & lanes;
+        int back = _mm_movemask_ps(backfacing) & lanes & ~out;
+        int visible = lanes & ~(out | back);
+        for (int k = 0; k < 4; k++) {
+            list.stats.frustumCulled += (out >> k) & 1;
+            list.stats.coneCulled += (back >> k) & 1;
+            if (visible & (1 << k))
+                append(i + k);
+        }
+    }
+#endif
+    for (; i < count; i++) {
+        glm::vec3 center(centerX[i], centerY[i], centerZ[i]);
+        bool out = false;
+        for (const glm::vec4& plane : planes)
+            out |= glm::dot(glm::vec3(plane), center) + plane.w < -radius[i];
+        if (out) {
+            list.stats.frustumCulled++;
+            continue;
+        }
+        glm::vec3 v = center - camera;
+        float along = glm::dot(v, glm::vec3(axisX[i], axisY[i], axisZ[i]));
+        if (along > cutoff[i] * (glm::length(v) + radius[i]) + radius[i]) {
+            list.stats.coneCulled++;
+            continue;
+        }
+        append(i);
+    }
+}
+
+void MeshletMesh::Draw(const MeshletDrawList& list) const
+{
+    if (list.counts.empty())
+        return;
+    glBindVertexArray(vao);
+    glMultiDrawElements(GL_TRIANGLES, list.counts.data(), GL_UNSIGNED_INT, list.offsets.data(),
+                        (GLsizei)list.counts.size());
+    glBindVertexArray(0);
+}
@@ -0,0 +1,90 @@
+#ifndef _MESHLET_H_
+#define _MESHLET_H_
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "bounds.h"
+#include "mesh_lod.h"
+
+#include <cstdint>
+#include <vector>
+
+// a small piece of a mesh, culled on its own
+struct Meshlet
+{
+    // object space bounding sphere
+    glm::vec3 center;
+    float radius;
+    // every triangle's normal is within the cone around axis, cutoff is the sine of its half angle (1 when the
+    // triangles face too many ways for the cone to cull anything)
+    glm::vec3 coneAxis;
+    float coneCutoff;
+    // range in the index buffer
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    uint32_t vertexCount;
+};
+
+struct MeshletStats
+{
+    uint32_t instances = 0;
+    uint32_t tested = 0;
+    uint32_t frustumCulled = 0;
+    uint32_t coneCulled = 0;
+};
+
+// visible index ranges of one instance, laid out for glMultiDrawElements
+struct MeshletDrawList
+{
+    std::vector<GLsizei> counts;
+    std::vector<const void*> offsets;
+    MeshletStats stats;
+
+    void Clear()
+    {
+        counts.clear();
+        offsets.clear();
+        stats = MeshletStats();
+    }
+};
+
+// A mesh split into meshlets of at most MAX_VERTICES vertices and MAX_TRIANGLES triangles. The split is greedy: a
+// meshlet keeps taking the neighboring triangle that adds the fewest new vertices until it is full, so meshlets stay
+// compact and their bounds tight. Each meshlet gets a bounding sphere and a normal cone; Cull() tests them four at a
+// time with SSE (scalar without it) against the frustum and the camera, which throws away the meshlets outside the
+// view and the ones facing completely away from the camera. The surviving index ranges are compacted into a draw list
+// that Draw() submits with a single glMultiDrawElements.
+class MeshletMesh
+{
+public:
+    static const uint32_t MAX_VERTICES = 64;
+    static const uint32_t MAX_TRIANGLES = 124;
+
+    explicit MeshletMesh(const MeshLevel& mesh);
+    ~MeshletMesh();
+
+    // culls the meshlets of one instance and appends the visible ones to list, model may rotate, translate and scale
+    // uniformly. Touches no GL state, so instances can be culled on several threads.
+    void Cull(const glm::mat4& model, const Frustum& frustum, const glm::vec3& cameraPosition,
+              MeshletDrawList& list) const;
+    // draws the list with the bound program, the caller sets the instance's uniforms
+    void Draw(const MeshletDrawList& list) const;
+
+    const std::vector<Meshlet>& GetMeshlets() const { return meshlets; }
+
+private:
+    std::vector<Meshlet> meshlets;
+    // the meshlets' culling data again as structure of arrays, padded to a multiple of four
+    std::vector<float> centerX, centerY, centerZ, radius;
+    std::vector<float> axisX, axisY, axisZ, cutoff;
+
+    GLuint vao = 0;
+    GLuint vertexBuffer = 0;
+    GLuint indexBuffer = 0;
+
+    void build(const MeshLevel& mesh, std::vector<uint32_t>& indices);
+    void computeBounds(const MeshLevel& mesh, const std::vector<uint32_t>& indices, Meshlet& meshlet) const;
+};
+
+#endif//_MESHLET_H_
@@ -0,0 +1,63 @@
+#include "pipeline_stage.h"
+
+#include "cpu_profiler.h"
+#include "job_system.h"
+
+#include <chrono>
+
+PipelineStage::PipelineStage(const std::string& name, unsigned jobThreads)
+{
+    thread = std::thread(&PipelineStage::run, this, name, jobThreads);
+}
+
+PipelineStage::~PipelineStage()
+{
+    Wait();
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_one();
+    thread.join();
+}
+
+void PipelineStage::Kick(std::function<void(JobSystem& jobs)> function)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = std::move(function);
+        busy = true;
+    }
+    wake.notify_one();
+}
+
+void PipelineStage::Wait()
+{
+    auto start = std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this]() { return !busy; });
+    waitMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void PipelineStage::run(std::string name, unsigned jobThreads)
+{
+    CpuProfiler::Get().SetThreadName(name);
+    JobSystem jobs(jobThreads);
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        wake.wait(lock, [this]() { return stopping || busy; });
+        if (!busy)
+            return;
+        lock.unlock();
+
+        auto start = std::chrono::steady_clock::now();
+        job(jobs);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        lock.lock();
+        jobMs = ms;
+        job = nullptr;
+        busy = false;
+        done.notify_all();
+    }
+}
@@ -0,0 +1,46 @@
+#ifndef _PIPELINE_STAGE_H_
+#define _PIPELINE_STAGE_H_
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+class JobSystem;
+
+// A thread that runs one job at a time beside the thread that kicks it, the later stage of a two stage frame pipeline:
+// the job for the next frame runs while the kicking thread works on the current one, and Wait() joins them up at the
+// end of the frame. The thread has a JobSystem of its own, created on it so the job can call ParallelFor() without
+// touching the kicking thread's system.
+class PipelineStage
+{
+public:
+    PipelineStage(const std::string& name, unsigned jobThreads);
+    ~PipelineStage();
+
+    // the last job has to be waited for first
+    void Kick(std::function<void(JobSystem& jobs)> job);
+    // blocks until the job is done, returns right away when none is running
+    void Wait();
+
+    // how long the last job ran, and how long the last Wait() blocked for it
+    double GetJobMs() const { return jobMs; }
+    double GetWaitMs() const { return waitMs; }
+
+private:
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    std::function<void(JobSystem&)> job;
+    bool busy = false;
+    bool stopping = false;
+    double jobMs = 0.0;
+    double waitMs = 0.0;
+
+    void run(std::string name, unsigned jobThreads);
+};
+
+#endif//_PIPELINE_STAGE_H_
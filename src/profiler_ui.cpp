@@ -0,0 +1,46 @@
+#include "profiler_ui.h"
+
+#include <imgui.h>
+
+#include <algorithm>
+
+namespace {
+
+// FNV-1a, without the string copy std::hash<std::string> would need
+uint32_t HashName(const char* name)
+{
+    uint32_t hash = 2166136261u;
+    for (; *name; name++)
+        hash = (hash ^ (uint8_t)*name) * 16777619u;
+    return hash;
+}
+
+} // namespace
+
+void DrawFlameLane(const char* id, const std::vector<FlameBar>& bars, uint32_t rowCount, double spanMs)
+{
+    const float rowHeight = ImGui::GetTextLineHeight() + 4.0f;
+    ImVec2 origin = ImGui::GetCursorScreenPos();
+    float width = std::max(ImGui::GetContentRegionAvail().x, 100.0f);
+    float height = rowCount * rowHeight;
+    ImGui::InvisibleButton(id, ImVec2(width, height));
+    bool laneHovered = ImGui::IsItemHovered();
+    ImDrawList* drawList = ImGui::GetWindowDrawList();
+    drawList->AddRectFilled(origin, ImVec2(origin.x + width, origin.y + height), IM_COL32(30, 30, 30, 255));
+    double scale = spanMs > 0.0 ? width / spanMs : 0.0;
+    const FlameBar* hovered = nullptr;
+    for (const FlameBar& bar : bars) {
+        ImVec2 min(origin.x + (float)(bar.startMs * scale), origin.y + bar.depth * rowHeight);
+        ImVec2 max(std::max(min.x + 1.0f, origin.x + (float)((bar.startMs + bar.durationMs) * scale)),
+                   min.y + rowHeight - 1.0f);
+        float hue = (HashName(bar.name) % 1000) / 1000.0f;
+        drawList->AddRectFilled(min, max, ImColor::HSV(hue, 0.5f, 0.7f));
+        drawList->PushClipRect(min, max, true);
+        drawList->AddText(ImVec2(min.x + 2.0f, min.y + 2.0f), IM_COL32(255, 255, 255, 255), bar.name);
+        drawList->PopClipRect();
+        if (laneHovered && ImGui::IsMouseHoveringRect(min, max))
+            hovered = &bar;
+    }
+    if (hovered)
+        ImGui::SetTooltip("%s: %.3f ms", hovered->name, hovered->durationMs);
+}
@@ -0,0 +1,22 @@
+#ifndef _PROFILER_UI_H_
+#define _PROFILER_UI_H_
+
+#include <cstdint>
+#include <vector>
+
+// one scope or zone in a flame graph lane
+struct FlameBar
+{
+    const char* name;
+    uint32_t depth;
+    // from the start of the lane
+    double startMs;
+    double durationMs;
+};
+
+// draws the bars at the imgui cursor as a lane spanMs wide that fills the window, with a row per nesting level up to
+// rowCount, and a tooltip for the bar under the mouse. A bar keeps its color from frame to frame by the hash of its
+// name, id has to be unique within the window.
+void DrawFlameLane(const char* id, const std::vector<FlameBar>& bars, uint32_t rowCount, double spanMs);
+
+#endif//_PROFILER_UI_H_
@@ -0,0 +1,138 @@
+#include "render_queue.h"
+#include "cpu_profiler.h"
+
+#include <algorithm>
+#include <chrono>
+
+namespace {
+
+const int KEY_DEPTH_BITS = 20;
+const int KEY_VAO_BITS = 12;
+const int KEY_MATERIAL_BITS = 16;
+const int KEY_PROGRAM_BITS = 12;
+
+const int KEY_VAO_SHIFT = KEY_DEPTH_BITS;
+const int KEY_MATERIAL_SHIFT = KEY_VAO_SHIFT + KEY_VAO_BITS;
+const int KEY_PROGRAM_SHIFT = KEY_MATERIAL_SHIFT + KEY_MATERIAL_BITS;
+const int KEY_PASS_SHIFT = KEY_PROGRAM_SHIFT + KEY_PROGRAM_BITS;
+
+uint64_t KeyField(uint64_t value, int bits)
+{
+    return value & ((1ull << bits) - 1);
+}
+
+} // namespace
+
+uint32_t RenderQueue::AddMaterial(const Material& material)
+{
+    materials.push_back(material);
+    return (uint32_t)materials.size() - 1;
+}
+
+void RenderQueue::Clear()
+{
+    items.clear();
+    entries.clear();
+}
+
+void RenderQueue::Submit(RenderPass pass, const DrawItem& item, float viewDepth)
+{
+    const uint32_t maxDepthBucket = (1u << KEY_DEPTH_BITS) - 1;
+    float normalized = std::min(std::max(viewDepth / maxDepth, 0.0f), 1.0f);
+    uint32_t depth = (uint32_t)(normalized * maxDepthBucket);
+    // transparent surfaces blend back to front
+    if (pass == RENDER_PASS_TRANSPARENT)
+        depth = maxDepthBucket - depth;
+
+    uint64_t key = ((uint64_t)pass << KEY_PASS_SHIFT) | (KeyField(item.program, KEY_PROGRAM_BITS) << KEY_PROGRAM_SHIFT) |
+                   (KeyField(item.material, KEY_MATERIAL_BITS) << KEY_MATERIAL_SHIFT) |
+                   (KeyField(item.vao, KEY_VAO_BITS) << KEY_VAO_SHIFT) | depth;
+    entries.push_back({key, (uint32_t)items.size()});
+    items.push_back(item);
+}
+
+void RenderQueue::Sort()
+{
+    PROFILE_SCOPE("queue sort");
+    auto start = std::chrono::steady_clock::now();
+    size_t n = entries.size();
+    scratch.resize(n);
+
+    // a digit only needs a pass if it differs between keys
+    uint64_t allOnes = ~0ull, allZeros = 0;
+    for (const SortEntry& e : entries) {
+        allOnes &= e.key;
+        allZeros |= e.key;
+    }
+    uint64_t varying = allOnes ^ allZeros;
+
+    histogram.resize(1 << 16);
+    for (int shift = 0; shift < 64; shift += 16) {
+        if (((varying >> shift) & 0xffff) == 0)
+            continue;
+        std::fill(histogram.begin(), histogram.end(), 0);
+        for (const SortEntry& e : entries)
+            histogram[(e.key >> shift) & 0xffff]++;
+        uint32_t sum = 0;
+        for (uint32_t& c : histogram) {
+            uint32_t count = c;
+            c = sum;
+            sum += count;
+        }
+        for (const SortEntry& e : entries)
+            scratch[histogram[(e.key >> shift) & 0xffff]++] = e;
+        entries.swap(scratch);
+    }
+    stats.sortMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void RenderQueue::Execute(GLStateCache& state)
+{
+    float sortMs = stats.sortMs;
+    stats = RenderQueueStats();
+    stats.sortMs = sortMs;
+
+    GLuint program = UINT32_MAX;
+    GLuint vao = UINT32_MAX;
+    uint32_t material = UINT32_MAX;
+    const ProgramLocations* loc = nullptr;
+    for (const SortEntry& entry : entries) {
+        const DrawItem& item = items[entry.item];
+        if (item.program != program) {
+            state.UseProgram(item.program);
+            program = item.program;
+            loc = &getLocations(program);
+            // uniforms live in the program, so the material has to be set again
+            material = UINT32_MAX;
+            stats.programChanges++;
+        }
+        if (item.material != material) {
+            const Material& m = materials[item.material];
+            glUniform3fv(loc->objectColor, 1, &m.color[0]);
+            if (m.texture)
+                state.BindTexture(0, m.texture);
+            material = item.material;
+            stats.materialChanges++;
+        }
+        if (item.vao != vao) {
+            state.BindVertexArray(item.vao);
+            vao = item.vao;
+            stats.vaoChanges++;
+        }
+        glUniformMatrix4fv(loc->model, 1, GL_FALSE, &item.model[0][0]);
+        glDrawArrays(item.mode, item.first, item.count);
+        stats.draws++;
+    }
+}
+
+const RenderQueue::ProgramLocations& RenderQueue::getLocations(GLuint program)
+{
+    auto it = locations.find(program);
+    if (it == locations.end()) {
+        ProgramLocations loc;
+        loc.model = glGetUniformLocation(program, "model");
+        loc.objectColor = glGetUniformLocation(program, "objectColor");
+        it = locations.emplace(program, loc).first;
+    }
+    return it->second;
+}
@@ -0,0 +1,96 @@
+#ifndef _RENDER_QUEUE_H_
+#define _RENDER_QUEUE_H_
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "gl_state.h"
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+enum RenderPass {
+    RENDER_PASS_OPAQUE = 0,
+    // drawn after the opaque pass, back to front
+    RENDER_PASS_TRANSPARENT = 1
+};
+
+struct Material
+{
+    glm::vec3 color = glm::vec3(1.0f);
+    // bound to unit 0 when non-zero
+    GLuint texture = 0;
+};
+
+struct DrawItem
+{
+    GLuint program;
+    GLuint vao;
+    uint32_t material;
+    GLenum mode;
+    GLint first;
+    GLsizei count;
+    glm::mat4 model;
+};
+
+// state changes caused by the last Execute()
+struct RenderQueueStats
+{
+    uint32_t draws = 0;
+    uint32_t programChanges = 0;
+    uint32_t materialChanges = 0;
+    uint32_t vaoChanges = 0;
+    float sortMs = 0.0f;
+};
+
+// Collects the draws of a frame, each with a 64 bit sort key, and executes them in key order so draws sharing a
+// program, material and VAO end up next to each other. From the most significant bits down the key holds the pass
+// (4 bits), program (12), material (16), VAO (12) and quantized view depth (20), so within a state bucket opaque
+// draws go front to back. Program and VAO names are expected to fit their fields, which is the case for the handful
+// of objects GL hands out here.
+//
+// Per frame uniforms (view, projection, lights) are left to the caller, set them on every program before Execute();
+// the queue sets "model" per draw and "objectColor" per material.
+class RenderQueue
+{
+public:
+    uint32_t AddMaterial(const Material& material);
+    Material& GetMaterial(uint32_t material) { return materials[material]; }
+
+    void Clear();
+    // viewDepth is the distance along the view direction, anything beyond maxDepth shares the last bucket
+    void Submit(RenderPass pass, const DrawItem& item, float viewDepth);
+    // least significant digit radix sort on 16 bit digits, digits that are the same in every key are skipped
+    void Sort();
+    void Execute(GLStateCache& state);
+
+    size_t Size() const { return items.size(); }
+    float maxDepth = 100.0f;
+    const RenderQueueStats& GetStats() const { return stats; }
+
+private:
+    struct SortEntry
+    {
+        uint64_t key;
+        uint32_t item;
+    };
+
+    struct ProgramLocations
+    {
+        GLint model;
+        GLint objectColor;
+    };
+
+    std::vector<Material> materials;
+    std::vector<DrawItem> items;
+    std::vector<SortEntry> entries;
+    std::vector<SortEntry> scratch;
+    std::vector<uint32_t> histogram;
+    std::unordered_map<GLuint, ProgramLocations> locations;
+    RenderQueueStats stats;
+
+    const ProgramLocations& getLocations(GLuint program);
+};
+
+#endif//_RENDER_QUEUE_H_
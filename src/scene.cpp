@@ -0,0 +1,192 @@
+#include "scene.h"
+#include "job_system.h"
+#include "cpu_profiler.h"
+
+#include <algorithm>
+#include <atomic>
+
+NodeId Scene::CreateNode(NodeId parent)
+{
+    NodeId node = (NodeId)parents.size();
+    // parents must precede their children for the single sweep update
+    if (parent != INVALID_NODE && parent >= node)
+        parent = INVALID_NODE;
+    positions.push_back(glm::vec3(0.0f));
+    rotations.push_back(glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+    scales.push_back(glm::vec3(1.0f));
+    parents.push_back(parent);
+    worldMatrices.push_back(glm::mat4(1.0f));
+    depths.push_back(parent != INVALID_NODE ? depths[parent] + 1 : 0);
+    dirty.push_back(0);
+    changed.push_back(0);
+    levelsValid = false;
+    markDirty(node);
+    return node;
+}
+
+void Scene::Clear()
+{
+    positions.clear();
+    rotations.clear();
+    scales.clear();
+    parents.clear();
+    worldMatrices.clear();
+    depths.clear();
+    dirty.clear();
+    changed.clear();
+    changedNodes.clear();
+    changedListValid = true;
+    levelsValid = false;
+    firstDirty = INVALID_NODE;
+    changedBegin = 0;
+}
+
+void Scene::Reserve(size_t count)
+{
+    positions.reserve(count);
+    rotations.reserve(count);
+    scales.reserve(count);
+    parents.reserve(count);
+    worldMatrices.reserve(count);
+    depths.reserve(count);
+    dirty.reserve(count);
+    changed.reserve(count);
+}
+
+void Scene::SetPosition(NodeId node, const glm::vec3& position)
+{
+    positions[node] = position;
+    markDirty(node);
+}
+
+void Scene::SetRotation(NodeId node, const glm::quat& rotation)
+{
+    rotations[node] = rotation;
+    markDirty(node);
+}
+
+void Scene::SetScale(NodeId node, const glm::vec3& scale)
+{
+    scales[node] = scale;
+    markDirty(node);
+}
+
+uint32_t Scene::UpdateTransforms()
+{
+    changedListValid = false;
+    changedBegin = (NodeId)parents.size();
+    if (firstDirty == INVALID_NODE)
+        return 0;
+
+    changedBegin = firstDirty;
+    firstDirty = INVALID_NODE;
+    uint32_t updated = 0;
+    NodeId count = (NodeId)parents.size();
+    for (NodeId i = changedBegin; i < count; i++) {
+        updateNode(i);
+        updated += changed[i];
+    }
+    return updated;
+}
+
+uint32_t Scene::UpdateTransforms(JobSystem& jobs, uint32_t chunkSize)
+{
+    PROFILE_SCOPE("update transforms");
+    // not worth splitting up
+    if (jobs.GetThreadCount() == 1 || firstDirty == INVALID_NODE || parents.size() - firstDirty <= chunkSize)
+        return UpdateTransforms();
+
+    changedListValid = false;
+    changedBegin = firstDirty;
+    firstDirty = INVALID_NODE;
+    buildLevels();
+
+    std::atomic<uint32_t> updated(0);
+    for (size_t level = 0; level + 1 < levelOffsets.size(); level++) {
+        const NodeId* nodes = levelNodes.data() + levelOffsets[level];
+        uint32_t levelSize = levelOffsets[level + 1] - levelOffsets[level];
+        jobs.ParallelFor(levelSize, chunkSize, [&](uint32_t begin, uint32_t end) {
+            uint32_t chunkUpdated = 0;
+            for (uint32_t i = begin; i < end; i++) {
+                NodeId node = nodes[i];
+                if (node < changedBegin)
+                    continue;
+                updateNode(node);
+                chunkUpdated += changed[node];
+            }
+            updated.fetch_add(chunkUpdated, std::memory_order_relaxed);
+        });
+    }
+    return updated.load();
+}
+
+const std::vector<NodeId>& Scene::GetChangedNodes() const
+{
+    if (!changedListValid) {
+        changedNodes.clear();
+        for (NodeId i = changedBegin; i < (NodeId)changed.size(); i++) {
+            if (changed[i])
+                changedNodes.push_back(i);
+        }
+        changedListValid = true;
+    }
+    return changedNodes;
+}
+
+uint32_t Scene::GetLevelCount() const
+{
+    buildLevels();
+    return levelOffsets.empty() ? 0 : (uint32_t)levelOffsets.size() - 1;
+}
+
+void Scene::markDirty(NodeId node)
+{
+    dirty[node] = 1;
+    firstDirty = std::min(firstDirty, node);
+}
+
+void Scene::updateNode(NodeId node)
+{
+    // the parent was updated before, either earlier in the sweep or in the level above
+    NodeId parent = parents[node];
+    uint8_t flag = dirty[node];
+    if (parent != INVALID_NODE && parent >= changedBegin)
+        flag |= changed[parent];
+    dirty[node] = 0;
+    changed[node] = flag;
+    if (!flag)
+        return;
+    glm::mat4 local = ComposeTransform(positions[node], rotations[node], scales[node]);
+    worldMatrices[node] = parent != INVALID_NODE ? worldMatrices[parent] * local : local;
+}
+
+void Scene::buildLevels() const
+{
+    if (levelsValid)
+        return;
+    // counting sort of the node ids by depth, ids stay ascending within a level
+    uint32_t levelCount = 0;
+    for (uint32_t depth : depths)
+        levelCount = std::max(levelCount, depth + 1);
+    levelOffsets.assign(levelCount + 1, 0);
+    for (uint32_t depth : depths)
+        levelOffsets[depth + 1]++;
+    for (uint32_t level = 0; level < levelCount; level++)
+        levelOffsets[level + 1] += levelOffsets[level];
+    levelNodes.resize(depths.size());
+    std::vector<uint32_t> cursor(levelOffsets.begin(), levelOffsets.end() - 1);
+    for (NodeId node = 0; node < (NodeId)depths.size(); node++)
+        levelNodes[cursor[depths[node]]++] = node;
+    levelsValid = true;
+}
+
+glm::mat4 ComposeTransform(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale)
+{
+    glm::mat3 r = glm::mat3_cast(rotation);
+    glm::mat4 m;
+    m[0] = glm::vec4(r[0] * scale.x, 0.0f);
+    m[1] = glm::vec4(r[1] * scale.y, 0.0f);
+    m[2] = glm::vec4(r[2] * scale.z, 0.0f);
+    m[3] = glm::vec4(position, 1.0f);
+    return m;
+}
@@ -0,0 +1,75 @@
+#ifndef _SCENE_H_
+#define _SCENE_H_
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+typedef uint32_t NodeId;
+const NodeId INVALID_NODE = UINT32_MAX;
+
+// Transform storage for the scene, one entry per node in each array (structure of arrays). A node can only be
+// parented to a node created before it, so parents always come first and one forward sweep updates the hierarchy.
+// Setters only mark the node dirty; UpdateTransforms() recomputes the world matrices of dirty nodes and of everything
+// below them, and leaves the rest untouched. The parallel variant walks the hierarchy one depth level at a time and
+// splits each level into chunks for the job system, a level only depends on the one above it.
+class Scene
+{
+public:
+    NodeId CreateNode(NodeId parent = INVALID_NODE);
+    void Clear();
+    void Reserve(size_t count);
+    size_t Size() const { return parents.size(); }
+
+    void SetPosition(NodeId node, const glm::vec3& position);
+    void SetRotation(NodeId node, const glm::quat& rotation);
+    void SetScale(NodeId node, const glm::vec3& scale);
+    const glm::vec3& GetPosition(NodeId node) const { return positions[node]; }
+    const glm::quat& GetRotation(NodeId node) const { return rotations[node]; }
+    const glm::vec3& GetScale(NodeId node) const { return scales[node]; }
+    NodeId GetParent(NodeId node) const { return parents[node]; }
+    const glm::mat4& GetWorldMatrix(NodeId node) const { return worldMatrices[node]; }
+
+    // recomputes the world matrices of dirty nodes and their descendants, returns how many were recomputed
+    uint32_t UpdateTransforms();
+    uint32_t UpdateTransforms(JobSystem& jobs, uint32_t chunkSize = 4096);
+    // nodes whose world matrix changed in the last UpdateTransforms(), in ascending order
+    const std::vector<NodeId>& GetChangedNodes() const;
+    uint32_t GetLevelCount() const;
+
+private:
+    std::vector<glm::vec3> positions;
+    std::vector<glm::quat> rotations;
+    std::vector<glm::vec3> scales;
+    std::vector<NodeId> parents;
+    std::vector<glm::mat4> worldMatrices;
+    std::vector<uint32_t> depths;
+    // set by the setters
+    std::vector<uint8_t> dirty;
+    // set by the last update for every recomputed node, only valid from changedBegin on
+    std::vector<uint8_t> changed;
+    // lowest dirty node, nothing before it has to be looked at
+    NodeId firstDirty = INVALID_NODE;
+    NodeId changedBegin = 0;
+    // built on demand from the changed flags
+    mutable std::vector<NodeId> changedNodes;
+    mutable bool changedListValid = true;
+
+    // node ids sorted by depth, levelOffsets[d] is where depth d starts; rebuilt after nodes are added
+    mutable std::vector<NodeId> levelNodes;
+    mutable std::vector<uint32_t> levelOffsets;
+    mutable bool levelsValid = false;
+
+    void markDirty(NodeId node);
+    void updateNode(NodeId node);
+    void buildLevels() const;
+};
+
+// local matrix of a translation, rotation and scale, without going through three matrix products
+glm::mat4 ComposeTransform(const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale);
+
+#endif//_SCENE_H_
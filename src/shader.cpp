@@ -1,7 +1,5 @@
 #include "shader.h"
-
-#define ERR_MSG_BEGIN "\033[91m"
-#define ERR_MSG_END "\033[0m"
+#include "logger.h"
 
 Shader::Shader(const char *vertexPath, const char *fragmentPath)
 {
@@ -31,7 +29,7 @@ Shader::Shader(const char *vertexPath, const char *fragmentPath)
     }
     catch (std::ifstream::failure e)
     {
-        std::cout << ERR_MSG_BEGIN << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << ERR_MSG_END << std::endl;
+        LOG_ERROR("ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ");
     }
     const char *vShaderCode = vertexCode.c_str();
     const char *fShaderCode = fragmentCode.c_str();
@@ -48,8 +46,7 @@ Shader::Shader(const char *vertexPath, const char *fragmentPath)
     if (!success)
     {
         glGetShaderInfoLog(vertex, 512, NULL, infoLog);
-        std::cout << ERR_MSG_BEGIN << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n"
-                  << infoLog << ERR_MSG_END << std::endl;
+        LOG_ERROR("ERROR::SHADER::VERTEX::COMPILATION_FAILED\n%s", infoLog);
     }
     // fragment Shader
     fragment = glCreateShader(GL_FRAGMENT_SHADER);
@@ -59,8 +56,7 @@ Shader::Shader(const char *vertexPath, const char *fragmentPath)
     if (!success)
     {
         glGetShaderInfoLog(vertex, 512, NULL, infoLog);
-        std::cout << ERR_MSG_BEGIN << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n"
-                  << infoLog << ERR_MSG_END << std::endl;
+        LOG_ERROR("ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n%s", infoLog);
     }
 
     ID = glCreateProgram();
@@ -72,14 +68,57 @@ Shader::Shader(const char *vertexPath, const char *fragmentPath)
     if (!success)
     {
         glGetProgramInfoLog(ID, 512, NULL, infoLog);
-        std::cout << ERR_MSG_BEGIN << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n"
-                  << infoLog << ERR_MSG_END << std::endl;
+        LOG_ERROR("ERROR::SHADER::PROGRAM::LINKING_FAILED\n%s", infoLog);
     }
     // delete shaders; they’re linked into our program and no longer necessary
     glDeleteShader(vertex);
     glDeleteShader(fragment);
 }
 
+Shader::Shader(const char *vertexPath, const std::vector<const char *> &feedbackVaryings)
+{
+    std::string vertexCode;
+    std::ifstream vShaderFile;
+    vShaderFile.exceptions(std::ifstream::failbit | std::ifstream::badbit);
+    try
+    {
+        vShaderFile.open(vertexPath);
+        std::stringstream vShaderStream;
+        vShaderStream << vShaderFile.rdbuf();
+        vShaderFile.close();
+        vertexCode = vShaderStream.str();
+    }
+    catch (std::ifstream::failure &e)
+    {
+        LOG_ERROR("ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ");
+    }
+    const char *vShaderCode = vertexCode.c_str();
+    int success;
+    char infoLog[512];
+    unsigned int vertex = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(vertex, 1, &vShaderCode, NULL);
+    glCompileShader(vertex);
+    glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);
+    if (!success)
+    {
+        glGetShaderInfoLog(vertex, 512, NULL, infoLog);
+        LOG_ERROR("ERROR::SHADER::VERTEX::COMPILATION_FAILED\n%s", infoLog);
+    }
+
+    ID = glCreateProgram();
+    glAttachShader(ID, vertex);
+    // the varyings have to be declared before linking
+    glTransformFeedbackVaryings(ID, (GLsizei)feedbackVaryings.size(), feedbackVaryings.data(), GL_INTERLEAVED_ATTRIBS);
+    glLinkProgram(ID);
+    glGetProgramiv(ID, GL_LINK_STATUS, &success);
+    if (!success)
+    {
+        glGetProgramInfoLog(ID, 512, NULL, infoLog);
+        LOG_ERROR("ERROR::SHADER::PROGRAM::LINKING_FAILED\n%s", infoLog);
+    }
+    glDeleteShader(vertex);
+}
+
 void Shader::use()
 {
     glUseProgram(ID);
@@ -100,11 +139,16 @@ void Shader::setFloat(const std::string &name, float value) const
     glUniform1f(glGetUniformLocation(ID, name.c_str()), value);
 }
 
-void Shader::setMat4(const std::string &name, glm::mat4 &mat) const
+void Shader::setMat4(const std::string &name, const glm::mat4 &mat) const
 {
     glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, GL_FALSE, &mat[0][0]);
 }
 
+void Shader::setVec2(const std::string &name, const glm::vec2 &vec) const
+{
+    glUniform2fv(glGetUniformLocation(ID, name.c_str()), 1, &vec[0]);
+}
+
 void Shader::setVec3(const std::string &name, const glm::vec3& vec) const
 {
     glUniform3fv(glGetUniformLocation(ID, name.c_str()), 1, &vec[0]);
@@ -113,4 +157,19 @@ void Shader::setVec3(const std::string &name, const glm::vec3& vec) const
 void Shader::setVec3(const std::string &name, float x, float y, float z) const
 {
     glUniform3f(glGetUniformLocation(ID, name.c_str()), x, y, z);
+}
+
+void Shader::setVec4(const std::string &name, const glm::vec4 &vec) const
+{
+    glUniform4fv(glGetUniformLocation(ID, name.c_str()), 1, &vec[0]);
+}
+
+void Shader::setIVec3(const std::string &name, const glm::ivec3 &vec) const
+{
+    glUniform3iv(glGetUniformLocation(ID, name.c_str()), 1, &vec[0]);
+}
+
+void Shader::setBlockBinding(const std::string &name, unsigned int binding) const
+{
+    glUniformBlockBinding(ID, glGetUniformBlockIndex(ID, name.c_str()), binding);
 }
\ No newline at end of file
@@ -10,6 +10,7 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
 
 class Shader
 {
@@ -18,15 +19,22 @@ public:
     unsigned int ID;
     // constructor reads and builds the shader
     Shader(const char *vertexPath, const char *fragmentPath);
+    // builds a vertex-only program whose outputs are captured with transform feedback
+    Shader(const char *vertexPath, const std::vector<const char *> &feedbackVaryings);
     // use/activate the shader
     void use();
     // utility uniform functions
     void setBool(const std::string &name, bool value) const;
     void setInt(const std::string &name, int value) const;
     void setFloat(const std::string &name, float value) const;
-    void setMat4(const std::string &name, glm::mat4 &mat) const;
+    void setMat4(const std::string &name, const glm::mat4 &mat) const;
+    void setVec2(const std::string &name, const glm::vec2 &vec) const;
     void setVec3(const std::string &name, const glm::vec3 &vec) const;
     void setVec3(const std::string &name, float x, float y, float z) const;
+    void setVec4(const std::string &name, const glm::vec4 &vec) const;
+    void setIVec3(const std::string &name, const glm::ivec3 &vec) const;
+    // points the uniform block at a GL_UNIFORM_BUFFER binding point
+    void setBlockBinding(const std::string &name, unsigned int binding) const;
 };
 
 #endif//_SHADER_H_
\ No newline at end of file
@@ -0,0 +1,234 @@
+#include "shadow_map.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+
+// how much larger than its slice a cached cascade is drawn, the camera can move this far before it is redrawn
+static const float CACHE_MARGIN = 1.5f;
+// weight of the logarithmic split against the uniform one
+static const float SPLIT_LAMBDA = 0.75f;
+
+CascadedShadowMap::CascadedShadowMap(int resolution) : resolution(resolution)
+{
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, resolution, resolution, CASCADE_COUNT, 0,
+                 GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+    // linear filtering of a compared texture gives a 2x2 pcf per tap
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+    // only ever copied from, in the same format so a depth blit can do it
+    glGenTextures(1, &cacheTexture);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, cacheTexture);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, resolution, resolution, CACHED_CASCADE_COUNT, 0,
+                 GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+    GLint previous = 0;
+    glGetIntegerv(GL_FRAMEBUFFER_BINDING, &previous);
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    glGenFramebuffers(1, &cacheFramebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, cacheFramebuffer);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, cacheTexture, 0, 0);
+    glDrawBuffer(GL_NONE);
+    glReadBuffer(GL_NONE);
+    glBindFramebuffer(GL_FRAMEBUFFER, previous);
+}
+
+CascadedShadowMap::~CascadedShadowMap()
+{
+    glDeleteFramebuffers(1, &cacheFramebuffer);
+    glDeleteFramebuffers(1, &framebuffer);
+    glDeleteTextures(1, &cacheTexture);
+    glDeleteTextures(1, &texture);
+}
+
+void CascadedShadowMap::Update(const glm::mat4& view, float fovY, float aspect, float zNear, float shadowDistance,
+                               const glm::vec3& direction, const AABB& casterBounds)
+{
+    stats = ShadowStats();
+    glm::vec3 dir = glm::normalize(direction);
+    // every cached cascade is stale once the light turns
+    if (glm::length(dir - lightDirection) > 1e-4f) {
+        lightDirection = dir;
+        for (Cascade& cascade : cascades)
+            cascade.valid = false;
+    }
+    glm::vec3 up = std::abs(dir.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+    lightView = glm::lookAt(glm::vec3(0.0f), dir, up);
+
+    glm::mat4 invView = glm::inverse(view);
+    float tanHalfY = std::tan(fovY * 0.5f);
+    float tanHalfX = tanHalfY * aspect;
+    float splitNear = zNear;
+    for (int i = 0; i < CASCADE_COUNT; i++) {
+        Cascade& cascade = cascades[i];
+        float t = (float)(i + 1) / CASCADE_COUNT;
+        float logSplit = zNear * std::pow(shadowDistance / zNear, t);
+        float uniformSplit = zNear + (shadowDistance - zNear) * t;
+        float splitFar = SPLIT_LAMBDA * logSplit + (1.0f - SPLIT_LAMBDA) * uniformSplit;
+        cascade.splitFar = splitFar;
+
+        // the slice is symmetric around the view axis, so is its bounding sphere. The radius only depends on the
+        // split distances, rounding it up keeps float noise from changing the cascade size when the camera turns.
+        glm::vec3 center(0.0f);
+        glm::vec3 corners[8];
+        for (int c = 0; c < 8; c++) {
+            float z = c < 4 ? splitNear : splitFar;
+            float x = (c & 1 ? 1.0f : -1.0f) * z * tanHalfX;
+            float y = (c & 2 ? 1.0f : -1.0f) * z * tanHalfY;
+            corners[c] = glm::vec3(invView * glm::vec4(x, y, -z, 1.0f));
+            center += corners[c];
+        }
+        center /= 8.0f;
+        float radius = 0.0f;
+        for (const glm::vec3& corner : corners)
+            radius = std::max(radius, glm::length(corner - center));
+        radius = std::ceil(radius * 16.0f) / 16.0f;
+        splitNear = splitFar;
+
+        bool cached = caching && i >= FIRST_CACHED_CASCADE;
+        bool inside = glm::length(center - cascade.center) + radius <= cascade.radius;
+        if (cached && cascade.valid && !castersChanged && inside) {
+            cascade.dirty = false;
+            stats.cached++;
+            continue;
+        }
+        fitCascade(cascade, center, cached ? radius * CACHE_MARGIN : radius, casterBounds);
+        cascade.valid = cached;
+        cascade.dirty = true;
+        stats.rendered++;
+    }
+    castersChanged = false;
+}
+
+void CascadedShadowMap::fitCascade(Cascade& cascade, const glm::vec3& center, float radius,
+                                   const AABB& casterBounds)
+{
+    cascade.center = center;
+    cascade.radius = radius;
+
+    // move the center in whole texels, the projection then only ever shifts the map by whole texels
+    glm::vec3 lightCenter = glm::vec3(lightView * glm::vec4(center, 1.0f));
+    float texel = 2.0f * radius / resolution;
+    lightCenter.x = std::floor(lightCenter.x / texel) * texel;
+    lightCenter.y = std::floor(lightCenter.y / texel) * texel;
+
+    // the light looks down -z, casters between the light and the sphere still have to land in the map
+    float maxZ = lightCenter.z + radius;
+    if (casterBounds.IsValid()) {
+        for (int c = 0; c < 8; c++) {
+            glm::vec3 corner(c & 1 ? casterBounds.max.x : casterBounds.min.x,
+                             c & 2 ? casterBounds.max.y : casterBounds.min.y,
+                             c & 4 ? casterBounds.max.z : casterBounds.min.z);
+            maxZ = std::max(maxZ, (lightView * glm::vec4(corner, 1.0f)).z);
+        }
+    }
+    float minZ = lightCenter.z - radius;
+    cascade.projection = glm::ortho(lightCenter.x - radius, lightCenter.x + radius, lightCenter.y - radius,
+                                    lightCenter.y + radius, -maxZ, -minZ);
+    cascade.viewProjection = cascade.projection * lightView;
+}
+
+void CascadedShadowMap::BeginCascade(int cascade)
+{
+    beginDrawing();
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0, cascade);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    cascades[cascade].staticOnly = false;
+}
+
+void CascadedShadowMap::BeginStaticCasters(int cascade)
+{
+    beginDrawing();
+    glBindFramebuffer(GL_FRAMEBUFFER, cacheFramebuffer);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, cacheTexture, 0, cascade - FIRST_CACHED_CASCADE);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    cascades[cascade].staticOnly = false;
+}
+
+void CascadedShadowMap::BeginDynamicCasters(int cascade)
+{
+    if (!cascades[cascade].staticOnly)
+        copyStaticCasters(cascade);
+    beginDrawing();
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0, cascade);
+    cascades[cascade].staticOnly = false;
+}
+
+void CascadedShadowMap::UseStaticCasters(int cascade)
+{
+    if (!cascades[cascade].staticOnly)
+        copyStaticCasters(cascade);
+    cascades[cascade].staticOnly = true;
+}
+
+void CascadedShadowMap::copyStaticCasters(int cascade)
+{
+    beginDrawing();
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, cacheFramebuffer);
+    glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, cacheTexture, 0,
+                              cascade - FIRST_CACHED_CASCADE);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+    glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0, cascade);
+    glBlitFramebuffer(0, 0, resolution, resolution, 0, 0, resolution, resolution, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+}
+
+void CascadedShadowMap::beginDrawing()
+{
+    if (!drawing) {
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+        glGetIntegerv(GL_VIEWPORT, previousViewport);
+        drawing = true;
+    }
+    glViewport(0, 0, resolution, resolution);
+    // slope scaled bias against acne on surfaces at a grazing angle to the light
+    glEnable(GL_POLYGON_OFFSET_FILL);
+    glPolygonOffset(2.0f, 4.0f);
+}
+
+void CascadedShadowMap::End()
+{
+    if (!drawing)
+        return;
+    drawing = false;
+    glDisable(GL_POLYGON_OFFSET_FILL);
+    glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+    glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+}
+
+void CascadedShadowMap::Apply(Shader& shader) const
+{
+    glm::vec4 splits, normalOffsets;
+    for (int i = 0; i < CASCADE_COUNT; i++) {
+        shader.setMat4("lightSpace[" + std::to_string(i) + "]", cascades[i].viewProjection);
+        splits[i] = cascades[i].splitFar;
+        // about one and a half texels of the cascade, in world units
+        normalOffsets[i] = 3.0f * cascades[i].radius / resolution;
+    }
+    shader.setVec4("cascadeSplits", splits);
+    shader.setVec4("cascadeNormalOffset", normalOffsets);
+}
+
+void CascadedShadowMap::Bind(GLuint unit) const
+{
+    glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glActiveTexture(GL_TEXTURE0);
+}
@@ -0,0 +1,110 @@
+#ifndef _SHADOW_MAP_H_
+#define _SHADOW_MAP_H_
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include "bounds.h"
+#include "shader.h"
+
+struct ShadowStats
+{
+    // cascades drawn this frame and the ones reused from an earlier frame
+    uint32_t rendered = 0;
+    uint32_t cached = 0;
+};
+
+// Cascaded shadow maps for a directional light. The view frustum up to the shadow distance is split into
+// CASCADE_COUNT slices (practical split scheme), each one gets a layer of a depth texture array. A cascade covers the
+// bounding sphere of its slice, so its size doesn't change when the camera turns, and its center is snapped to whole
+// texels in light space, so moving the camera doesn't make the shadow edges crawl.
+// The far cascades are cached: they cover a larger sphere than the slice needs, and their static casters are kept in
+// a layer of their own that is only drawn again once the slice leaves the sphere, the light turns or the static
+// casters change (InvalidateCasters()). Every frame the cached layer is copied into the cascade and only the moving
+// casters are drawn on top. The near ones are drawn in full every frame.
+// Shaders sample the array through a sampler2DArrayShadow, see shader/phong.fs.
+class CascadedShadowMap
+{
+public:
+    static const int CASCADE_COUNT = 4;
+    // cascades from this one on are cached
+    static const int FIRST_CACHED_CASCADE = 2;
+
+    explicit CascadedShadowMap(int resolution = 1024);
+    ~CascadedShadowMap();
+
+    // lightDirection points from the light into the scene, casterBounds has to hold every caster that may throw a
+    // shadow into the view, fovY in radians
+    void Update(const glm::mat4& view, float fovY, float aspect, float zNear, float shadowDistance,
+                const glm::vec3& lightDirection, const AABB& casterBounds);
+    // the static casters changed, cached cascades are drawn again on the next Update()
+    void InvalidateCasters() { castersChanged = true; }
+    void SetCaching(bool enabled) { caching = enabled; }
+
+    // whether the cascade keeps its static casters from earlier frames
+    bool IsCached(int cascade) const { return caching && cascade >= FIRST_CACHED_CASCADE; }
+    // whether the last Update() needs the cascade drawn, for a cached one only its static casters
+    bool NeedsRender(int cascade) const { return cascades[cascade].dirty; }
+    // the Begin functions bind a layer to draw casters into with GetView() and GetProjection(cascade), finish the last
+    // cascade with End(). BeginCascade() clears the layer of a cascade that isn't cached, for all of its casters.
+    void BeginCascade(int cascade);
+    // clears the cached layer of a cascade that NeedsRender(), for its static casters
+    void BeginStaticCasters(int cascade);
+    // copies the cached layer into the cascade, for its moving casters on top
+    void BeginDynamicCasters(int cascade);
+    // a cached cascade without moving casters, copies the cached layer unless the cascade holds only that already
+    void UseStaticCasters(int cascade);
+    // restores the framebuffer and viewport bound before the first Begin, if there was one
+    void End();
+
+    const glm::mat4& GetView() const { return lightView; }
+    const glm::mat4& GetProjection(int cascade) const { return cascades[cascade].projection; }
+    const glm::mat4& GetViewProjection(int cascade) const { return cascades[cascade].viewProjection; }
+
+    // sets lightSpace[], cascadeSplits and cascadeNormalOffset of the program in use
+    void Apply(Shader& shader) const;
+    void Bind(GLuint unit) const;
+
+    const ShadowStats& GetStats() const { return stats; }
+
+private:
+    struct Cascade
+    {
+        glm::mat4 projection = glm::mat4(1.0f);
+        glm::mat4 viewProjection = glm::mat4(1.0f);
+        // the sphere the cascade was drawn for, in world space
+        glm::vec3 center = glm::vec3(0.0f);
+        float radius = 0.0f;
+        // view distance where the next cascade takes over
+        float splitFar = 0.0f;
+        bool valid = false;
+        bool dirty = true;
+        // the layer holds the cached static casters and nothing else
+        bool staticOnly = false;
+    };
+
+    static const int CACHED_CASCADE_COUNT = CASCADE_COUNT - FIRST_CACHED_CASCADE;
+
+    int resolution;
+    GLuint texture = 0;
+    GLuint framebuffer = 0;
+    // the static casters of the cached cascades, a layer each
+    GLuint cacheTexture = 0;
+    GLuint cacheFramebuffer = 0;
+    Cascade cascades[CASCADE_COUNT];
+    glm::mat4 lightView = glm::mat4(1.0f);
+    glm::vec3 lightDirection = glm::vec3(0.0f);
+    bool castersChanged = true;
+    bool caching = true;
+
+    bool drawing = false;
+    GLint previousFramebuffer = 0;
+    GLint previousViewport[4] = {};
+    ShadowStats stats;
+
+    void fitCascade(Cascade& cascade, const glm::vec3& center, float radius, const AABB& casterBounds);
+    void beginDrawing();
+    void copyStaticCasters(int cascade);
+};
+
+#endif//_SHADOW_MAP_H_
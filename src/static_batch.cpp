@@ -0,0 +1,170 @@
+#include "static_batch.h"
+
+#include <algorithm>
+
+StaticBatch::StaticBatch()
+{
+    // glad only sets the flag when the context really is 4.3, a 3.3 context takes the fallback
+    indirectSupported = GLAD_GL_VERSION_4_3 != 0;
+
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vertexBuffer);
+    glGenBuffers(1, &indexBuffer);
+    glGenBuffers(1, &drawIdBuffer);
+    glGenBuffers(1, &commandBuffer);
+    glGenBuffers(1, &transformBuffer);
+    glGenTextures(1, &transformTexture);
+
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glBindBuffer(GL_ARRAY_BUFFER, drawIdBuffer);
+    glVertexAttribIPointer(DRAW_ID_ATTRIBUTE, 1, GL_UNSIGNED_INT, 0, (void*)0);
+    glVertexAttribDivisor(DRAW_ID_ATTRIBUTE, 1);
+    glEnableVertexAttribArray(DRAW_ID_ATTRIBUTE);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+    glBindVertexArray(0);
+}
+
+StaticBatch::~StaticBatch()
+{
+    glDeleteTextures(1, &transformTexture);
+    glDeleteBuffers(1, &transformBuffer);
+    glDeleteBuffers(1, &commandBuffer);
+    glDeleteBuffers(1, &drawIdBuffer);
+    glDeleteBuffers(1, &indexBuffer);
+    glDeleteBuffers(1, &vertexBuffer);
+    glDeleteVertexArrays(1, &vao);
+}
+
+uint32_t StaticBatch::AddMesh(const std::vector<float>& meshVertices, const std::vector<uint32_t>& meshIndices)
+{
+    Mesh mesh;
+    mesh.firstIndex = (GLuint)indices.size();
+    mesh.indexCount = (GLuint)meshIndices.size();
+    mesh.baseVertex = (GLint)(vertices.size() / 6);
+    vertices.insert(vertices.end(), meshVertices.begin(), meshVertices.end());
+    indices.insert(indices.end(), meshIndices.begin(), meshIndices.end());
+    meshes.push_back(mesh);
+    geometryDirty = true;
+    return (uint32_t)meshes.size() - 1;
+}
+
+uint32_t StaticBatch::AddDraw(uint32_t mesh, const glm::mat4& transform)
+{
+    uint32_t draw = (uint32_t)drawMeshes.size();
+    drawMeshes.push_back(mesh);
+    transforms.push_back(transform);
+    dirtyBegin = std::min(dirtyBegin, draw);
+    dirtyEnd = draw + 1;
+    return draw;
+}
+
+void StaticBatch::SetTransform(uint32_t draw, const glm::mat4& transform)
+{
+    transforms[draw] = transform;
+    dirtyBegin = std::min(dirtyBegin, draw);
+    dirtyEnd = std::max(dirtyEnd, draw + 1);
+}
+
+void StaticBatch::ClearDraws()
+{
+    drawMeshes.clear();
+    transforms.clear();
+    dirtyBegin = UINT32_MAX;
+    dirtyEnd = 0;
+}
+
+void StaticBatch::Draw(const std::vector<uint32_t>& draws, GLuint textureUnit)
+{
+    upload();
+    stats = StaticBatchStats();
+    stats.meshes = (uint32_t)meshes.size();
+    stats.draws = (uint32_t)draws.size();
+
+    // counting sort of the draw ids by mesh, afterwards meshOffsets[m] is where mesh m + 1 starts
+    meshOffsets.assign(meshes.size() + 1, 0);
+    for (uint32_t draw : draws)
+        meshOffsets[drawMeshes[draw] + 1]++;
+    for (size_t m = 0; m < meshes.size(); m++)
+        meshOffsets[m + 1] += meshOffsets[m];
+    drawIds.resize(draws.size());
+    for (uint32_t draw : draws)
+        drawIds[meshOffsets[drawMeshes[draw]]++] = draw;
+
+    commands.clear();
+    for (size_t m = 0; m < meshes.size(); m++) {
+        uint32_t begin = m > 0 ? meshOffsets[m - 1] : 0;
+        uint32_t end = meshOffsets[m];
+        if (end > begin) {
+            commands.push_back({meshes[m].indexCount, end - begin, meshes[m].firstIndex, meshes[m].baseVertex, begin});
+            stats.triangles += meshes[m].indexCount / 3 * (end - begin);
+        }
+    }
+    stats.commands = (uint32_t)commands.size();
+    if (commands.empty())
+        return;
+
+    // orphan the per frame buffers so the upload doesn't wait for last frame's draws
+    glBindBuffer(GL_ARRAY_BUFFER, drawIdBuffer);
+    glBufferData(GL_ARRAY_BUFFER, drawIds.size() * sizeof(uint32_t), nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, drawIds.size() * sizeof(uint32_t), drawIds.data());
+
+    glActiveTexture(GL_TEXTURE0 + textureUnit);
+    glBindTexture(GL_TEXTURE_BUFFER, transformTexture);
+    glActiveTexture(GL_TEXTURE0);
+
+    glBindVertexArray(vao);
+    if (useIndirect && indirectSupported) {
+        glVertexAttribIPointer(DRAW_ID_ATTRIBUTE, 1, GL_UNSIGNED_INT, 0, (void*)0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+        glBufferData(GL_DRAW_INDIRECT_BUFFER, commands.size() * sizeof(DrawCommand), nullptr, GL_STREAM_DRAW);
+        glBufferSubData(GL_DRAW_INDIRECT_BUFFER, 0, commands.size() * sizeof(DrawCommand), commands.data());
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, (GLsizei)commands.size(), 0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        stats.indirect = true;
+    } else {
+        for (const DrawCommand& cmd : commands) {
+            glVertexAttribIPointer(DRAW_ID_ATTRIBUTE, 1, GL_UNSIGNED_INT, 0,
+                                   (void*)(cmd.baseInstance * sizeof(uint32_t)));
+            glDrawElementsInstancedBaseVertex(GL_TRIANGLES, cmd.count, GL_UNSIGNED_INT,
+                                              (void*)(cmd.firstIndex * sizeof(uint32_t)), cmd.instanceCount,
+                                              cmd.baseVertex);
+        }
+    }
+    glBindVertexArray(0);
+}
+
+void StaticBatch::upload()
+{
+    if (geometryDirty) {
+        glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+        glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+        // the element buffer binding is part of the VAO
+        glBindVertexArray(vao);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(uint32_t), indices.data(), GL_STATIC_DRAW);
+        glBindVertexArray(0);
+        geometryDirty = false;
+    }
+
+    glBindBuffer(GL_TEXTURE_BUFFER, transformBuffer);
+    if (transforms.size() > transformCapacity) {
+        transformCapacity = std::max(transforms.size(), transformCapacity * 2);
+        glBufferData(GL_TEXTURE_BUFFER, transformCapacity * sizeof(glm::mat4), nullptr, GL_DYNAMIC_DRAW);
+        glBindTexture(GL_TEXTURE_BUFFER, transformTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, transformBuffer);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        dirtyBegin = 0;
+        dirtyEnd = (uint32_t)transforms.size();
+    }
+    if (dirtyBegin < dirtyEnd) {
+        glBufferSubData(GL_TEXTURE_BUFFER, dirtyBegin * sizeof(glm::mat4), (dirtyEnd - dirtyBegin) * sizeof(glm::mat4),
+                        transforms.data() + dirtyBegin);
+    }
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+    dirtyBegin = UINT32_MAX;
+    dirtyEnd = 0;
+}
@@ -0,0 +1,105 @@
+#ifndef _STATIC_BATCH_H_
+#define _STATIC_BATCH_H_
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+struct StaticBatchStats
+{
+    uint32_t meshes = 0;
+    // draws submitted and the commands they were merged into by the last Draw()
+    uint32_t draws = 0;
+    uint32_t commands = 0;
+    uint32_t triangles = 0;
+    // the last Draw() went through glMultiDrawElementsIndirect
+    bool indirect = false;
+};
+
+// Static geometry packed into one vertex and one index buffer, drawn with a handful of GL calls no matter how many
+// objects there are. Each draw refers to a mesh and owns a transform; the transforms live in a texture buffer (4
+// RGBA32F texels per matrix) that the vertex shader fetches with the draw id, which comes in as an instanced
+// attribute. Draw() groups the requested draws by mesh, one command per mesh, and on GL 4.3 submits all of them with
+// a single glMultiDrawElementsIndirect where the command's base instance selects its draw ids. GL 3.3 has no base
+// instance, so there each command is an instanced base vertex draw with the draw id attribute pointed at its range.
+//
+// Vertices are position + normal (6 floats), the layout of shader/phong_batch.vs.
+class StaticBatch
+{
+public:
+    static const GLuint DRAW_ID_ATTRIBUTE = 2;
+
+    // set to false to force the GL 3.3 path
+    bool useIndirect = true;
+
+    StaticBatch();
+    ~StaticBatch();
+
+    uint32_t AddMesh(const std::vector<float>& vertices, const std::vector<uint32_t>& indices);
+    // returns the draw id
+    uint32_t AddDraw(uint32_t mesh, const glm::mat4& transform);
+    void SetTransform(uint32_t draw, const glm::mat4& transform);
+    // switches the mesh a draw uses, e.g. to another level of detail. Draws are independent, so different ones can be
+    // switched on different threads.
+    void SetMesh(uint32_t draw, uint32_t mesh) { drawMeshes[draw] = mesh; }
+    uint32_t GetMeshTriangleCount(uint32_t mesh) const { return meshes[mesh].indexCount / 3; }
+    void ClearDraws();
+    size_t GetDrawCount() const { return drawMeshes.size(); }
+
+    // draws the given draw ids with the bound program, the transform buffer is bound to textureUnit
+    void Draw(const std::vector<uint32_t>& draws, GLuint textureUnit);
+
+    bool IsIndirectSupported() const { return indirectSupported; }
+    const StaticBatchStats& GetStats() const { return stats; }
+
+private:
+    struct Mesh
+    {
+        GLuint firstIndex;
+        GLuint indexCount;
+        GLint baseVertex;
+    };
+
+    // layout fixed by GL for glMultiDrawElementsIndirect
+    struct DrawCommand
+    {
+        GLuint count;
+        GLuint instanceCount;
+        GLuint firstIndex;
+        GLint baseVertex;
+        GLuint baseInstance;
+    };
+
+    GLuint vao = 0;
+    GLuint vertexBuffer = 0;
+    GLuint indexBuffer = 0;
+    GLuint drawIdBuffer = 0;
+    GLuint commandBuffer = 0;
+    GLuint transformBuffer = 0;
+    GLuint transformTexture = 0;
+    bool indirectSupported = false;
+
+    std::vector<float> vertices;
+    std::vector<uint32_t> indices;
+    std::vector<Mesh> meshes;
+    bool geometryDirty = false;
+
+    std::vector<uint32_t> drawMeshes;
+    std::vector<glm::mat4> transforms;
+    // draws [dirtyBegin, dirtyEnd) have to be uploaded, the buffer is reallocated when it is too small
+    uint32_t dirtyBegin = UINT32_MAX;
+    uint32_t dirtyEnd = 0;
+    size_t transformCapacity = 0;
+
+    // per frame, draw ids sorted by mesh and the commands over them
+    std::vector<uint32_t> drawIds;
+    std::vector<uint32_t> meshOffsets;
+    std::vector<DrawCommand> commands;
+    StaticBatchStats stats;
+
+    void upload();
+};
+
+#endif//_STATIC_BATCH_H_
@@ -0,0 +1,72 @@
+#include "transform_benchmark.h"
+#include "job_system.h"
+#include "scene.h"
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+namespace {
+
+// fanout of the generated tree, 1M nodes end up about seven levels deep
+const uint32_t BENCH_FANOUT = 8;
+
+void BuildBenchmarkScene(Scene& scene, uint32_t nodeCount)
+{
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    scene.Clear();
+    scene.Reserve(nodeCount);
+    for (uint32_t i = 0; i < nodeCount; i++) {
+        NodeId node = scene.CreateNode(i == 0 ? INVALID_NODE : (i - 1) / BENCH_FANOUT);
+        scene.SetPosition(node, glm::vec3(dist(rng), dist(rng), dist(rng)));
+        scene.SetScale(node, glm::vec3(0.99f));
+    }
+    scene.UpdateTransforms();
+}
+
+template <typename Update>
+double TimeUpdates(Scene& scene, int iterations, Update update)
+{
+    double total = 0.0;
+    // one warm-up round, then dirty the root every iteration so the whole tree is recomputed
+    for (int i = -1; i < iterations; i++) {
+        scene.SetRotation(0, glm::angleAxis(0.01f * i, glm::vec3(0.0f, 1.0f, 0.0f)));
+        auto start = std::chrono::steady_clock::now();
+        update();
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (i >= 0)
+            total += ms;
+    }
+    return total / iterations;
+}
+
+} // namespace
+
+void RunTransformBenchmark(uint32_t nodeCount, int iterations)
+{
+    Scene scene;
+    BuildBenchmarkScene(scene, nodeCount);
+    std::cout << "transform update benchmark: " << nodeCount << " nodes, " << scene.GetLevelCount() << " levels, "
+              << iterations << " iterations" << std::endl;
+
+    double serialMs = TimeUpdates(scene, iterations, [&] { scene.UpdateTransforms(); });
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "  serial sweep   " << std::setw(9) << serialMs << " ms" << std::endl;
+
+    // powers of two, plus the full core count when it isn't one
+    unsigned maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned> threadCounts;
+    for (unsigned threads = 1; threads < maxThreads; threads *= 2)
+        threadCounts.push_back(threads);
+    threadCounts.push_back(maxThreads);
+
+    for (unsigned threads : threadCounts) {
+        JobSystem jobs(threads);
+        double ms = TimeUpdates(scene, iterations, [&] { scene.UpdateTransforms(jobs); });
+        std::cout << "  " << std::setw(3) << threads << " thread(s)  " << std::setw(9) << ms << " ms  x"
+                  << std::setprecision(2) << serialMs / ms << std::setprecision(3) << std::endl;
+    }
+}
@@ -0,0 +1,10 @@
+#ifndef _TRANSFORM_BENCHMARK_H_
+#define _TRANSFORM_BENCHMARK_H_
+
+#include <cstdint>
+
+// times a full hierarchy update of nodeCount nodes with the serial sweep and with the job system on 1 to N threads,
+// and prints a table with the speedup over the serial sweep
+void RunTransformBenchmark(uint32_t nodeCount, int iterations = 20);
+
+#endif//_TRANSFORM_BENCHMARK_H_